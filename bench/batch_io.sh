@@ -0,0 +1,22 @@
+#!/bin/sh
+# Compare I/O throughput of plinterp with and without --batch, echoing a large list of numbers.
+# Usage: bench/batch_io.sh build_dir [count]
+BUILD=$(cd "${1:-build}" && pwd)
+COUNT=${2:-200000}
+SRC=$(cd "$(dirname "$0")" && pwd)/io_echo.txt
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+"$BUILD/src/plc" "$SRC" -o echo.plam > /dev/null || exit 1
+# A count followed by numbers of mixed sign and length
+awk -v n="$COUNT" 'BEGIN { print n; x = 1; for (i = 0; i < n; i++) { x = (x * 1103 + 12345) % 65536; print x - 32768 } }' > input.txt
+
+for flags in "" "--batch" "--jit" "--jit --batch"; do
+    start=$(date +%s%N)
+    "$BUILD/interpreter/plinterp" $flags echo.plam < input.txt > output.txt || exit 1
+    end=$(date +%s%N)
+    ms=$(( (end - start) / 1000000 ))
+    echo "plinterp $flags: $ms ms, $(( COUNT * 1000 / (ms + 1) )) numbers/s," \
+         "$(grep -c Output output.txt) lines written"
+done
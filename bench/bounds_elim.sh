@@ -0,0 +1,24 @@
+#!/bin/sh
+# Compare interpreter run time of the large bubble sort with and without bounds check elimination.
+# Usage: bench/bounds_elim.sh build_dir [runs]
+BUILD=$(cd "${1:-build}" && pwd)
+RUNS=${2:-5}
+SRC=$(cd "$(dirname "$0")" && pwd)/bubble_sort_large.txt
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+"$BUILD/src/plc" "$SRC" -o checked.plam --no-bounds-elim > /dev/null || exit 1
+"$BUILD/src/plc" "$SRC" -o unchecked.plam > /dev/null || exit 1
+
+for prog in checked unchecked; do
+    start=$(date +%s%N)
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        "$BUILD/interpreter/plinterp" $prog.plam > /dev/null || exit 1
+        i=$((i + 1))
+    done
+    end=$(date +%s%N)
+    echo "$prog: $(( (end - start) / RUNS / 1000000 )) ms per run," \
+         "$(grep -c '^INDEX ' $prog.plam) checked accesses"
+done
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Latency of a plc process compiling each demo and benchmark program without a cache, with an
+# empty cache (a miss, which also stores the entry) and with the entry cached (a hit).
+# Usage: bench/cache.sh build_dir [runs]
+BUILD=$(cd "${1:-build}" && pwd)
+RUNS=${2:-20}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+cp "$ROOT"/demos/*.txt "$ROOT"/bench/bubble_sort_large.txt .
+
+# Mean us per compile of each source, run with the given setup command before each compile
+time_compiles() {
+    setup=$1
+    shift
+    total=0
+    count=0
+    for src in *.txt; do
+        i=0
+        while [ $i -lt "$RUNS" ]; do
+            $setup
+            start=$(date +%s%N)
+            "$PLC" "$src" -o out.plam "$@" > /dev/null 2>&1
+            end=$(date +%s%N)
+            total=$((total + end - start))
+            count=$((count + 1))
+            i=$((i + 1))
+        done
+    done
+    echo "$((total / count / 1000)) us"
+}
+
+echo "no cache: $(time_compiles true)"
+echo "miss:     $(time_compiles "rm -rf cache" --cache-dir=cache)"
+"$PLC" *.txt --cache-dir=cache > /dev/null 2>&1
+echo "hit:      $(time_compiles true --cache-dir=cache)"
@@ -0,0 +1,65 @@
+#!/bin/sh
+# Compile time and peak memory of a program with a great many definitions: nested procedures that
+# each define integer, Boolean, array and constant identifiers, most of them in scope at the
+# innermost level. Peak memory is measured with python3, when it is installed. Other plc
+# executables, such as ones built from earlier commits, can be given to compare against.
+# Definitions are parsed recursively, so the stack size limit is lifted.
+# Usage: bench/declarations.sh build_dir [depth] [definitions] [other_plc...]
+BUILD=$(cd "${1:-build}" && pwd)
+DEPTH=${2:-50}
+DEFS=${3:-2000}
+shift 3 2>/dev/null || shift $#
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+ulimit -s unlimited 2> /dev/null
+
+# Definitions of a block, a quarter of each kind, with names ending in suffix
+definitions() {
+    awk -v n="$DEFS" -v suffix="$1" 'BEGIN {
+        for (i = 0; i < n / 4; i++) {
+            printf "integer i%d%s; Boolean b%d%s; integer array a%d%s[10]; const c%d%s = %d;\n",
+                   i, suffix, i, suffix, i, suffix, i, suffix, i
+        }
+    }'
+}
+
+{
+    echo "begin"
+    level=1
+    while [ $level -le "$DEPTH" ]; do
+        definitions "_$level"
+        echo "proc p$level begin"
+        level=$((level + 1))
+    done
+    definitions ""
+    echo "i0 := c1_1 + a2_1[c3_1] + i0_$DEPTH;"
+    level=$DEPTH
+    while [ $level -ge 1 ]; do
+        echo "end;"
+        echo "call p$level;"
+        level=$((level - 1))
+    done
+    echo "end."
+} > decls.pl
+echo "$(( (DEPTH + 1) * DEFS )) definitions in $DEPTH nested procedures, $(wc -l < decls.pl) lines"
+
+# Peak resident memory of compiling decls.pl, in KB
+peak_memory() {
+    command -v python3 > /dev/null || { echo "-"; return; }
+    python3 -c 'import resource, subprocess, sys
+subprocess.call([sys.argv[1], "decls.pl", "-o", "out.plam"], stdout=subprocess.DEVNULL)
+print(resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss)' "$1"
+}
+
+for plc in "$PLC" "$@"; do
+    runs=0
+    start=$(date +%s%N)
+    while [ $runs -lt 5 ]; do
+        "$plc" decls.pl -o out.plam > messages.txt 2>&1 || { head -5 messages.txt; exit 1; }
+        runs=$((runs + 1))
+    done
+    end=$(date +%s%N)
+    echo "  $plc: $(( (end - start) / runs / 1000 )) us, $(peak_memory "$plc") KB peak"
+done
@@ -0,0 +1,59 @@
+#!/bin/sh
+# Compile time of programs made of the scope and type test files repeated many times, so that
+# nearly every statement has an error, with text and JSON messages. A second plc, such as one built
+# from an earlier commit, can be given to compare against.
+# Usage: bench/diagnostics.sh build_dir [copies] [other_plc]
+BUILD=$(cd "${1:-build}" && pwd)
+COPIES=${2:-200}
+OTHER=$3
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# Each test file is a whole program, so the copies are placed in procedures of one program
+for src in "$ROOT"/test/src_files/scope/vars_undefined "$ROOT"/test/src_files/type/assigning_literals \
+           "$ROOT"/test/src_files/type/guarded_commands; do
+    name=$(basename "$src")
+    {
+        echo "begin"
+        i=0
+        while [ $i -lt "$COPIES" ]; do
+            echo "proc p$i"
+            sed -e 's/\$.*//' -e 's/^ *end\. *$/end;/' "$src"
+            # The test files don't end in a newline
+            echo
+            i=$((i + 1))
+        done
+        echo "skip;"
+        echo "end."
+    } > "$name.pl"
+done
+
+# Mean us per compile of each program, with messages written to a file
+time_compiles() {
+    plc=$1
+    shift
+    for src in *.pl; do
+        runs=0
+        start=$(date +%s%N)
+        while [ $runs -lt 5 ]; do
+            "$plc" "$src" -o out.plam "$@" > /dev/null 2> messages.txt
+            runs=$((runs + 1))
+        done
+        end=$(date +%s%N)
+        errors=$(grep -o 'Error [0-9]* on line\|"error"' messages.txt | wc -l)
+        printf '  %-22s %6d errors %8d us\n' "$src" "$errors" \
+            $(( (end - start) / runs / 1000 ))
+    done
+}
+
+echo "text:"
+time_compiles "$PLC"
+echo "json:"
+time_compiles "$PLC" -fdiagnostics-format=json
+if [ -n "$OTHER" ]; then
+    echo "$OTHER:"
+    time_compiles "$OTHER"
+fi
@@ -0,0 +1,83 @@
+#!/bin/sh
+# Latency of recompiling a program of about 50,000 lines after single-line edits, with plc --server
+# compiling each version from scratch and with plc --server --incremental reusing the tokens and
+# procedure code of the previous version. Each edit is made to the version before it: a change to
+# one procedure body, a comment added at the top that moves every line after it, and a change to
+# the main program. Times are those reported by the server, excluding the first compilation.
+# Usage: bench/incremental.sh build_dir [procedures] [edits]
+BUILD=$(cd "${1:-build}" && pwd)
+PROCS=${2:-2500}
+EDITS=${3:-10}
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# Each procedure sums an array, adjusts a global and calls the one before it
+awk -v n="$PROCS" 'BEGIN {
+    print "begin"
+    print "    integer g, h;"
+    for (p = 1; p <= n; p++) {
+        printf "    proc p%d\n    begin\n", p
+        print "        integer i, s;"
+        print "        integer array a[10];"
+        print "        proc inner"
+        print "        begin"
+        print "            s := s + g;"
+        print "        end;"
+        print "        s := 0;"
+        print "        i := 1;"
+        print "        do i < 11 ->"
+        printf "            a[i] := i * %d;\n", p
+        print "            s := s + a[i];"
+        print "            i := i + 1;"
+        print "        od;"
+        print "        if s > 100 -> g := g + 1;"
+        print "        [] ~(s > 100) -> g := g - 1;"
+        print "        fi;"
+        print "        call inner;"
+        if (p > 1) {
+            printf "        call p%d;\n", p - 1
+        }
+        print "    end;"
+    }
+    printf "    g := 0;\n    call p%d;\n    write g;\nend.\n", n
+}' > v0.pl
+echo "$PROCS procedures, $(wc -l < v0.pl) lines, $EDITS edits of each kind"
+
+# Append a source request for file to requests.txt
+request() {
+    echo "source out.plam $(wc -c < "$1")" >> requests.txt
+    cat "$1" >> requests.txt
+}
+
+: > requests.txt
+: > kinds.txt
+request v0.pl
+cp v0.pl current.pl
+i=1
+while [ "$i" -le "$EDITS" ]; do
+    p=$(( (i * 7919) % PROCS + 1 ))
+    sed "s/a\[i\] := i \* $p;/a[i] := i * $((p + i));/" current.pl > next.pl && mv next.pl current.pl
+    request current.pl
+    echo body >> kinds.txt
+    sed "2s/^/    \$ edit $i\n/" current.pl > next.pl && mv next.pl current.pl
+    request current.pl
+    echo lines >> kinds.txt
+    sed "s/^    g := [0-9]*;/    g := $i;/" current.pl > next.pl && mv next.pl current.pl
+    request current.pl
+    echo main >> kinds.txt
+    i=$((i + 1))
+done
+
+for mode in "" "--incremental"; do
+    "$PLC" --server $mode < requests.txt > responses.txt
+    awk '/^(ok|error) [0-9]+ [0-9]+$/ { print $1, $2 }' responses.txt | tail -n +2 | paste -d ' ' kinds.txt - |
+        awk -v mode="${mode:-full}" '
+            $2 != "ok" { failed++ }
+            { t[$1] += $3; n[$1]++ }
+            END {
+                printf "  %-13s body %d us, lines %d us, main %d us%s\n", mode, t["body"] / n["body"],
+                       t["lines"] / n["lines"], t["main"] / n["main"], failed ? " (compile errors)" : ""
+            }'
+done
@@ -0,0 +1,40 @@
+#!/bin/sh
+# Compare running every demo many times as separate plinterp --batch processes against a single
+# plinterp --manifest run, with one thread and with one per processor.
+# Usage: bench/manifest.sh build_dir [copies]
+BUILD=$(cd "${1:-build}" && pwd)
+COPIES=${2:-100}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PLINTERP=$BUILD/interpreter/plinterp
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+for src in "$ROOT"/demos/*.txt; do
+    name=$(basename "$src" .txt)
+    "$BUILD/src/plc" "$src" -o "$name.plam" > /dev/null || exit 1
+    input="$ROOT/test/demo_inputs/$name.in"
+    [ -f "$input" ] || input=-
+    i=0
+    while [ $i -lt "$COPIES" ]; do
+        echo "$name.plam $input"
+        i=$((i + 1))
+    done
+done > manifest.txt
+runs=$(wc -l < manifest.txt)
+
+start=$(date +%s%N)
+while read -r program input; do
+    [ "$input" = - ] && input=/dev/null
+    "$PLINTERP" --batch "$program" < "$input" > /dev/null 2>&1
+done < manifest.txt
+end=$(date +%s%N)
+echo "$runs separate processes: $(( (end - start) / 1000000 )) ms"
+
+for threads in $(printf "%s\n" 1 "$(nproc)" | sort -un); do
+    start=$(date +%s%N)
+    "$PLINTERP" --manifest -j "$threads" manifest.txt > report.txt
+    end=$(date +%s%N)
+    echo "--manifest -j $threads: $(( (end - start) / 1000000 )) ms," \
+         "$(tail -1 report.txt)"
+done
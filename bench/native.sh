@@ -0,0 +1,36 @@
+#!/bin/sh
+# Compare run time of the interpreter against plinterp --jit and native x86-64 code, on the programs
+# that need no input.
+# Usage: bench/native.sh build_dir [runs]
+BUILD=$(cd "${1:-build}" && pwd)
+RUNS=${2:-5}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# Average ms per run of a command
+time_runs() {
+    start=$(date +%s%N)
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        "$@" < /dev/null > /dev/null 2>&1
+        i=$((i + 1))
+    done
+    end=$(date +%s%N)
+    echo $(( (end - start) / RUNS / 1000 ))
+}
+
+for src in "$ROOT"/bench/*.txt "$ROOT"/demos/*.txt; do
+    name=$(basename "$src" .txt)
+    # Demos that read input are not CPU-bound
+    [ -f "$ROOT/test/demo_inputs/$name.in" ] && continue
+
+    "$BUILD/src/plc" "$src" -o prog.plam > /dev/null || exit 1
+    "$BUILD/src/plc" "$src" -o prog.s --target=x86-64 > /dev/null || exit 1
+    cc prog.s "$BUILD/runtime/libplrt.a" -o prog || exit 1
+    interp=$(time_runs "$BUILD/interpreter/plinterp" prog.plam)
+    jit=$(time_runs "$BUILD/interpreter/plinterp" --jit prog.plam)
+    native=$(time_runs ./prog)
+    echo "$name: plinterp $interp us, jit $jit us, native $native us per run"
+done
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Compile time of a program of deeply nested procedures. Every procedure defines its own variables
+# and redefines ones of the enclosing procedures, and its statements use variables of the outermost
+# block and of its own. A second plc, such as one built from an earlier commit, can be given to
+# compare against.
+# Usage: bench/nested_scopes.sh build_dir [depth] [identifiers] [other_plc]
+BUILD=$(cd "${1:-build}" && pwd)
+DEPTH=${2:-250}
+IDS=${3:-40}
+OTHER=$4
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# names prefix: prefix0, prefix1... prefix(IDS-1)
+names() {
+    awk -v prefix="$1" -v n="$IDS" \
+        'BEGIN { for (i = 0; i < n; i++) printf "%s%s%d", (i ? ", " : ""), prefix, i; print "" }'
+}
+
+# Statements using the outermost variables g and the variables of the current block l
+statements() {
+    awk -v n="$IDS" -v level="$1" 'BEGIN {
+        for (i = 0; i < n; i++)
+            printf "l%d_%d := g%d + s%d - l%d_%d;\n", level, i, i, (i + 1) % n, level, (i + 2) % n }'
+}
+
+{
+    echo "begin"
+    echo "integer $(names g); integer $(names s);"
+    level=1
+    while [ $level -le "$DEPTH" ]; do
+        echo "proc p$level begin"
+        echo "integer $(names "l${level}_"); integer $(names s);"
+        level=$((level + 1))
+    done
+    level=$DEPTH
+    while [ $level -ge 1 ]; do
+        statements $level
+        echo "end;"
+        level=$((level - 1))
+    done
+    statements 0 | sed 's/l0_/g/g'
+    echo "end."
+} > nested.pl
+echo "$DEPTH levels, $((IDS * 2)) identifiers defined in each, $(wc -l < nested.pl) lines"
+
+time_compiles() {
+    plc=$1
+    runs=0
+    start=$(date +%s%N)
+    while [ $runs -lt 10 ]; do
+        "$plc" nested.pl -o out.plam > messages.txt 2>&1 || { head -5 messages.txt; exit 1; }
+        runs=$((runs + 1))
+    done
+    end=$(date +%s%N)
+    echo "  $plc: $(( (end - start) / runs / 1000 )) us"
+}
+
+time_compiles "$PLC"
+if [ -n "$OTHER" ]; then
+    time_compiles "$OTHER"
+fi
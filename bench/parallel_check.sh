@@ -0,0 +1,66 @@
+#!/bin/sh
+# Scaling of plc parsing the procedure bodies of one program on 1 to 16 threads with
+# --procedure-threads. Two programs of thousands of procedures are compiled: in one each procedure
+# only uses its own variables and the globals, in the other each also calls the one before it. A
+# body calling a procedure whose body was parsed alongside it is parsed in two waves, so the second
+# does about twice the work of one thread before it is shared out.
+# Speedup can't exceed the number of processors, which is printed first.
+# Usage: bench/parallel_check.sh build_dir [procedures]
+BUILD=$(cd "${1:-build}" && pwd)
+PROCS=${2:-5000}
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# Procedures summing and scaling arrays, calling the one before them if calls is set
+generate() {
+    awk -v n="$PROCS" -v calls="$1" 'BEGIN {
+        print "begin"
+        print "    integer g, h;"
+        print "    integer array data[10];"
+        for (p = 1; p <= n; p++) {
+            printf "    proc p%d\n    begin\n", p
+            print "        integer i, s;"
+            print "        integer array scaled[20];"
+            print "        proc inner"
+            print "        begin"
+            print "            s := s + g;"
+            print "        end;"
+            print "        s := 0;"
+            print "        i := 1;"
+            print "        do i < 11 ->"
+            printf "            data[i] := i * %d;\n", p
+            print "            scaled[i + 5] := data[i] + s * (i - 1) / 2;"
+            print "            s := s + data[i];"
+            print "            i := i + 1;"
+            print "        od;"
+            print "        if s > 100 -> g := g + 1;"
+            print "        [] ~(s > 100) -> h := h - 1;"
+            print "        fi;"
+            print "        call inner;"
+            if (calls && p > 1) {
+                printf "        call p%d;\n", p - 1
+            }
+            print "    end;"
+        }
+        printf "    g := 0;\n    call p%d;\n    write g, h;\nend.\n", n
+    }'
+}
+generate 0 > independent.pl
+generate 1 > calling.pl
+echo "$PROCS procedures, $(wc -l < independent.pl) lines, $(nproc) processors"
+
+for program in independent calling; do
+    echo "$program:"
+    base=0
+    for threads in 1 2 4 8 16; do
+        start=$(date +%s%N)
+        "$PLC" $program.pl -o $program.$threads.plam --procedure-threads=$threads > /dev/null
+        end=$(date +%s%N)
+        ms=$(( (end - start) / 1000000 ))
+        [ $base -eq 0 ] && base=$ms
+        same=$(cmp -s $program.1.plam $program.$threads.plam && echo "same output" || echo "OUTPUT DIFFERS")
+        echo "  --procedure-threads=$threads: $ms ms, speedup $(awk "BEGIN { printf \"%.2f\", $base / $ms }"), $same"
+    done
+done
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Scaling of plc compiling many files at once with 1 to 32 threads. The corpus is the demos, the
+# benchmark programs and the test source files, copied several times over. Speedup can't exceed
+# the number of processors, which is printed first.
+# Usage: bench/parallel_compile.sh build_dir [copies]
+BUILD=$(cd "${1:-build}" && pwd)
+COPIES=${2:-10}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+i=0
+while [ $i -lt "$COPIES" ]; do
+    for src in "$ROOT"/demos/*.txt "$ROOT"/bench/*.txt "$ROOT"/test/src_files/*/*; do
+        cp "$src" "$i.$(basename "$src").pl"
+    done
+    i=$((i + 1))
+done
+count=$(ls *.pl | wc -l)
+echo "$count files, $(cat *.pl | wc -l) lines, $(nproc) processors"
+
+base=0
+for threads in 1 2 4 8 16 32; do
+    start=$(date +%s%N)
+    "$PLC" *.pl -j $threads > /dev/null 2>&1
+    end=$(date +%s%N)
+    ms=$(( (end - start) / 1000000 ))
+    [ $base -eq 0 ] && base=$ms
+    echo "-j $threads: $ms ms, speedup $(awk "BEGIN { printf \"%.2f\", $base / $ms }")"
+done
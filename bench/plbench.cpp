@@ -0,0 +1,328 @@
+/*  Times each stage of the pipeline - scanning, parsing and code generation, assembling and
+    interpreting - on generated programs, each stressing one part of the language:
+        nesting       procedures and statements nested deeply inside each other
+        expressions   assignments of long expressions
+        arrays        large arrays, swept by loops
+        procedures    many procedures, each calling the one before it
+        comments      programs that are mostly comments
+    The programs are the same on every run, so the times of different commits can be compared.
+    The interpreter's store is small, so programs are interpreted at a smaller size than the
+    other stages are timed at, with their loops repeated more often
+*/
+
+#include "program_generator.h"
+#include "compiler.h"
+#include "json.h"
+#include "optimizer.h"
+#include "Assembler.h"
+#include "interp.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Workload
+{
+    std::string name;
+    // Timed at by scanning, code generation and assembly, and by interpretation
+    GeneratorOptions compiled;
+    GeneratorOptions interpreted;
+};
+
+// The size of a program, and the median and fastest time of each stage in milliseconds
+struct Result
+{
+    std::string name;
+    int lines;
+    int tokens;
+    int instructions;
+    long long executed;
+    std::vector<std::pair<double, double>> stages;
+};
+
+const char *const STAGES[] = {"scan", "codegen", "assemble", "interpret"};
+
+static std::vector<Workload> workloads(double scale)
+{
+    auto scaled = [scale](int n) { return std::max(1, (int)(n * scale)); };
+    std::vector<Workload> list(5);
+
+    list[0].name = "nesting";
+    list[0].compiled.procedures = scaled(10);
+    list[0].compiled.procedure_depth = 20;
+    list[0].compiled.statements = 4;
+    list[0].compiled.statement_depth = 25;
+    list[0].interpreted.procedures = 1;
+    list[0].interpreted.procedure_depth = 3;
+    list[0].interpreted.statements = 1;
+    list[0].interpreted.statement_depth = 3;
+    list[0].interpreted.array_size = 20;
+    list[0].interpreted.trip_count = 1000;
+
+    list[1].name = "expressions";
+    list[1].compiled.procedures = scaled(20);
+    list[1].compiled.expression_length = 60;
+    list[1].interpreted.procedures = 1;
+    list[1].interpreted.procedure_depth = 0;
+    list[1].interpreted.statements = 2;
+    list[1].interpreted.statement_depth = 1;
+    list[1].interpreted.expression_length = 30;
+    list[1].interpreted.array_size = 20;
+    list[1].interpreted.trip_count = 5000;
+
+    list[2].name = "arrays";
+    list[2].compiled.procedures = scaled(40);
+    list[2].compiled.statements = 15;
+    list[2].compiled.array_size = 100000;
+    list[2].interpreted.procedures = 1;
+    list[2].interpreted.procedure_depth = 0;
+    list[2].interpreted.statements = 2;
+    list[2].interpreted.statement_depth = 1;
+    list[2].interpreted.array_size = 500;
+    list[2].interpreted.trip_count = 200;
+
+    list[3].name = "procedures";
+    list[3].compiled.procedures = scaled(300);
+    list[3].compiled.procedure_depth = 0;
+    list[3].compiled.statements = 3;
+    list[3].compiled.statement_depth = 1;
+    list[3].interpreted.procedures = 6;
+    list[3].interpreted.procedure_depth = 0;
+    list[3].interpreted.statements = 1;
+    list[3].interpreted.statement_depth = 1;
+    list[3].interpreted.expression_length = 2;
+    list[3].interpreted.array_size = 20;
+    list[3].interpreted.trip_count = 5000;
+
+    list[4].name = "comments";
+    list[4].compiled.procedures = scaled(40);
+    list[4].compiled.comment_lines = 4;
+    list[4].interpreted.procedures = 1;
+    list[4].interpreted.statements = 2;
+    list[4].interpreted.statement_depth = 1;
+    list[4].interpreted.array_size = 20;
+    list[4].interpreted.trip_count = 200;
+    list[4].interpreted.comment_lines = 4;
+
+    for (size_t w = 0; w < list.size(); w++) {
+        list[w].compiled.seed = list[w].interpreted.seed = w + 1;
+    }
+    return list;
+}
+
+// The median and fastest time of running stage repeat times, in milliseconds
+static std::pair<double, double> time_stage(int repeat, const std::function<void()> &stage)
+{
+    std::vector<double> times;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        stage();
+        std::chrono::duration<double, std::milli> taken = std::chrono::steady_clock::now() - start;
+        times.push_back(taken.count());
+    }
+    std::sort(times.begin(), times.end());
+    return std::make_pair(times[times.size() / 2], times[0]);
+}
+
+static std::vector<Token> scan(const std::string &program)
+{
+    std::istringstream input(program);
+    SymbolTable symbols;
+    Scanner scanner(input, symbols);
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(scanner.get_token());
+    } while (tokens.back().symbol != END_OF_FILE);
+    return tokens;
+}
+
+// Parse, check and optimize the program, as plc does. Returns the number of errors
+static int generate(std::vector<Token> tokens, std::vector<Instruction> &code, std::string &plam)
+{
+    Parser parser;
+    int errors = parser.verify_syntax(&tokens, code);
+    if (errors) {
+        parser.messages().render_text(std::cerr);
+        return errors;
+    }
+    Optimizer optimizer(code);
+    optimizer.inline_procedures(CompilerOptions().inline_limit);
+    optimizer.eliminate_dead_code();
+    plam = plam_text(code);
+    return 0;
+}
+
+// Assemble the PLAM text, without loading it. Returns false if it can't be assembled
+static bool assemble(const std::string &plam, std::string &error)
+{
+    std::istringstream input(plam);
+    std::ostringstream words;
+    Assembler assembler(input, words);
+    assembler.firstPass();
+    input.clear();
+    input.seekg(0);
+    if (!assembler.failed()) {
+        assembler.secondPass();
+    }
+    error = assembler.error();
+    return !assembler.failed();
+}
+
+// Time every stage of workload. Returns false if its programs can't be compiled or run
+static bool run_workload(const Workload &workload, int repeat, Result &result)
+{
+    result.name = workload.name;
+    std::string program = ProgramGenerator(workload.compiled).program();
+    result.lines = std::count(program.begin(), program.end(), '\n');
+
+    std::vector<Token> tokens;
+    result.stages.push_back(time_stage(repeat, [&]() { tokens = scan(program); }));
+    result.tokens = tokens.size();
+
+    std::vector<Instruction> code;
+    std::string plam;
+    int errors = 0;
+    result.stages.push_back(time_stage(repeat, [&]() {
+        code.clear();
+        errors = generate(tokens, code, plam);
+    }));
+    if (errors) {
+        std::cerr << workload.name << ": " << errors << " errors in the generated program" << std::endl;
+        return false;
+    }
+    result.instructions = code.size();
+
+    std::string error;
+    result.stages.push_back(time_stage(repeat, [&]() { assemble(plam, error); }));
+    if (!error.empty()) {
+        std::cerr << workload.name << ": " << error << std::endl;
+        return false;
+    }
+
+    std::string small = ProgramGenerator(workload.interpreted).program();
+    code.clear();
+    if (generate(scan(small), code, plam) != 0) {
+        return false;
+    }
+    std::istringstream small_plam(plam);
+    std::vector<int> words;
+    if (!Interpreter::assemble(small_plam, words, error)) {
+        std::cerr << workload.name << ": the program to interpret can't be loaded: " << error
+                  << std::endl;
+        return false;
+    }
+    Interpreter interpreter;
+    bool failed = false;
+    result.stages.push_back(time_stage(repeat, [&]() {
+        interpreter.load(words);
+        failed = interpreter.run() != RUN_FINISHED;
+    }));
+    if (failed) {
+        std::cerr << workload.name << ": run-time error:" << interpreter.error() << std::endl;
+        return false;
+    }
+    result.executed = interpreter.dispatch_count();
+    return true;
+}
+
+static Json report(const std::vector<Result> &results, int repeat, double scale)
+{
+    Json list = Json::array();
+    for (auto &r: results) {
+        Json stages = Json::object();
+        for (size_t s = 0; s < r.stages.size(); s++) {
+            stages.set(STAGES[s], Json::object().set("median_ms", r.stages[s].first)
+                                                .set("min_ms", r.stages[s].second));
+        }
+        list.push_back(Json::object()
+            .set("name", r.name)
+            .set("lines", r.lines)
+            .set("tokens", r.tokens)
+            .set("instructions", r.instructions)
+            .set("executed", (double)r.executed)
+            .set("stages", stages));
+    }
+    return Json::object().set("repeat", repeat).set("scale", scale).set("workloads", list);
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string usage = "Usage: plbench [--repeat=N] [--scale=X] [--json=file] [workload...]";
+    int repeat = 3;
+    double scale = 1;
+    std::string json_file;
+    std::vector<std::string> chosen;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--repeat=") == 0 && atoi(arg.c_str() + 9) > 0) {
+            repeat = atoi(arg.c_str() + 9);
+        }
+        else if (arg.compare(0, 8, "--scale=") == 0 && atof(arg.c_str() + 8) > 0) {
+            scale = atof(arg.c_str() + 8);
+        }
+        else if (arg.compare(0, 7, "--json=") == 0 && arg.size() > 7) {
+            json_file = arg.substr(7);
+        }
+        else if (arg[0] != '-') {
+            chosen.push_back(arg);
+        }
+        else {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Workload> list;
+    for (auto &w: workloads(scale)) {
+        if (chosen.empty() || std::find(chosen.begin(), chosen.end(), w.name) != chosen.end()) {
+            list.push_back(w);
+        }
+    }
+    if (list.size() < std::max<size_t>(chosen.size(), 1)) {
+        std::cerr << "Workloads are nesting, expressions, arrays, procedures and comments" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(12) << "workload" << std::right << std::setw(8) << "lines"
+              << std::setw(9) << "tokens" << std::setw(9) << "instrs";
+    for (auto stage: STAGES) {
+        std::cout << std::setw(13) << std::string(stage) + " ms";
+    }
+    std::cout << std::endl << std::fixed << std::setprecision(2);
+    std::vector<Result> results;
+    for (auto &w: list) {
+        Result r;
+        if (!run_workload(w, repeat, r)) {
+            return 1;
+        }
+        std::cout << std::left << std::setw(12) << r.name << std::right << std::setw(8) << r.lines
+                  << std::setw(9) << r.tokens << std::setw(9) << r.instructions;
+        for (auto &s: r.stages) {
+            std::cout << std::setw(13) << s.first;
+        }
+        std::cout << std::endl;
+        results.push_back(r);
+    }
+
+    if (!json_file.empty()) {
+        Json json = report(results, repeat, scale);
+        if (json_file == "-") {
+            std::cout << json.dump() << std::endl;
+        }
+        else {
+            std::ofstream out(json_file);
+            out << json.dump() << std::endl;
+            if (!out) {
+                std::cerr << "Failed to write " << json_file << std::endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
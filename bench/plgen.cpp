@@ -0,0 +1,83 @@
+/*  Writes a valid PL program of the size and shape given on the command line, the same for the
+    same options and seed, for testing and timing the compiler on programs larger than the demos.
+    With --errors=N the program has exactly N errors, each of which the parser recovers from
+*/
+
+#include "program_generator.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    const std::string usage =
+        "Usage: plgen [--seed=N] [--procedures=N] [--procedure-depth=N] [--statements=N]\n"
+        "             [--statement-depth=N] [--expression-length=N] [--array-size=N]\n"
+        "             [--trip-count=N] [--comments=N] [--read-write=percent] [--errors=N]\n"
+        "             [-o output-file]";
+    GeneratorOptions options;
+    struct Knob
+    {
+        const char *name;
+        int *value;
+    };
+    const Knob knobs[] = {
+        {"--procedures=", &options.procedures},
+        {"--procedure-depth=", &options.procedure_depth},
+        {"--statements=", &options.statements},
+        {"--statement-depth=", &options.statement_depth},
+        {"--expression-length=", &options.expression_length},
+        {"--array-size=", &options.array_size},
+        {"--trip-count=", &options.trip_count},
+        {"--comments=", &options.comment_lines},
+        {"--read-write=", &options.read_write},
+        {"--errors=", &options.errors}
+    };
+    std::string output_file;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool known = false;
+        for (auto &knob: knobs) {
+            std::string name = knob.name;
+            if (arg.compare(0, name.size(), name) == 0 && arg.size() > name.size()) {
+                *knob.value = atoi(arg.c_str() + name.size());
+                known = true;
+            }
+        }
+        if (known) {
+            continue;
+        }
+        if (arg.compare(0, 7, "--seed=") == 0 && arg.size() > 7) {
+            options.seed = strtoul(arg.c_str() + 7, nullptr, 10);
+        }
+        else if (arg == "-o" && i + 1 < argc) {
+            output_file = argv[++i];
+        }
+        else {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+    }
+
+    std::string program;
+    try {
+        program = ProgramGenerator(options).program();
+    }
+    catch (const std::invalid_argument &e) {
+        std::cerr << "plgen: " << e.what() << std::endl;
+        return 1;
+    }
+    if (output_file.empty()) {
+        std::cout << program;
+        return 0;
+    }
+    std::ofstream out(output_file);
+    out << program;
+    if (!out) {
+        std::cerr << "Failed to write " << output_file << std::endl;
+        return 1;
+    }
+    return 0;
+}
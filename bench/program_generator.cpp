@@ -0,0 +1,336 @@
+#include "program_generator.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+// Assigned values are reduced modulo this, so a sum of thousands of them still fits in a word
+const int MODULUS = 10007;
+
+const char *const COMMENT_WORDS[] = {
+    "sum", "the", "array", "of", "values", "then", "update", "each", "counter", "until", "it",
+    "reaches", "limit", "and", "check", "result", "before", "calling", "next", "procedure"
+};
+
+
+GeneratorOptions::GeneratorOptions():
+    seed(1), procedures(10), procedure_depth(1), statements(10), statement_depth(2),
+    expression_length(4), array_size(100), trip_count(10), comment_lines(0), read_write(0),
+    errors(0) {}
+
+
+ProgramGenerator::ProgramGenerator(const GeneratorOptions &opts): options(opts)
+{
+    options.procedures = std::max(options.procedures, 0);
+    options.procedure_depth = std::max(options.procedure_depth, 0);
+    options.statements = std::max(options.statements, 0);
+    options.statement_depth = std::max(options.statement_depth, 0);
+    options.expression_length = std::max(options.expression_length, 0);
+    options.array_size = std::max(options.array_size, 1);
+    options.trip_count = std::max(options.trip_count, 0);
+    options.comment_lines = std::max(options.comment_lines, 0);
+    options.read_write = std::min(std::max(options.read_write, 0), 100);
+    options.errors = std::max(options.errors, 0);
+}
+
+
+// 64-bit linear congruential generator, using the high bits
+static int draw(unsigned long long &state, int bound)
+{
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return bound > 1 ? (int)((state >> 33) % bound) : 0;
+}
+
+
+std::string ProgramGenerator::program()
+{
+    error_sites.clear();
+    if (options.errors > 0) {
+        // Count the assignments, then choose which of them to replace. Errors are chosen from
+        // their own sequence of numbers, so the rest of the program stays the same
+        write_program();
+        if (assignments < options.errors) {
+            throw std::invalid_argument("the program has only " + std::to_string(assignments) +
+                                        " assignments to put errors in");
+        }
+        unsigned long long choices = options.seed;
+        while ((int)error_sites.size() < options.errors) {
+            int site = draw(choices, assignments);
+            if (!error_sites.count(site)) {
+                error_sites[site] = draw(choices, 5);
+            }
+        }
+    }
+    write_program();
+    return out.str();
+}
+
+
+void ProgramGenerator::write_program()
+{
+    state = options.seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    assignments = 0;
+    out.str("");
+    line(0, "begin");
+    comments(1);
+    line(1, "const SIZE = " + std::to_string(options.array_size) + ";");
+    line(1, "integer g, h, n;");
+    line(1, "Boolean flag;");
+    line(1, "integer array data[SIZE];");
+    std::string previous;
+    for (int p = 1; p <= options.procedures; p++) {
+        std::string name = "p" + std::to_string(p);
+        procedure(name, 1, options.procedure_depth, previous);
+        previous = name;
+    }
+    line(1, "g, h, n := 1, 2, 0;");
+    line(1, "flag := true;");
+    if (!previous.empty()) {
+        line(1, "do n < " + std::to_string(options.trip_count) + " ->");
+        line(2, "call " + previous + ";");
+        line(2, "n := n + 1;");
+        line(1, "od;");
+    }
+    line(1, "write g, h;");
+    line(0, "end.");
+}
+
+
+int ProgramGenerator::next(int bound)
+{
+    return draw(state, bound);
+}
+
+
+void ProgramGenerator::line(int indent, const std::string &text)
+{
+    out << std::string(4 * indent, ' ') << text << '\n';
+}
+
+
+void ProgramGenerator::comments(int indent)
+{
+    for (int i = 0; i < options.comment_lines; i++) {
+        std::string text = "$";
+        for (int words = 3 + next(8); words > 0; words--) {
+            text += ' ';
+            text += COMMENT_WORDS[next(sizeof(COMMENT_WORDS) / sizeof(COMMENT_WORDS[0]))];
+        }
+        line(indent, text);
+    }
+}
+
+
+void ProgramGenerator::procedure(const std::string &name, int level, int depth,
+                                 const std::string &previous)
+{
+    comments(level);
+    line(level, "proc " + name);
+    line(level, "begin");
+    int indent = level + 1;
+    // A loop counter for each level of nested statements
+    std::string locals = "integer s, t";
+    for (int c = 1; c <= std::max(options.statement_depth, 1); c++) {
+        locals += ", c" + std::to_string(c);
+    }
+    line(indent, locals + ";");
+    line(indent, "Boolean b;");
+    std::string nested = name + "_" + std::to_string(level + 1);
+    if (depth > 0) {
+        procedure(nested, level + 1, depth - 1, "");
+    }
+    line(indent, "s, t, b := g, h, flag;");
+    statement_part(indent, options.statements, "");
+    if (depth > 0) {
+        line(indent, "call " + nested + ";");
+    }
+    if (!previous.empty()) {
+        line(indent, "call " + previous + ";");
+    }
+    line(level, "end;");
+}
+
+
+void ProgramGenerator::statement_part(int indent, int count, const std::string &counter)
+{
+    for (int i = 0; i < count; i++) {
+        statement(indent, 0, counter);
+    }
+}
+
+
+void ProgramGenerator::statement(int indent, int depth, const std::string &counter)
+{
+    comments(indent);
+    // No numbers are drawn for read and write statements unless they are asked for, so programs
+    // without them are the same as before they could be generated
+    if (options.read_write > 0 && next(100) < options.read_write) {
+        read_or_write(indent, counter);
+        return;
+    }
+    int kind = next(8);
+    // Nested statements are a single assignment and at most one more if or do statement, so a
+    // block grows linearly with the depth of nesting
+    if (kind >= 5 && depth < options.statement_depth) {
+        std::string loop = "c" + std::to_string(depth + 1);
+        if (kind == 5) {
+            std::string guard = condition(counter);
+            line(indent, "if " + guard + " ->");
+            assignment(indent + 1, counter);
+            statement(indent + 1, depth + 1, counter);
+            line(indent, "[] ~(" + guard + ") ->");
+            assignment(indent + 1, counter);
+            line(indent, "fi;");
+        }
+        else if (kind == 6) {
+            line(indent, loop + " := 1;");
+            line(indent, "do " + loop + " < " + std::to_string(options.trip_count + 1) + " ->");
+            assignment(indent + 1, loop);
+            statement(indent + 1, depth + 1, loop);
+            line(indent + 1, loop + " := " + loop + " + 1;");
+            line(indent, "od;");
+        }
+        else {
+            // Every element of the array
+            line(indent, loop + " := 1;");
+            line(indent, "do ~(" + loop + " > SIZE) ->");
+            line(indent + 1, "data[" + loop + "] := (data[" + loop + "] + " +
+                             expression(options.expression_length, loop) + ") \\ " +
+                             std::to_string(MODULUS) + ";");
+            line(indent + 1, loop + " := " + loop + " + 1;");
+            line(indent, "od;");
+        }
+    }
+    else if (kind == 4) {
+        const char *targets[] = {"b", "flag"};
+        line(indent, std::string(targets[next(2)]) + " := " + condition(counter) + ";");
+    }
+    else {
+        assignment(indent, counter);
+    }
+}
+
+
+void ProgramGenerator::assignment(int indent, const std::string &counter)
+{
+    if (next(10) == 0) {
+        line(indent, "s, t := t, s;");
+        return;
+    }
+    const char *targets[] = {"s", "t", "g", "h"};
+    int target = next(5);
+    std::string variable = target < 4 ? targets[target] : element(counter);
+    std::string value = expression(options.expression_length, counter);
+    std::string reduce = ") \\ " + std::to_string(MODULUS);
+    auto error = error_sites.find(assignments++);
+    if (error == error_sites.end()) {
+        line(indent, variable + " := (" + value + reduce + ";");
+        return;
+    }
+    switch (error->second) {
+        case 0:
+            line(indent, variable + " := (" + value + " + undefined" + std::to_string(error->first) +
+                         reduce + ";");
+            break;
+        case 1:
+            line(indent, variable + " := ~flag;");
+            break;
+        case 2:
+            // Missing the operand of +
+            line(indent, variable + " := (" + value + reduce + " + ;");
+            break;
+        case 3:
+            line(indent, variable + ", s := (" + value + reduce + ";");
+            break;
+        default:
+            line(indent, "call " + variable.substr(0, variable.find('[')) + ";");
+    }
+}
+
+
+void ProgramGenerator::read_or_write(int indent, const std::string &counter)
+{
+    const char *variables[] = {"s", "t", "g", "h"};
+    int kind = next(4);
+    if (kind < 2) {
+        // Values read are reduced as assigned ones are, whatever the input
+        std::string variable = kind == 0 ? variables[next(4)] : element(counter);
+        line(indent, "read " + variable + ";");
+        line(indent, variable + " := " + variable + " \\ " + std::to_string(MODULUS) + ";");
+    }
+    else if (kind == 2) {
+        line(indent, "write " + expression(options.expression_length, counter) + ";");
+    }
+    else {
+        line(indent, std::string("write ") + variables[next(4)] + ", b;");
+    }
+}
+
+
+std::string ProgramGenerator::expression(int length, const std::string &counter)
+{
+    // Operands and operands scaled by a digit, added and subtracted, and expressions in brackets.
+    // Operands are less than MODULUS and nothing else is multiplied, so each term adds at most
+    // 9 * MODULUS
+    std::string text = operand(counter);
+    int left = length;
+    while (left > 0) {
+        int kind = next(6);
+        const char *sign = next(2) ? " + " : " - ";
+        if (kind == 4 && left >= 2) {
+            const char *scale[] = {" * ", " / ", " \\ "};
+            text += sign + operand(counter) + scale[next(3)] + std::to_string(1 + next(9));
+            left -= 2;
+        }
+        else if (kind == 5 && left >= 3) {
+            int inner = 1 + next(std::min(left - 1, 16));
+            text += std::string(sign) + "(" + expression(inner, counter) + ")";
+            left -= inner + 1;
+        }
+        else {
+            text += sign + operand(counter);
+            left--;
+        }
+    }
+    return text;
+}
+
+
+std::string ProgramGenerator::operand(const std::string &counter)
+{
+    int kind = next(7);
+    const char *variables[] = {"s", "t", "g", "h"};
+    if (kind < 4) {
+        return variables[kind];
+    }
+    if (kind == 4) {
+        return std::to_string(next(100));
+    }
+    return element(counter);
+}
+
+
+std::string ProgramGenerator::element(const std::string &counter)
+{
+    // A loop counter is at least 1, so it is always in range reduced modulo the size
+    if (!counter.empty() && next(2)) {
+        return "data[1 + " + counter + " \\ SIZE]";
+    }
+    return "data[" + std::to_string(1 + next(options.array_size)) + "]";
+}
+
+
+std::string ProgramGenerator::condition(const std::string &counter)
+{
+    const char *relations[] = {" < ", " = ", " > "};
+    switch (next(4)) {
+        case 0:
+            return operand(counter) + relations[next(3)] + operand(counter);
+        case 1:
+            return next(2) ? "b" : "~flag";
+        case 2:
+            return "b & " + operand(counter) + relations[next(3)] + std::to_string(next(100));
+        default:
+            return "(" + expression(std::min(options.expression_length, 3), counter) + ")" +
+                   relations[next(3)] + std::to_string(next(1000)) + " | flag";
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef PL_PROGRAM_GENERATOR_H
+#define PL_PROGRAM_GENERATOR_H
+
+#include <map>
+#include <sstream>
+#include <string>
+
+// The shape of a generated program
+struct GeneratorOptions
+{
+    GeneratorOptions();
+
+    // Programs generated with the same options and seed are the same on every platform
+    unsigned seed;
+    // Procedures defined in the program block
+    int procedures;
+    // Levels of procedures nested inside each of them
+    int procedure_depth;
+    // Statements in each block, not counting those nested in if and do statements
+    int statements;
+    // Levels of if and do statements nested inside each other
+    int statement_depth;
+    // Operators in each expression
+    int expression_length;
+    // Length of the global arrays
+    int array_size;
+    // Times each do statement repeats, and the main program calls the last procedure
+    int trip_count;
+    // Comment lines before each statement
+    int comment_lines;
+    // Percentage of statements that are read or write statements
+    int read_write;
+    // Assignments replaced by statements with a single error each, syntax, scope or type
+    int errors;
+};
+
+/*  Writes valid PL programs of any size, built from procedures that each call their nested
+    procedure and the procedure defined before them, and whose statements are assignments to
+    integer and Boolean variables and array elements, if statements, do loops, and read and write
+    statements. Every program compiles without errors and, given a store large enough for it, runs
+    to its end without a run-time error: indices are kept in range, divisors are constants and
+    values are kept small enough not to overflow. With errors,
+    that many assignments chosen at random are replaced by statements the parser reports exactly
+    one error for and recovers from, so the program has exactly that many errors
+*/
+class ProgramGenerator
+{
+public:
+    ProgramGenerator(const GeneratorOptions &opts);
+
+    /*  The text of the program. Throws std::invalid_argument if it has fewer assignments than
+        the errors asked for
+    */
+    std::string program();
+
+private:
+    GeneratorOptions options;
+    unsigned long long state;
+    std::ostringstream out;
+
+    // Assignments written so far, and the kind of error replacing each one that has one
+    int assignments;
+    std::map<int, int> error_sites;
+
+    void write_program();
+
+    // A pseudo-random number from 0 to bound - 1, the same on every platform
+    int next(int bound);
+
+    void line(int indent, const std::string &text);
+    void comments(int indent);
+
+    // Procedure name, defined at level (1 in the program block) with depth levels nested inside
+    void procedure(const std::string &name, int level, int depth, const std::string &previous);
+
+    // Statements of a block whose innermost enclosing loop counter is counter (empty if none)
+    void statement_part(int indent, int count, const std::string &counter);
+    void statement(int indent, int depth, const std::string &counter);
+    void assignment(int indent, const std::string &counter);
+    void read_or_write(int indent, const std::string &counter);
+
+    // Integer expression of the given number of operators
+    std::string expression(int length, const std::string &counter);
+    std::string operand(const std::string &counter);
+    // An element of the global array
+    std::string element(const std::string &counter);
+    std::string condition(const std::string &counter);
+};
+
+#endif
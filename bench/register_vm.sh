@@ -0,0 +1,37 @@
+#!/bin/sh
+# Compare instructions executed and run time of the stack machine and plinterp --reg on the demos
+# and the large bubble sort.
+# Usage: bench/register_vm.sh build_dir [runs]
+BUILD=$(cd "${1:-build}" && pwd)
+RUNS=${2:-5}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PLINTERP=$BUILD/interpreter/plinterp
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# Average us per run of plinterp with the given flags
+time_runs() {
+    start=$(date +%s%N)
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        "$PLINTERP" "$@" prog.plam < "$input" > /dev/null 2>&1
+        i=$((i + 1))
+    done
+    end=$(date +%s%N)
+    echo $(( (end - start) / RUNS / 1000 ))
+}
+
+count() {
+    "$PLINTERP" "$@" --count prog.plam < "$input" 2>/dev/null | sed -n 's/ Instructions executed: //p'
+}
+
+for src in "$ROOT"/bench/*.txt "$ROOT"/demos/*.txt; do
+    name=$(basename "$src" .txt)
+    input="$ROOT/test/demo_inputs/$name.in"
+    [ -f "$input" ] || input=/dev/null
+
+    "$BUILD/src/plc" "$src" -o prog.plam > /dev/null || exit 1
+    echo "$name: stack $(count) instructions $(time_runs) us," \
+         "register $(count --reg) instructions $(time_runs --reg) us"
+done
@@ -0,0 +1,55 @@
+#!/bin/sh
+# Compile time of programs made of each scope test file repeated many times, each copy in its own
+# procedure, so most statements refer to undefined or redefined identifiers. A second plc, such as
+# one built from an earlier commit, can be given to compare against.
+# Usage: bench/scope_lookup.sh build_dir [copies] [other_plc]
+BUILD=$(cd "${1:-build}" && pwd)
+COPIES=${2:-200}
+OTHER=$3
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+for src in "$ROOT"/test/src_files/scope/*; do
+    {
+        echo "begin"
+        i=0
+        while [ $i -lt "$COPIES" ]; do
+            echo "proc p$i"
+            sed -e 's/\$.*//' -e 's/^ *end\. *$/end;/' "$src"
+            # The test files don't end in a newline
+            echo
+            i=$((i + 1))
+        done
+        echo "skip;"
+        echo "end."
+    } > "$(basename "$src").pl"
+done
+
+# Mean us per compile of each program, and the total
+time_compiles() {
+    plc=$1
+    all=0
+    for src in *.pl; do
+        runs=0
+        start=$(date +%s%N)
+        while [ $runs -lt 5 ]; do
+            "$plc" "$src" -o out.plam > /dev/null 2> messages.txt
+            runs=$((runs + 1))
+        done
+        end=$(date +%s%N)
+        errors=$(grep -c '^Error' messages.txt)
+        printf '  %-22s %6d errors %8d us\n' "$src" "$errors" $(( (end - start) / runs / 1000 ))
+        all=$((all + (end - start) / runs / 1000))
+    done
+    printf '  %-22s %6s        %8d us\n' total "" $all
+}
+
+echo "$PLC:"
+time_compiles "$PLC"
+if [ -n "$OTHER" ]; then
+    echo "$OTHER:"
+    time_compiles "$OTHER"
+fi
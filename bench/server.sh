@@ -0,0 +1,63 @@
+#!/bin/sh
+# Latency of compiling the demos with a plc process per file, and with one plc --server reading
+# requests from stdin and from a Unix socket. Socket latency is measured per request by a small
+# perl client, from sending the request to reading the whole response.
+# Usage: bench/server.sh build_dir [rounds]
+BUILD=$(cd "${1:-build}" && pwd)
+ROUNDS=${2:-50}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+i=0
+while [ $i -lt "$ROUNDS" ]; do
+    for src in "$ROOT"/demos/*.txt; do
+        echo "compile $src $(basename "$src" .txt).plam"
+    done
+    i=$((i + 1))
+done > requests.txt
+count=$(wc -l < requests.txt)
+
+start=$(date +%s%N)
+while read -r request src out; do
+    "$PLC" "$src" -o "$out" > /dev/null 2>&1
+done < requests.txt
+end=$(date +%s%N)
+echo "$count separate processes: $(( (end - start) / 1000 / count )) us per file"
+
+start=$(date +%s%N)
+"$PLC" --server < requests.txt > responses.txt
+end=$(date +%s%N)
+echo "--server on stdin: $(( (end - start) / 1000 / count )) us per file," \
+     "$(awk '/^(ok|error) / { n++; t += $2 } END { printf "%d us compiling", t / n }' responses.txt)"
+
+"$PLC" --server="$WORK/plc.sock" &
+server=$!
+perl -MIO::Socket::UNIX -MTime::HiRes=time -e '
+    my ($path, $file) = @ARGV;
+    my $socket;
+    for (1 .. 100) {
+        last if $socket = IO::Socket::UNIX->new(Peer => $path);
+        select(undef, undef, undef, 0.01);
+    }
+    die "could not connect to $path\n" unless $socket;
+    open(my $requests, "<", $file) or die;
+    my @latency;
+    while (my $request = <$requests>) {
+        my $start = time;
+        print $socket $request;
+        my $header = <$socket>;
+        my (undef, undef, $length) = split " ", $header;
+        read($socket, my $messages, $length);
+        push @latency, (time - $start) * 1e6;
+    }
+    print $socket "quit\n";
+    @latency = sort { $a <=> $b } @latency;
+    my $total = 0;
+    $total += $_ for @latency;
+    printf "--server on a socket: %d us mean, %d us median, %d us 99th percentile\n",
+        $total / @latency, $latency[@latency / 2], $latency[int(@latency * 0.99)];
+' "$WORK/plc.sock" requests.txt
+wait $server
@@ -0,0 +1,117 @@
+#!/bin/sh
+# Latency of plc --lsp answering go-to-definition, find-references and hover queries on a program
+# of about 50,000 lines, and of updating it after a single-line edit. Each is the difference in
+# time between a session with the queries or edits and one that only opens the program, divided by
+# their number.
+# Usage: bench/symbol_queries.sh build_dir [procedures] [queries]
+BUILD=$(cd "${1:-build}" && pwd)
+PROCS=${2:-2500}
+QUERIES=${3:-3000}
+PLC=$BUILD/src/plc
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# Procedures reading and changing globals, and calling the one before them
+awk -v n="$PROCS" 'BEGIN {
+    print "begin"
+    print "    integer g, h;"
+    print "    integer array data[10];"
+    for (p = 1; p <= n; p++) {
+        printf "    proc p%d\n    begin\n", p
+        print "        integer i, s;"
+        print "        proc inner"
+        print "        begin"
+        print "            s := s + g;"
+        print "        end;"
+        print "        s := 0;"
+        print "        i := 1;"
+        print "        do i < 11 ->"
+        printf "            data[i] := i * %d;\n", p
+        print "            s := s + data[i];"
+        print "            i := i + 1;"
+        print "        od;"
+        print "        if s > 100 -> g := g + 1;"
+        print "        [] ~(s > 100) -> h := h - 1;"
+        print "        fi;"
+        print "        call inner;"
+        if (p > 1) {
+            printf "        call p%d;\n", p - 1
+        }
+        print "    end;"
+    }
+    printf "    g := 0;\n    call p%d;\n    write g, h;\nend.\n", n
+}' > program.pl
+LINES=$(wc -l < program.pl)
+echo "$PROCS procedures, $LINES lines"
+
+# Write content as a message
+message() {
+    printf 'Content-Length: %d\r\n\r\n%s' "$(printf '%s' "$1" | wc -c)" "$1"
+}
+
+# The program as a JSON string, with the line given as $1, counting from 1, changed
+program_json() {
+    awk -v edit="$1" '{
+        if (NR == edit) {
+            sub(/data\[i\] := i \*/, "data[i] := 2 * i *")
+        }
+        gsub(/\\/, "\\\\")
+        printf "%s\\n", $0
+    }' program.pl
+}
+
+session() {
+    message '{"jsonrpc": "2.0", "id": 0, "method": "initialize", "params": {}}'
+    message "{\"jsonrpc\": \"2.0\", \"method\": \"textDocument/didOpen\", \"params\": {\"textDocument\": {\"uri\": \"file:///program.pl\", \"text\": \"$(program_json 0)\"}}}"
+    cat "$1"
+    message '{"jsonrpc": "2.0", "id": 1, "method": "shutdown"}'
+    message '{"jsonrpc": "2.0", "method": "exit"}'
+}
+
+# Line of proc p$1 counting from 0, for $1 of 2 or more: p1 has 19 lines, the others 20
+proc_line() {
+    echo $(( 22 + ($1 - 2) * 20 ))
+}
+
+# Queries at identifiers spread over the program: a local, a loop variable and a procedure name
+: > none.txt
+: > queries.txt
+i=0
+while [ $i -lt "$QUERIES" ]; do
+    proc=$(proc_line $(( 2 + i * 7919 % (PROCS - 1) )))
+    case $((i % 3)) in
+        0) method=definition; line=$((proc + 5)); char=17 ;;
+        1) method=references; line=$((proc + 8)); char=8 ;;
+        2) method=hover; line=$proc; char=9 ;;
+    esac
+    message "{\"jsonrpc\": \"2.0\", \"id\": $((i + 2)), \"method\": \"textDocument/$method\", \"params\": {\"textDocument\": {\"uri\": \"file:///program.pl\"}, \"position\": {\"line\": $line, \"character\": $char}, \"context\": {\"includeDeclaration\": true}}}" >> queries.txt
+    i=$((i + 1))
+done
+
+EDITS=10
+: > edits.txt
+i=1
+while [ $i -le $EDITS ]; do
+    line=$(( $(proc_line $(( 2 + i * 7919 % (PROCS - 1) ))) + 11 ))
+    message "{\"jsonrpc\": \"2.0\", \"method\": \"textDocument/didChange\", \"params\": {\"textDocument\": {\"uri\": \"file:///program.pl\"}, \"contentChanges\": [{\"text\": \"$(program_json $line)\"}]}}" >> edits.txt
+    i=$((i + 1))
+done
+
+# Microseconds taken by a session with the messages in file
+session_time() {
+    session "$1" > session.txt
+    start=$(date +%s%N)
+    "$PLC" --lsp < session.txt > responses.txt
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000 ))
+}
+
+base=$(session_time none.txt)
+queries=$(session_time queries.txt)
+# Less the answer to initialize
+answered=$(( $(grep -o '"result":[{[]' responses.txt | wc -l) - 1 ))
+edits=$(session_time edits.txt)
+echo "  open: $base us"
+echo "  queries: $(( (queries - base) / QUERIES )) us each ($answered of $QUERIES found a symbol)"
+echo "  single-line edit: $(( (edits - base) / EDITS )) us each"
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Cost of sharing the interpreter between programs: several copies of the large bubble sort run from
+# one manifest on one thread, one after another and then round robin with smaller and smaller time
+# slices. The extra time divided by the number of switches is the cost of each context switch.
+# Usage: bench/time_slice.sh build_dir [copies]
+BUILD=$(cd "${1:-build}" && pwd)
+COPIES=${2:-4}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PLINTERP=$BUILD/interpreter/plinterp
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+"$BUILD/src/plc" "$ROOT/bench/bubble_sort_large.txt" -o prog.plam > /dev/null || exit 1
+i=0
+while [ $i -lt "$COPIES" ]; do
+    echo "prog.plam"
+    i=$((i + 1))
+done > manifest.txt
+
+# Time in us of the whole manifest run, from the report
+run_time() {
+    "$PLINTERP" --manifest -j 1 "$@" manifest.txt > report.txt
+    tail -1 report.txt | sed 's/.* in \([0-9]*\) us.*/\1/'
+}
+
+base=$(run_time)
+echo "one after another: $base us"
+for slice in 100000 10000 1000 100 10; do
+    us=$(run_time --slice "$slice")
+    switches=$(tail -1 report.txt | sed 's/.*, \([0-9]*\) switches/\1/')
+    if [ "$us" -gt "$base" ]; then
+        cost="$(( (us - base) * 1000 / switches )) ns per switch"
+    else
+        cost="no measurable cost"
+    fi
+    echo "--slice $slice: $us us, $switches switches, $cost"
+done
@@ -1,12 +1,12 @@
 #ifndef PL_BLOCK_TABLE_H
 #define PL_BLOCK_TABLE_H
 
-#include <stdexcept>
-#include <map>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 // All of the valid types of identifiers
-enum class PLType 
+enum class PLType : unsigned char
 {
     UNDEFINED     = 0,
     INTEGER       = 1,
@@ -16,30 +16,31 @@ enum class PLType
 
 bool equals(const PLType &lhs, const PLType &rhs);
 
-// Allows scope error messages to be produced by block table and caught in parser
-class scope_error : public std::runtime_error 
-{
-public:
-    scope_error(std::string err_msg): std::runtime_error(err_msg) {}
-};  
-
-// Data stored in individual blocks of block table
+/*  Data stored in individual blocks of block table, packed into 16 bytes. A procedure has a start
+    address and a constant has a value, so the two share a word
+*/
 struct BlockData
 {
-    PLType type;
+    PLType type : 2;
+    bool constant : 1;
+    bool array : 1;
+    int level : 28;     // current block level, set automatically in block table
     int size;           // 1 for regular variables, larger for arrays
-    bool constant;      
     int displacement;   // used for variable access
-    int start_addr;     // label for address of first instruction for procedures 
-    bool array;
-    int value;          // used for constant instructions
-    int level;          // current block level, set automatically in block table
+    union {
+        int value;      // used for constant instructions
+        int start_addr; // label for address of first instruction for procedures 
+    };
 };
 
-// A block maps identifiers to the corresponding data
-typedef std::map<std::string, BlockData> Block;
-
+static_assert(sizeof(BlockData) <= 16, "BlockData should fit in 16 bytes");
 
+/*  The definitions visible at a point in the program. Definitions are kept in one array, in the
+    order they were made, so a block's definitions are freed together when it is removed. Each
+    identifier maps to its innermost definition, which links to the one it shadows, so a lookup takes
+    the same time however deeply blocks are nested. Removing a block undoes its definitions, latest
+    first, making each identifier's innermost definition the one it shadowed again
+*/
 class BlockTable
 {
 public:
@@ -51,17 +52,43 @@ public:
     // Remove a block
     void pop();
 
-    // If id not found throws scope_error
-    BlockData& find(std::string id);
+    /*  The innermost definition of id, or nullptr if it isn't defined. The pointer is valid until the
+        next insert or pop
+    */
+    BlockData *lookup(const std::string &id);
+
+    /*  The innermost definition of id among the first count definitions made in the open blocks,
+        i.e. what lookup gave when there were count of them, or nullptr
+    */
+    const BlockData *lookup(const std::string &id, int count) const;
 
-    // If already exists in same block, throw scope_error
-    void insert(std::string id, BlockData new_block);
+    // Returns false, leaving the block unchanged, if id is already defined in the same block
+    bool insert(const std::string &id, const BlockData &new_block);
+
+    /*  Position of a definition returned by lookup among the definitions of the open blocks. It
+        stays the same until the definition's block is removed
+    */
+    int position(const BlockData *data) const { return data - definitions.data(); }
+
+    // Number of definitions in the open blocks
+    int size() const { return definitions.size(); }
 
     // The level for top block on the stack
     int curr_level;
 
 private:
-    std::vector<Block> table;
+    // Index in definitions of the innermost definition of each identifier, -1 if there is none
+    std::unordered_map<std::string, int> innermost;
+
+    // Definitions in the open blocks
+    std::vector<BlockData> definitions;
+    // For each definition, the index of the definition it shadows, or -1
+    std::vector<int> shadowed;
+    // For each definition, its identifier's entry in innermost
+    std::vector<int *> undo;
+
+    // Number of definitions made before each open block was created
+    std::vector<int> block_starts;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef PL_COMPILE_CACHE_H
+#define PL_COMPILE_CACHE_H
+
+#include "compiler.h"
+#include <atomic>
+#include <iostream>
+#include <string>
+
+// Size limit of a cache directory unless one is given
+const long long DEFAULT_CACHE_SIZE = 64 << 20;
+
+/*  A directory of earlier compilations, each stored in a file named by a hash of the source code,
+    the compiler executable and the compilation settings. An entry holds the output and the
+    messages, including those of a failed compilation, so replaying it is indistinguishable from
+    compiling again. Entries are written to a temporary file and renamed into place, so several
+    processes can share a directory. The hash is not cryptographic, so an entry also holds the
+    settings and source it was compiled from, and one whose name collides is a miss
+*/
+class CompileCache
+{
+public:
+    CompileCache(const std::string &directory, long long max_bytes, const CompilerOptions &options);
+
+    /*  Compile source with compiler, which must have been made with the same options as the cache,
+        or replay the result of an earlier compilation of the same source. Returns true if errors
+        occurred
+    */
+    bool compile(Compiler &compiler, const std::string &source, std::ostream &output, 
+                 std::ostream &out, std::ostream &err);
+
+    /*  Remove the least recently used entries until the directory is within its size limit, and
+        temporary files left for over an hour. A hit counts as a use. Other files in the directory
+        are left alone and don't count towards the limit
+    */
+    void evict();
+
+    long long hits() const { return num_hits; }
+    long long misses() const { return num_misses; }
+
+    // File holding the entry for source, whether or not it exists
+    std::string entry_path(const std::string &source) const;
+
+private:
+    struct Entry
+    {
+        // Settings and source compiled
+        std::string key;
+        bool failed;
+        std::string output;
+        std::string out;
+        std::string err;
+    };
+
+    std::string directory;
+    long long max_bytes;
+    // Compiler version and options, part of every key
+    std::string settings;
+
+    std::atomic<long long> num_hits;
+    std::atomic<long long> num_misses;
+
+    // Settings and source together, which an entry is named by a hash of
+    std::string key_text(const std::string &source) const;
+    // Read the entry at path into entry, if it was compiled from entry.key
+    bool load(const std::string &path, Entry &entry);
+    void save(const std::string &path, const Entry &entry);
+};
+
+#endif
@@ -2,10 +2,46 @@
 #define PL_COMPILER_H
 
 #include <fstream>
+#include <string>
 #include <vector>
 #include "scanner.h"
 #include "parser.h"
+#include "plam.h"
+#include "diagnostics.h"
+#include "procedure_cache.h"
+#include "symbol_index.h"
 #include "symbol_table.h"
+#include "time_report.h"
+
+// Settings for a compilation, taken from the command line
+struct CompilerOptions
+{
+    CompilerOptions();
+
+    // Print the resulting intermediate code to the command line
+    bool debug;
+    // Remove range checks from array accesses that are provably within bounds
+    bool bounds_elim;
+    // Remove unreachable procedures and guarded commands that can never be selected
+    bool dead_code_elim;
+    // Largest procedure, in instructions, whose calls are replaced by its body. 0 disables
+    int inline_limit;
+    // Give the source line of the PLAM code with LINE directives, for plinterp --profile
+    bool line_table;
+    // "plam" for PLAM pseudo-code, "x86-64" for assembly to be linked with the runtime library
+    std::string target;
+    // "text" for messages as they are read on the command line, "json" for a JSON array
+    std::string diagnostics_format;
+    /*  Keep the tokens and the code of procedure bodies between calls to compile, so a program
+        compiled again after an edit only rescans the changed lines and reparses the changed
+        procedures. The output is the same as without
+    */
+    bool incremental;
+    /*  Threads the bodies of the program's procedures are parsed on. Messages and code are the same
+        as with one thread
+    */
+    int procedure_threads;
+};
 
 /*  An administration class that manages each of the separate compilation stages. Responsible for
     creating storing, and calling methods for each of the seperate classes and writing final output
@@ -14,40 +50,110 @@ class Compiler
 {
 public:
     /*  Constructor takes the filepath of the PL source file to be compiled, the output file, and 
-        a flag indicating debug mode
+        the compilation settings
+    */
+    Compiler(std::ifstream &input_file, std::ofstream &output_file, 
+             CompilerOptions opts = CompilerOptions());
+
+    /*  Construct with no files, for compiling any number of programs with compile. The symbol
+        table and parser are kept from one program to the next
     */
-    Compiler(std::ifstream &input_file, std::ofstream &output_file, bool debug=false);
+    Compiler(CompilerOptions opts = CompilerOptions());
 
     // Compile program. Returns true if errors occurred
     bool run();
 
+    // Compile the program read from input, writing the result to output. Returns true if errors occurred
+    bool compile(std::istream &input, std::ostream &output);
+
+    /*  Write messages to out and error messages to err instead of std::cout and std::cerr. Error
+        messages are written together once the program has been compiled
+    */
+    void set_message_streams(std::ostream &out, std::ostream &err);
+
+    // Procedure bodies reused and reparsed by the last compilation, in incremental mode
+    const ProcedureCache &procedures() const { return procedure_cache; }
+
+    /*  Record the definitions and identifiers of each program compiled in index, for queries about
+        it. The index is emptied when the program can't be scanned
+    */
+    void set_symbol_index(SymbolIndex *index);
+
+    // Errors found in the last program compiled
+    const Diagnostics &messages() const { return diagnostics; }
+
+    /*  Measure each phase of compiling into report, and count the tokens, labels and instructions
+        of each program compiled. nullptr measures nothing
+    */
+    void set_time_report(TimeReport *report) { time_report = report; }
+
 private:
     /*  Perform tokenization on the input file. Return false if errors are detected, true otherwise. 
         After 10 errors, scanning is aborted. scanner_output is resized and fileed with results
     */
-    int scan(std::vector<Token> &scanner_output);
+    int scan(Scanner &scanner, std::vector<Token> &scanner_output);
+
+    // Compile as compile does, without writing the error messages
+    bool translate(std::istream &input, std::ostream &output);
+
+    // Parse and optimize the scanned program and write the result to output
+    bool generate(std::vector<Token> &tokens, std::ostream &output);
+
+    /*  Compile as translate does, reusing what is kept from the previous program. Falls back to
+        translate if there are scan errors, so they are reported in the usual way
+    */
+    bool recompile(std::istream &input, std::ostream &output);
 
-    std::ofstream &output;
+    /*  Update tokens for the new source text, scanning only the lines between the longest common
+        prefix and suffix of whole lines shared with the previous text
+    */
+    void rescan(const std::string &text);
+
+    // Files given to the constructor, if any
+    std::istream *input;
+    std::ostream *output;
+    CompilerOptions options;
+
+    // Where messages and error messages are written
+    std::ostream *out;
+    std::ostream *err;
 
     SymbolTable sym_table;
-    Scanner scanner;
     Parser parser;
 
+    // Errors found in the program being compiled
+    Diagnostics diagnostics;
+
     int current_line;
-    int error_count;
     const int MAX_ERRORS = 10;
 
+    /*  Kept between compilations in incremental mode: the previous source, its tokens ending with
+        END_OF_FILE, and for each line the number of tokens it produced and whether any of them
+        was invalid. Lines are ended by newlines, the last one by the end of the text
+    */
+    std::string source;
+    std::vector<Token> tokens;
+    std::vector<int> line_tokens;
+    std::vector<char> line_errors;
+    int error_lines;
+    ProcedureCache procedure_cache;
+
+    // Where symbols are recorded, if anywhere
+    SymbolIndex *symbols;
+    // Where phases are measured, if anywhere
+    TimeReport *time_report;
+
     // Construct the token list for input using. 
-    std::vector<Token> tokenize();
+    std::vector<Token> tokenize(Scanner &scanner);
 
     // Check if the token is one of the invalid types
     bool error_token(Token t);
 
-    // Print an error message for invalid token types
-    void print_error_msg(Token t);
+    // Report an error for invalid token types
+    void report_error(Token t);
 
     // Skip the rest of the current line (until next newline token)
-    void skip_line();
+    void skip_line(Scanner &scanner);
 };
 
 #endif
\ No newline at end of file
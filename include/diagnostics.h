@@ -0,0 +1,104 @@
+#ifndef PL_DIAGNOSTICS_H
+#define PL_DIAGNOSTICS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class Severity
+{
+    ERROR,
+    // Extra information about the error before it, such as where parsing resumed
+    NOTE
+};
+
+// Every kind of message the scanner and parser can report
+enum class DiagnosticCode
+{
+    INVALID_CHARACTER,
+    INVALID_NUMERAL,
+    INVALID_SYMBOL,
+    INVALID_IDENTIFIER,
+    TOO_MANY_ERRORS,
+    EXPECTED_SYMBOL,
+    UNEXPECTED_SYMBOL,
+    UNEXPECTED_EOF,
+    RESUMING,
+    UNDEFINED_IDENTIFIER,
+    REDEFINED_IDENTIFIER,
+    NOT_CONSTANT,
+    ARRAY_BOUND_TYPE,
+    READ_CONSTANT,
+    READ_PROCEDURE,
+    WRITE_PROCEDURE,
+    ASSIGNMENT_COUNT,
+    ASSIGN_CONSTANT,
+    ASSIGN_PROCEDURE,
+    ASSIGNMENT_TYPE,
+    CALL_NON_PROCEDURE,
+    GUARD_TYPE,
+    LOGICAL_OPERAND_TYPE,
+    COMPARISON_OPERAND_TYPE,
+    NEGATE_TYPE,
+    ADDING_OPERAND_TYPE,
+    MULTIPLYING_OPERAND_TYPE,
+    NOT_OPERAND_TYPE,
+    INDEX_TYPE
+};
+
+/*  A message about the program. The text is only made when the message is rendered, from the
+    code's format with {0}, {1}... replaced by args
+*/
+struct Diagnostic
+{
+    Severity severity;
+    int line;
+    int column;
+    DiagnosticCode code;
+    std::vector<std::string> args;
+};
+
+/*  Messages collected over a compilation, in the order they were reported, and written out together
+    once it has finished
+*/
+class Diagnostics
+{
+public:
+    void report(Severity severity, int line, int column, DiagnosticCode code,
+                std::vector<std::string> args = {});
+
+    // Shorthand for reporting an error
+    void error(int line, int column, DiagnosticCode code, std::vector<std::string> args = {});
+
+    // Add the messages of other after these
+    void append(const Diagnostics &other);
+
+    void clear();
+
+    const std::vector<Diagnostic> &records() const { return diagnostics; }
+
+    int error_count() const { return errors; }
+
+    /*  Write the messages as they are read on the command line:
+            Error 1 on line 3: Identifier x is undefined
+            -- Resuming from ; on line 3
+    */
+    void render_text(std::ostream &out) const;
+
+    /*  Write the messages as a JSON array of objects with the fields severity, line, column, code
+        (the name of the code), message and args
+    */
+    void render_json(std::ostream &out) const;
+
+    // The message text of d
+    static std::string message(const Diagnostic &d);
+
+    // The name of code used in JSON, e.g. undefined-identifier
+    static std::string code_name(DiagnosticCode code);
+
+private:
+    std::vector<Diagnostic> diagnostics;
+    int errors = 0;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PL_JSON_H
+#define PL_JSON_H
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Write s as a JSON string, quoted and escaped
+void write_json_string(std::ostream &out, const std::string &s);
+
+/*  A JSON value, as read from and written to JSON-RPC messages. Numbers are kept as doubles, and
+    reading a member or element that isn't there gives null
+*/
+class Json
+{
+public:
+    enum Kind { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Json();
+    Json(bool b);
+    Json(int n);
+    Json(double n);
+    Json(const char *s);
+    Json(const std::string &s);
+
+    static Json array();
+    static Json object();
+
+    /*  Read the JSON value in text into value. Returns false if text isn't a single valid value,
+        leaving value unspecified
+    */
+    static bool parse(const std::string &text, Json &value);
+
+    Kind kind() const { return type; }
+    bool is_null() const { return type == NUL; }
+
+    bool as_bool() const { return boolean; }
+    double as_number() const { return number; }
+    int as_int() const { return (int)number; }
+    const std::string &as_string() const { return text; }
+
+    // The member key of an object, null if there is none
+    const Json &operator[](const std::string &key) const;
+    // Add or replace the member key of an object
+    Json &set(const std::string &key, Json value);
+    bool has(const std::string &key) const;
+
+    // Elements of an array
+    const std::vector<Json> &elements() const { return items; }
+    void push_back(Json value);
+
+    // The value written as JSON on a single line
+    std::string dump() const;
+    void write(std::ostream &out) const;
+
+private:
+    Kind type;
+    bool boolean;
+    double number;
+    std::string text;
+    std::vector<Json> items;
+    // Members of an object in the order they were added
+    std::vector<std::pair<std::string, Json>> members;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PL_LANGUAGE_SERVER_H
+#define PL_LANGUAGE_SERVER_H
+
+#include "compiler.h"
+#include "json.h"
+#include "symbol_index.h"
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+/*  Answers queries about programs being edited, over JSON-RPC on a pair of streams, with the
+    framing and methods of the Language Server Protocol:
+        initialize, shutdown, exit
+        textDocument/didOpen, textDocument/didChange (with the whole text), textDocument/didClose
+        textDocument/definition, textDocument/references, textDocument/hover
+    Each document is compiled incrementally when it is opened or changed, keeping an index of its
+    symbols to answer queries from, and its errors are sent in textDocument/publishDiagnostics
+*/
+class LanguageServer
+{
+public:
+    LanguageServer(CompilerOptions opts = CompilerOptions());
+
+    /*  Answer messages read from in until exit or the end of input. Returns the exit code, 0 if
+        shutdown was requested first
+    */
+    int serve(std::istream &in, std::ostream &out);
+
+private:
+    struct Document
+    {
+        std::unique_ptr<Compiler> compiler;
+        SymbolIndex symbols;
+    };
+
+    CompilerOptions options;
+    std::map<std::string, std::unique_ptr<Document>> documents;
+    bool shut_down;
+
+    /*  Read the content of the next message. Returns false at the end of input. If its
+        Content-Length is missing a number or over 64 MiB, the reason is put in invalid instead
+    */
+    bool read_message(std::istream &in, std::string &content, std::string &invalid);
+
+    void send(std::ostream &out, const Json &message);
+
+    // Answer a request or act on a notification. Returns false on exit
+    bool handle(const Json &message, std::ostream &out);
+
+    // Compile the new text of the document at uri and publish its errors
+    void update(const std::string &uri, const std::string &text, std::ostream &out);
+
+    // The document a request's params refer to, or nullptr if it isn't open
+    Document *document(const Json &params);
+
+    Json definition(const Json &params);
+    Json references(const Json &params);
+    Json hover(const Json &params);
+};
+
+#endif
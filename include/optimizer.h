@@ -0,0 +1,72 @@
+#ifndef PL_OPTIMIZER_H
+#define PL_OPTIMIZER_H
+
+#include "plam.h"
+#include <map>
+#include <set>
+#include <vector>
+
+/*  Transformations applied to the PLAM code produced by the parser, before it is written out. The
+    code is changed in place
+*/
+class Optimizer
+{
+public:
+    Optimizer(std::vector<Instruction> &program);
+
+    /*  Remove guarded commands whose guard is always false, and then every procedure that can no
+        longer be reached by a chain of calls from the main program. Returns the number of
+        instructions removed
+    */
+    int eliminate_dead_code();
+
+    /*  Replace calls to non-recursive procedures of at most limit instructions with a copy of their
+        body. The procedure's variables are moved into the caller's activation record. Returns the
+        number of calls replaced
+    */
+    int inline_procedures(int limit);
+
+private:
+    std::vector<Instruction> &code;
+
+    // The code of the main program (label MAIN) or of a procedure, not counting nested procedures
+    struct Frame
+    {
+        int begin;          // DEFADDR label for procedures, PROG for the main program
+        int body;           // first statement instruction
+        int end;            // ENDPROC or ENDPROG
+        int var_label;      // label whose DEFARG gives the length of the frame's variables
+        std::set<int> calls;
+    };
+    static const int MAIN = 0;
+
+    // Find the main program and every procedure, keyed by the label CALL instructions use
+    std::map<int, Frame> frames();
+
+    // The procedures that can call themselves through some chain of calls
+    std::set<int> recursive_procedures(const std::map<int, Frame> &all);
+
+    /*  Append to out a copy of a procedure body for call, with the procedure's variables starting
+        at var_offset in the caller's frame and fresh labels from next_label
+    */
+    void inline_call(const std::vector<Instruction> &body, const Instruction &call, int var_offset,
+                     int &next_label, std::vector<Instruction> &out);
+
+    void remove_false_guards();
+
+    // Remove the instructions in each range, inclusive. The ranges are in order and don't overlap
+    void erase_ranges(const std::vector<std::pair<int, int>> &ranges);
+
+    void remove_unreachable_procs();
+
+    // Evaluate the guard in code[begin, end) if it only uses constants. Returns false otherwise
+    bool constant_guard(int begin, int end, int &value);
+
+    // Index of the BAR ending the guarded command whose ARROW is at code[arrow]
+    int matching_bar(int arrow);
+
+    // Index of the ENDPROC ending the procedure whose PROC is at code[proc]
+    int matching_endproc(int proc);
+};
+
+#endif
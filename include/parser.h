@@ -2,10 +2,16 @@
 #define PL_PARSER_H
 
 #include "token.h"
+#include "plam.h"
 #include "block_table.h"
+#include "range_analysis.h"
+#include "diagnostics.h"
+#include "procedure_cache.h"
+#include "symbol_index.h"
 #include <vector>
 #include <string>
 #include <fstream>
+#include <ostream>
 #include <map>
 #include <set>
 #include <stdexcept>
@@ -17,12 +23,28 @@ public:
     eof_error(): std::runtime_error("Reached end of file while parsing") {}
 };
 
+// A variable named in a statement, with its definition, or nullptr if it isn't defined
+struct VariableRef
+{
+    std::string id;
+    BlockData *data;
+};
+
+// An identifier in a list of variables being defined, and where it is
+struct DefinedId
+{
+    std::string id;
+    SourceSpan span;
+};
+
 // Recursive descent parser which perform syntax, type and scope checking
 class Parser
 {
 public:
-    // If debug mode is enabled, output is written to command line (as well as to output string)
-    Parser(bool debug=false);
+    /*  If debug mode is enabled, output is written to command line (as well as to output string).
+        With bounds_elim, array accesses that are provably in range skip the run-time check
+    */
+    Parser(bool debug=false, bool bounds_elim=true);
 
     /*  Parse input and verify it can be derived from the PL language grammar.
         Returns the number of errors found, 0 on success. The contents of the resulting PLAM
@@ -30,7 +52,60 @@ public:
     */
     int verify_syntax(std::vector<Token> *input_tokens, std::string &output_program);
 
+    // As above, but the resulting program is stored as a list of instructions
+    int verify_syntax(std::vector<Token> *input_tokens, std::vector<Instruction> &output_program);
+
+    /*  Write debug output to out instead of std::cout, so parsers on different threads don't
+        share a stream
+    */
+    void set_message_stream(std::ostream &out);
+
+    // Errors found by the last call to verify_syntax
+    const Diagnostics &messages() const { return diagnostics; }
+
+    // Labels used by the code of the last call to verify_syntax
+    int labels() const { return label_num - 1; }
+
+    /*  Reuse the code of procedure bodies parsed by earlier calls to verify_syntax, stored in cache,
+        when their tokens and the definitions they use haven't changed. nullptr parses everything
+    */
+    void set_procedure_cache(ProcedureCache *cache);
+
+    /*  Record every definition and every use of one in index, which is cleared by verify_syntax
+        and ready for queries once it returns. nullptr records nothing
+    */
+    void set_symbol_index(SymbolIndex *index);
+
+    /*  Parse the bodies of the program's procedures on this many threads, each on its own, then
+        use their code and messages where they mean the same as in a parse of the whole program.
+        The result is the same as with one thread. Not used with a procedure cache or symbol index
+    */
+    void set_threads(int count);
+
 private:
+    /*  A procedure body of the program block, found by the first pass of a parallel parse, and the
+        result of parsing it on its own. Its scope is the first definitions definitions in the block
+        table of the first pass
+    */
+    struct BodyJob
+    {
+        // Its BEGIN and the matching END
+        std::vector<Token>::iterator first;
+        std::vector<Token>::iterator last;
+        int definitions;
+        int level;
+        int line;
+        int label_base;
+        // False if the body didn't end at last when parsed on its own
+        bool parsed;
+        CachedProcedure entry;
+        /*  Whether it uses other procedures of the program block, whose effects weren't known when
+            it was parsed, and if so the effects of its procedures
+        */
+        bool uses_siblings;
+        std::map<int, ProcedureEffects> effects;
+    };
+
     // Nonterminal follow sets
     std::map<std::string, std::set<Symbol>> follow;
 
@@ -42,20 +117,85 @@ private:
 
     // Always save the last identifier token matched
     Token matched_id;
+    SourceSpan matched_span;
 
-    int num_errors;
+    // Errors are collected here rather than printed as they are found
+    Diagnostics diagnostics;
     int line;
 
     // Next label returned by new_label
     int label_num;
 
-    std::string output;
+    std::vector<Instruction> output;
+    // Where debug output is written
+    std::ostream *out;
     bool debug_mode;
+    bool bounds_elim;
+
+    // Ranges of variables, used to remove unnecessary array bounds checks
+    RangeAnalysis ranges;
+
+    // Shape of the most recently parsed expression, as seen by the range analysis
+    ExprShape shape;
+
+    /*  Accesses left without a range check inside the do loops being parsed, by position in
+        output, with the size and line their check needs if the facts of a loop turn out not to hold
+    */
+    struct UncheckedIndex
+    {
+        size_t position;
+        int size;
+        int line;
+    };
+    std::vector<UncheckedIndex> unchecked;
+    int loop_depth;
+
+    // Code of procedure bodies from earlier programs, if set
+    ProcedureCache *procedures;
+
+    // Where definitions and their uses are recorded, if set
+    SymbolIndex *symbols;
+    // The symbol recorded for each definition in the block table, by position
+    std::vector<int> symbol_of;
+
+    // Threads procedure bodies are parsed on
+    int threads;
+    // Where bodies found by the first pass of a parallel parse are added, while it runs
+    std::vector<BodyJob> *plan;
+    // The bodies parsed by the second pass, and the next one to be reached by the last
+    std::vector<BodyJob> *planned;
+    size_t next_planned;
+
+    // Start parsing input_tokens from the beginning, with no definitions and no code
+    void start(std::vector<Token> *input_tokens);
+
+    /*  Find the procedure bodies of the program block, without parsing them, and parse each on its
+        own on the thread pool. Bodies using other procedures of the block are parsed twice: first
+        to find what each procedure changes itself and calls, then with the complete modification
+        sets of the procedures they use, worked out from the first
+    */
+    void parse_bodies(std::vector<BodyJob> &bodies);
+
+    /*  Parse body with the definitions it has in scope, from the block table of the first pass.
+        siblings holds the modification sets of the other procedures of the block, by label; the
+        effects of those missing from it are deferred. Returns false if the body doesn't end at its
+        END
+    */
+    bool parse_body(const BlockTable &scope, const std::map<int, ModSet> &siblings, BodyJob &body);
+
+    /*  Work out the modification set of the procedure label in body from the effects found by
+        parsing it, with the sets of the procedures of the block in siblings. Sets already worked
+        out are kept in complete, and the procedures being worked out in open, whose effects on
+        their callers are unknown as in a recursive call. Returns false if a procedure called has
+        no known set
+    */
+    bool complete_mods(const BodyJob &body, int label, const std::map<int, ModSet> &siblings,
+                       std::map<int, ModSet> &complete, std::set<int> &open);
 
     // Produce labels to be used by assembler
     int new_label();
 
-    // Write PLAM instruction and agruments to output string
+    // Write PLAM instruction and agruments to output string, for the current line
     void emit(std::string instr, std::vector<int> args = {});
 
     // Move to next character in input. Throw eof_error if EOF reached
@@ -67,10 +207,10 @@ private:
     // Check next token in input and advance if symbol matches s
     void match(Symbol s, std::string nonterminal);
 
-    // Print error number and line on which error occurred
-    void error_preamble();
+    // Report an error at the lookahead token
+    void error(DiagnosticCode code, std::vector<std::string> args = {});
 
-    // Creates a new variables and catches any scope errors that might occur
+    // Creates a new variables and catches any scope errors that might occur. span is where id is
     void define_var(
         std::string id,
         PLType type,
@@ -79,11 +219,20 @@ private:
         bool constant,
         bool array,
         int displacement,
-        int start_addr
+        int start_addr,
+        const SourceSpan &span
     );
 
-    // Produce error message for type error
-    void type_error(std::string err_mgs);
+    // Record a use of the definition data, if it is defined, at the last identifier matched
+    void note_reference(const BlockData *data);
+
+    // If data is the definition of a scalar variable store its key and return true
+    bool scalar_var(const BlockData *data, VarKey &key);
+
+    /*  Scan ahead over the body of the do statement starting at next_token to find the variables
+        it changes, before any code for it is generated
+    */
+    LoopSummary loop_summary();
 
     // Produce error message and call synchronize to attempt to recover
     void syntax_error(std::string nonterm);
@@ -121,12 +270,54 @@ private:
     PLType type_symbol();
 
     // var_list is filled with the identifiers of variables
-    void variable_list(std::vector<std::string> &var_list);
+    void variable_list(std::vector<DefinedId> &var_list);
 
-    void variable_list_end(std::vector<std::string> &var_list);
+    void variable_list_end(std::vector<DefinedId> &var_list);
 
     void procedure_definition();
 
+    // Parse a procedure body at next_token, given the labels of the procedure and its block
+    void procedure_body(int proc_label, int var_label, int start_label);
+
+    /*  The cache entry for the procedure body just parsed from body_start to body_end, whose code
+        starts at code_start and whose messages start at messages_start
+    */
+    CachedProcedure procedure_entry(int proc_label, int body_line, std::vector<Token>::iterator body_start,
+                                    std::vector<Token>::iterator body_end, size_t code_start,
+                                    size_t messages_start);
+
+    // Move past the body from next_token to its END at body_end, which has newlines newlines
+    void skip_body(std::vector<Token>::iterator body_end, int newlines);
+
+    // The END matching the BEGIN at next_token, or the END_OF_FILE token if there is none
+    std::vector<Token>::iterator block_end() const;
+
+    // What id refers to at this point in the program
+    Binding binding(const std::string &id) const;
+
+    // The bindings of the distinct identifiers from next_token to last
+    std::vector<Binding> bindings(std::vector<Token>::iterator last) const;
+
+    /*  True if the cached use still binds its identifier to the same definition. The labels of
+        procedures it refers to are mapped from their old to their new values in labels
+    */
+    bool same_binding(const Binding &use, std::map<int, int> &labels) const;
+
+    /*  Emit the cached code for the procedure body from next_token to body_end, whose tokens hash
+        to key, and move past it. label_base is the procedure's first label. Returns false,
+        without changing anything, if no entry matches
+    */
+    bool reuse_procedure(unsigned long long key, int label_base,
+                         std::vector<Token>::iterator body_end);
+
+    /*  Emit the code and messages of entry for the procedure body from next_token to body_end, and
+        move past it, as reuse_procedure does. Returns false, without changing anything, if the
+        entry was parsed at another level or with other bindings. With take, the code is moved out
+        of an entry that won't be used again rather than copied
+    */
+    bool splice_procedure(CachedProcedure &entry, int label_base,
+                          std::vector<Token>::iterator body_end, bool take);
+
     void statement_part();
 
     void statement();
@@ -135,17 +326,17 @@ private:
 
     void read_statement();
 
-    // Vars filled with identifiers found in access list
-    void variable_access_list(std::vector<std::string> &vars); 
+    // Vars filled with the variables found in access list
+    void variable_access_list(std::vector<VariableRef> &vars); 
 
-    void variable_access_list_end(std::vector<std::string> &vars);
+    void variable_access_list_end(std::vector<VariableRef> &vars);
 
     void write_statement();
 
-    // Store types of each expression in list in types
-    void expression_list(std::vector<PLType> &types);
+    // Store types and shapes of each expression in list in types and shapes
+    void expression_list(std::vector<PLType> &types, std::vector<ExprShape> &shapes);
 
-    void expression_list_end(std::vector<PLType> &types);
+    void expression_list_end(std::vector<PLType> &types, std::vector<ExprShape> &shapes);
 
     void assignment_statement();
 
@@ -191,12 +382,15 @@ private:
 
     PLType factor();
 
-    // Return the identifier of the variable
-    std::string variable_access();
+    /*  Store the identifier of the variable in id and return its definition, or nullptr if it is
+        undefined. A caller that has already looked up the identifier passes its definition as data
+    */
+    BlockData *variable_access(std::string &id, BlockData *data = nullptr);
 
-    void variable_access_end();
+    // data is the definition of the variable accessed, nullptr if it is undefined
+    void variable_access_end(const BlockData *data);
 
-    void indexed_selector();
+    void indexed_selector(const BlockData *data);
 
     // Return type of constant (bool or int). Value of constant stored in value
     PLType constant(int &value);
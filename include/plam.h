@@ -0,0 +1,22 @@
+#ifndef PL_PLAM_H
+#define PL_PLAM_H
+
+#include <string>
+#include <vector>
+
+// A single PLAM pseudo-instruction with its arguments, as read by the assembler
+struct Instruction
+{
+    std::string op;
+    std::vector<int> args;
+    // Source line of the code it was generated for, or 0 if not known
+    int line;
+};
+
+/*  Write out instructions in the textual format read by the assembler, one per line. With
+    line_table, a LINE directive giving the source line comes before each instruction whose line
+    differs from the one before it, for profiling by source line
+*/
+std::string plam_text(const std::vector<Instruction> &code, bool line_table = false);
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef PL_PROCEDURE_CACHE_H
+#define PL_PROCEDURE_CACHE_H
+
+#include "token.h"
+#include "plam.h"
+#include "block_table.h"
+#include "range_analysis.h"
+#include "symbol_index.h"
+#include "diagnostics.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What an identifier used in a procedure body referred to where the procedure was defined
+struct Binding
+{
+    std::string id;
+    bool defined;
+    BlockData data;
+    // For procedures, whether the modification set was known, i.e. the call wasn't recursive
+    bool mods_known;
+    ModSet mods;
+};
+
+/*  The code generated for a procedure body, from its DEFADDR to its ENDPROC. It can be used again
+    wherever the same tokens are parsed at the same level with the same bindings, once its labels
+    and line numbers are moved to where it is spliced in
+*/
+struct CachedProcedure
+{
+    // The body's tokens, from its begin to its end
+    std::vector<Token> tokens;
+    int level;
+    std::vector<Binding> uses;
+    // Labels label_base onwards belong to the procedure and the procedures nested in it
+    int label_base;
+    int label_count;
+    // Line of the body's begin, and the number of lines from there to its end
+    int line;
+    int newlines;
+    std::vector<Instruction> code;
+    // Modification sets of the procedure and its nested procedures, by label
+    std::map<int, ModSet> mods;
+    // Messages reported in the body. The procedure cache only keeps bodies without any
+    std::vector<Diagnostic> messages;
+    /*  Definitions and occurrences recorded in the body, if the parser had a symbol index. An
+        occurrence's definition counts from the body's first, or from -1 down for the identifiers
+        defined outside it, in outer_ids
+    */
+    bool has_symbols;
+    std::vector<SymbolDefinition> symbol_defs;
+    std::vector<Occurrence> symbol_uses;
+    std::vector<std::string> outer_ids;
+    // Last compilation the entry was used in
+    unsigned generation;
+};
+
+/*  Procedure bodies from previous compilations, keyed by a hash of their tokens, for recompiling a
+    program after small edits. Since different bodies can hash alike, an entry is only found for
+    the tokens it was stored with. Entries that go unused for a whole compilation are dropped
+*/
+class ProcedureCache
+{
+public:
+    ProcedureCache();
+
+    // Hash of the tokens first to last, inclusive
+    static unsigned long long key(std::vector<Token>::const_iterator first,
+                                  std::vector<Token>::const_iterator last);
+
+    // Start a compilation, dropping the entries the previous one didn't use
+    void next_generation();
+
+    /*  Entries stored under key for exactly the tokens first to last, inclusive. Callers mark the
+        one they reuse with use
+    */
+    std::vector<CachedProcedure *> find(unsigned long long key,
+                                        std::vector<Token>::const_iterator first,
+                                        std::vector<Token>::const_iterator last);
+
+    void use(CachedProcedure &entry);
+
+    void store(unsigned long long key, CachedProcedure entry);
+
+    // Procedure bodies reused and parsed in the current compilation
+    int hits() const { return num_hits; }
+    int misses() const { return num_misses; }
+
+    void miss() { num_misses++; }
+
+    // Drop every entry
+    void clear();
+
+private:
+    std::unordered_map<unsigned long long, std::vector<CachedProcedure>> entries;
+    unsigned generation;
+    int num_hits;
+    int num_misses;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef PL_RANGE_ANALYSIS_H
+#define PL_RANGE_ANALYSIS_H
+
+#include "symbol.h"
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+
+// A scalar variable, identified by the absolute block level it is defined in and its displacement
+typedef std::pair<int, int> VarKey;
+
+// Closed interval of values a variable is known to hold. Unbounded sides use RANGE_INF
+struct Range
+{
+    long long lo;
+    long long hi;
+};
+
+const long long RANGE_INF = 1LL << 40;
+
+// Known ranges of scalar variables at the current point in the program
+typedef std::map<VarKey, Range> Facts;
+
+/*  Summary of an expression as far as the range analysis can tell. LINEAR expressions are of the
+    form var + value. A CONDITION is a conjunction of ranges that hold whenever it evaluates to true.
+    It is exact if the ranges also hold only then, so that its negation can be taken
+*/
+struct ExprShape
+{
+    enum Kind { OTHER, CONSTANT, LINEAR, CONDITION };
+
+    Kind kind;
+    int value;
+    VarKey var;
+    std::vector<std::pair<VarKey, Range>> conjuncts;
+    bool exact;
+
+    static ExprShape other();
+    static ExprShape constant(int value);
+    static ExprShape linear(VarKey var, int offset = 0);
+
+    // Shape of lhs op rhs for the operators +, -, *, / and \, and of the negation -operand
+    static ExprShape arithmetic(const ExprShape &lhs, Symbol op, const ExprShape &rhs);
+    static ExprShape negative(const ExprShape &operand);
+
+    // Shape of lhs op rhs for the operators <, =, >
+    static ExprShape compare(const ExprShape &lhs, Symbol op, const ExprShape &rhs);
+
+    // Shape of lhs & rhs, and ~operand for Boolean expressions
+    static ExprShape conjoin(const ExprShape &lhs, const ExprShape &rhs);
+    static ExprShape logical_not(const ExprShape &operand);
+};
+
+// How a do loop changes a variable, as found by scanning its body before it is parsed
+enum class LoopEffect
+{
+    INCREASING,     // only ever incremented by a non-negative constant, if it doesn't wrap around
+    DECREASING,     // only ever decremented by a non-negative constant, if it doesn't wrap around
+    CHANGED
+};
+
+struct LoopSummary
+{
+    std::map<VarKey, LoopEffect> effects;
+    // Set when the body calls a procedure whose effects are not yet known, i.e. a recursive call
+    bool changes_all;
+};
+
+// The variables a procedure may assign to, including through the procedures it calls
+struct ModSet
+{
+    std::set<VarKey> vars;
+    bool all;
+};
+
+/*  What a procedure changes itself, and the procedures it calls with the levels they are defined
+    in, from which its modification set can be worked out once theirs are known
+*/
+struct ProcedureEffects
+{
+    std::set<VarKey> own;
+    std::vector<std::pair<int, int>> calls;
+};
+
+/*  Tracks the ranges of scalar variables while the parser generates code, so that array accesses
+    whose index is provably within bounds can skip the run-time range check. The parser reports
+    assignments, reads, calls and the structure of guarded commands as it goes. Loops are handled
+    using a summary of the variables their body changes, computed before the body is parsed
+*/
+class RangeAnalysis
+{
+public:
+    RangeAnalysis();
+
+    // Procedure bodies start with no known facts
+    void enter_procedure();
+    void exit_procedure(int proc_label);
+
+    // Record the modification set of a procedure whose body was not parsed, as exit_procedure does
+    void add_procedure(int proc_label, const ModSet &mods);
+
+    // Modification sets of the procedures parsed so far, keyed by label
+    const std::map<int, ModSet> &procedures() const { return proc_mods; }
+
+    /*  Treat the procedures with these labels as having bodies parsed elsewhere, whose effects are
+        not known yet. A call to one forgets every fact but adds nothing to the caller's
+        modification set, so the effects of each procedure parsed from then on are also kept
+    */
+    void defer(const std::set<int> &proc_labels);
+
+    // Effects of the procedures parsed since defer was called, keyed by label
+    const std::map<int, ProcedureEffects> &effects() const { return proc_effects; }
+
+    // Multiple assignment; all values are computed from the ranges before any variable changes
+    void assign(const std::vector<std::pair<VarKey, ExprShape>> &assignments);
+
+    // Variable changed to an unknown value, e.g. by a read statement
+    void clobber(VarKey var);
+
+    // Forget everything the called procedure might change. def_level is the level it is defined in
+    void call(int proc_label, int def_level);
+
+    /*  Fill mods with the variables visible to callers that the procedure may change. Returns false
+        if its body has not been completely parsed yet, i.e. for a recursive call
+    */
+    bool modifications(int proc_label, int def_level, ModSet &mods) const;
+
+    // Guarded command constructs. Each guard starts from the facts on entry to the construct
+    void begin_if();
+    void begin_do(const LoopSummary &summary);
+    void begin_guard();
+    void assume(const ExprShape &guard);
+    void end_guard();
+    void end_if();
+
+    /*  Returns false if a variable the loop was taken to only increase or decrease may have
+        wrapped around, as an increment wasn't known to stay within the int range. Accesses the
+        loop's facts found to be in bounds must then keep their range checks
+    */
+    bool end_do();
+
+    // True if an index with the given shape is always within 1..size
+    bool in_bounds(const ExprShape &index, int size) const;
+
+private:
+    struct Construct
+    {
+        Facts entry;
+        std::vector<Facts> exits;
+        // For do loops, the variables taken to only increase or decrease, and whether one may not
+        std::map<VarKey, LoopEffect> monotonic;
+        bool wrapped;
+    };
+
+    Facts facts;
+    std::vector<Construct> constructs;
+
+    // Modification sets of the procedures currently being parsed, innermost last
+    std::vector<ModSet> open_procs;
+    std::map<int, ModSet> proc_mods;
+
+    // Procedures whose effects are not known yet, and the effects of those being parsed, if any
+    std::set<int> deferred;
+    std::vector<ProcedureEffects> open_effects;
+    std::map<int, ProcedureEffects> proc_effects;
+
+    void modified(VarKey var);
+    void modified_all();
+
+    // Note whether an assignment to var keeps the loops taking it to be monotonic right
+    void check_monotonic(VarKey var, const ExprShape &value, bool bounded);
+};
+
+#endif
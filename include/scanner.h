@@ -13,7 +13,7 @@ public:
     /*  Construct a scanner which will read from the given input stream and store identifiers in 
         the given symbol table
     */
-    Scanner(std::ifstream &program_file, SymbolTable &symbol_table);
+    Scanner(std::istream &program_file, SymbolTable &symbol_table);
 
     // Return the next token in input
     Token get_token(); 
@@ -26,6 +26,14 @@ private:
     std::istream_iterator<char> next_char;
     // End of stream iterator
     std::istream_iterator<char> eos_iter;
+    // Column of next_char on its line, counting from 1
+    int column;
+
+    // Construct the token starting at next_char, after any white space and comment
+    Token scan_token();
+
+    // Move next_char to the following character, keeping track of the column
+    void advance();
 
     // 3 Character types    
     bool letter(char c);
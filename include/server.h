@@ -0,0 +1,45 @@
+#ifndef PL_SERVER_H
+#define PL_SERVER_H
+
+#include "compiler.h"
+#include <iostream>
+#include <string>
+
+/*  A long-lived compiler, for tools that compile many programs. Requests are read one per line:
+        compile src_file output_file        compile a file
+        source output_file length           compile the length bytes following the line
+        quit                                stop the server
+    File names can't contain spaces, and a source request can send at most 64 MiB, or the
+    server stops reading that input. Each request is answered with a line
+        ok|error microseconds length
+    followed by the length bytes of messages the compiler printed, where microseconds is the time
+    from reading the request to writing the output file. The symbol table's reserved words and the
+    parser's follow sets are built once, for every request
+*/
+class CompileServer
+{
+public:
+    CompileServer(CompilerOptions opts = CompilerOptions());
+
+    // Answer requests read from in until the end of input or quit
+    void serve(std::istream &in, std::ostream &out);
+
+    /*  Listen on a Unix socket at path, answering the requests of one client at a time until one
+        sends quit. A socket already at path is replaced. Returns false if the socket can't be
+        created or path is some other file
+    */
+    bool listen(const std::string &path);
+
+private:
+    Compiler compiler;
+
+    // Set by a quit request
+    bool stopped;
+
+    // Answer one request. Returns false at the end of input or after quit
+    bool handle(std::istream &in, std::ostream &out);
+
+    void respond(std::ostream &out, bool failed, long long microseconds, const std::string &messages);
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef PL_SYMBOL_INDEX_H
+#define PL_SYMBOL_INDEX_H
+
+#include "block_table.h"
+#include <string>
+#include <vector>
+
+// Where an identifier appears: its line and column, counting from 1, and its length
+struct SourceSpan
+{
+    int line;
+    int column;
+    int length;
+};
+
+// An identifier's definition, with its type, level and displacement as the parser saw them
+struct SymbolDefinition
+{
+    std::string id;
+    SourceSpan span;
+    BlockData data;
+};
+
+// A place a definition's identifier appears, where it is defined or where it is used
+struct Occurrence
+{
+    SourceSpan span;
+    int definition;
+    bool is_definition;
+};
+
+/*  The definitions of a program and every use of them, kept after it has been parsed, when the
+    block table has forgotten them. Occurrences are recorded as the parser reaches them and ordered
+    once parsing finishes: by position, for finding the identifier at a line and column by binary
+    search, and grouped by definition, for listing its references
+*/
+class SymbolIndex
+{
+public:
+    SymbolIndex();
+
+    // Forget the previous program
+    void clear();
+
+    // Record a definition at span, returning its number
+    int define(const std::string &id, const SourceSpan &span, const BlockData &data);
+
+    // Record a use of a definition at span
+    void reference(const SourceSpan &span, int definition);
+
+    // Called once the program has been parsed, before any of the queries below
+    void finish();
+
+    // The definition whose identifier is at line and column, or -1 if there is none
+    int find(int line, int column) const;
+
+    const SymbolDefinition &definition(int symbol) const { return definitions[symbol]; }
+
+    // Every place symbol appears in the program, its definition included, in order
+    std::vector<SourceSpan> occurrences(int symbol) const;
+
+    /*  A description of symbol as it would be written in its definition, followed by its level and
+        displacement, e.g.
+            integer array a[10]
+            level 1, displacement 3
+    */
+    std::string describe(int symbol) const;
+
+    // Everything recorded, in the order it was recorded before finish
+    const std::vector<SymbolDefinition> &all_definitions() const { return definitions; }
+    const std::vector<Occurrence> &all_occurrences() const { return by_position; }
+
+private:
+    std::vector<SymbolDefinition> definitions;
+
+    std::vector<Occurrence> by_position;
+
+    // Indices in by_position of the occurrences of each definition, from by_definition_start[d]
+    std::vector<int> by_definition;
+    std::vector<int> by_definition_start;
+};
+
+#endif
@@ -35,10 +35,15 @@ public:
     */
     void insert(Token token);
 
+    // Remove every entry apart from the reserved words, ready for another program
+    void reset();
+
 private:
     std::vector<token_ptr> tok_table;
     // The number of elements currently in the table
     int used;
+    // Slots of the reserved words in a table of the initial size
+    std::vector<int> keyword_slots;
 
     // The hash function. Linear probing is used for collisions.
     int hash_fn(std::string key);
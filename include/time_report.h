@@ -0,0 +1,80 @@
+#ifndef PL_TIME_REPORT_H
+#define PL_TIME_REPORT_H
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*  Heap allocations, counted by plc's replacement operator new and delete (allocation_counter.cpp)
+    once enabled. In programs that don't link them in, every count stays 0
+*/
+class HeapCounters
+{
+public:
+    // Start counting. Called before any phase is measured, as memory freed later is subtracted
+    static void enable() { on.store(true); }
+    static bool enabled() { return on.load(std::memory_order_relaxed); }
+
+    static void allocated(long long bytes);
+    static void freed(long long bytes);
+
+    // Start the next peak from the bytes in use now
+    static void reset_peak();
+
+    static long long allocations() { return count.load(std::memory_order_relaxed); }
+    static long long allocated_bytes() { return total.load(std::memory_order_relaxed); }
+    static long long peak_bytes() { return peak.load(std::memory_order_relaxed); }
+
+private:
+    static std::atomic<bool> on;
+    static std::atomic<long long> count, total, live, peak;
+};
+
+/*  Wall time, CPU time, memory and allocations of each phase of compiling a program, and counts of
+    what it produced, for plc --time-report. Phases are measured by a Scope for the time it exists,
+    and one measured more than once, as scanning is by incremental compilation falling back to a
+    full scan, is added up
+*/
+class TimeReport
+{
+public:
+    // Measures the phase from construction to destruction, or nothing if report is null
+    class Scope
+    {
+    public:
+        Scope(TimeReport *report, const std::string &phase);
+        ~Scope();
+
+    private:
+        TimeReport *report;
+        std::string phase;
+        double wall, cpu;
+        long long allocations, bytes;
+    };
+
+    // Add n to the count called name, such as the number of tokens
+    void count(const std::string &name, long long n);
+
+    // A table of the phases in the order they were first measured, then the counts
+    void write(std::ostream &out) const;
+
+private:
+    struct Phase
+    {
+        std::string name;
+        double wall_ms, cpu_ms;
+        // Largest resident set of the process by the end of the phase, and most bytes in use on
+        // the heap during it
+        long long peak_rss_kb, peak_heap;
+        long long allocations, bytes;
+    };
+
+    std::vector<Phase> phases;
+    std::vector<std::pair<std::string, long long>> counts;
+
+    Phase &phase(const std::string &name);
+};
+
+#endif
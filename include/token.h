@@ -19,6 +19,8 @@ public:
     Symbol symbol;
     std::string lexeme;
     int value;
+    // Column of the first character of the token on its line, counting from 1
+    int column;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef PL_WORK_POOL_H
+#define PL_WORK_POOL_H
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/*  Runs a list of independent jobs on a fixed number of threads. Jobs are dealt out to the threads
+    in turn; each thread takes jobs from the back of its own queue, and when that is empty steals
+    from the front of another thread's queue, so uneven jobs still keep every thread busy
+*/
+class WorkPool
+{
+public:
+    WorkPool(int threads);
+
+    // Run every job and wait for all of them to finish. The calling thread is one of the workers
+    void run(const std::vector<std::function<void()>> &jobs);
+
+    int size() const { return num_threads; }
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+
+    int num_threads;
+
+    // Take the next job for thread self, its own or stolen. Returns false when there are none left
+    bool next_job(std::vector<Queue> &queues, int self, size_t &job);
+
+    void work(const std::vector<std::function<void()>> &jobs, std::vector<Queue> &queues, int self);
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PL_X86_BACKEND_H
+#define PL_X86_BACKEND_H
+
+#include "plam.h"
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Number of words in the store of a native program, shared by variables and the expression stack
+const int NATIVE_STORE_SIZE = 1 << 16;
+
+/*  Translates PLAM code into x86-64 assembly (GNU as syntax) for a function pl_main, to be linked
+    with the runtime in runtime/plrt.c. The PLAM store is kept as a global array of words with the
+    base and stack registers held in rbx and r12, so activation records have the same layout as in
+    the interpreter. Procedure calls use the machine call/ret instructions for return addresses
+*/
+class X86Backend
+{
+public:
+    X86Backend(const std::vector<Instruction> &program);
+
+    // Return the complete assembly file
+    std::string assembly();
+
+private:
+    const std::vector<Instruction> &code;
+
+    // Values of DEFARG labels, i.e. variable lengths of blocks
+    std::map<int, int> args;
+
+    std::ostringstream out;
+
+    // Out of line code for range errors, emitted after the function body
+    std::ostringstream error_stubs;
+    int num_stubs;
+
+    // Write one instruction of assembly
+    void asm_line(const std::string &line);
+
+    // Load into rax the base of the activation record reached by following level static links
+    void frame_base(int level);
+
+    void translate(const Instruction &instr);
+
+    // Pop the right operand into eax, leaving the left operand's store slot as the stack top
+    void pop_operand();
+
+    // Replace the two operands on top of the stack by the result of a comparison
+    void comparison(const std::string &set_instr);
+};
+
+#endif
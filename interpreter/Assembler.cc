@@ -19,20 +19,42 @@ Assembler::Assembler(istream &in, ostream &out)
 Assembler::~Assembler()
 { }
 
+// Look up a label, noting an error if it is out of range.
+int Assembler::address(int label)
+{
+   if (label < 0 || label >= MAXLABEL) {
+      message = "label " + to_string(label) + " out of range";
+      return 0;
+   }
+   return labelTable[label];
+}
+
 // The first pass of the assmebler.  This just builds the labelTable.
 // Don't translate just yet.
 void Assembler::firstPass()
 {
    // Start at address 0 (not 1 as I had previously thought)
    currentAddress = 0;
+   int line = 0;
+   lineTable.clear();
    string nextop;
    (*insource) >> nextop;
    // Loop until we find the ENDPROG operation.
    for (;;) {
+      // The words of the last instruction belong to the line before it.
+      lineTable.resize(currentAddress, line);
+      if (!(*insource)) {
+	 message = "program has no ENDPROG";
+	 return;
+      }
       // Record the current address in the label table.
       if (nextop == "DEFADDR") {
 	 int index;
 	 (*insource) >> index;
+	 if (index < 0 || index >= MAXLABEL) {
+	    message = "label " + to_string(index) + " out of range";
+	    return;
+	 }
 	 labelTable[index] = currentAddress;
 	 (*insource) >> nextop;
       }
@@ -40,12 +62,23 @@ void Assembler::firstPass()
       else if (nextop == "DEFARG") {
 	 int index, value;
 	 (*insource) >> index >> value;
+	 if (index < 0 || index >= MAXLABEL) {
+	    message = "label " + to_string(index) + " out of range";
+	    return;
+	 }
 	 labelTable[index] = value;
 	 (*insource) >> nextop;
       }
+      // Note the source line of the instructions that follow.
+      else if (nextop == "LINE") {
+	 (*insource) >> line;
+	 (*insource) >> nextop;
+      }
       // Stop when we find ENDPROG.
-      else if (nextop == "ENDPROG")
+      else if (nextop == "ENDPROG") {
+	 lineTable.push_back(line);
 	 return;
+      }
       else if (nextop == "ARROW" || nextop == "ASSIGN" || nextop == "BAR" ||
 	       nextop == "CONSTANT" || nextop == "FI" || nextop == "READ" ||
 	       nextop == "WRITE") {
@@ -92,7 +125,7 @@ void Assembler::secondPass()
 	 int temp;
 	 (*insource) >> temp;
 	 // Output the absolute jump address.
-	 (*outsource) << labelTable[temp] << endl;
+	 (*outsource) << address(temp) << endl;
 	 currentAddress += 2;
       }
       else if (nextop == "ASSIGN") {
@@ -106,7 +139,7 @@ void Assembler::secondPass()
 	 (*outsource) << 4 << endl;
 	 int temp;
 	 (*insource) >> temp;
-	 (*outsource) << labelTable[temp] << endl;
+	 (*outsource) << address(temp) << endl;
 	 currentAddress += 2;
       }
       else if (nextop == "CALL") {
@@ -115,7 +148,7 @@ void Assembler::secondPass()
 	 (*insource) >> temp;
 	 (*outsource) << temp << endl;
 	 (*insource) >> temp;
-	 (*outsource) << labelTable[temp] << endl;
+	 (*outsource) << address(temp) << endl;
 	 currentAddress += 3;
       }
       else if (nextop == "CONSTANT") {
@@ -189,18 +222,18 @@ void Assembler::secondPass()
 	 (*outsource) << 20 << endl;
 	 int temp;
 	 (*insource) >> temp;
-	 (*outsource) << labelTable[temp] << endl;
+	 (*outsource) << address(temp) << endl;
 	 (*insource) >> temp;
-	 (*outsource) << labelTable[temp] << endl;
+	 (*outsource) << address(temp) << endl;
 	 currentAddress += 3;
       }
       else if (nextop == "PROG") {
 	 (*outsource) << 21 << endl;
 	 int temp;
 	 (*insource) >> temp;
-	 (*outsource) << labelTable[temp] << endl;
+	 (*outsource) << address(temp) << endl;
 	 (*insource) >> temp;
-	 (*outsource) << labelTable[temp] << endl;
+	 (*outsource) << address(temp) << endl;
 	 currentAddress += 3;
       }
       else if (nextop == "READ") {
@@ -234,6 +267,10 @@ void Assembler::secondPass()
 	 (*outsource) << temp << endl;
 	 currentAddress += 2;
       }
+      else if (nextop == "INDEX_UNCHECKED") {
+	 (*outsource) << 27 << endl;
+	 currentAddress++;
+      }
       else if (nextop == "DEFADDR") {
 	 int temp;
 	 (*insource) >> temp;
@@ -242,10 +279,14 @@ void Assembler::secondPass()
 	 int temp1, temp2;
 	 (*insource) >> temp1 >> temp2;
       }
+      else if (nextop == "LINE") {
+	 int temp;
+	 (*insource) >> temp;
+      }
       else {
 	 // We should never see this message.
-	 cerr << "Assembler encountered unknown operator \"" << nextop << "\"\n";
-	 exit(2);
+	 message = "Assembler encountered unknown operator \"" + nextop + "\"";
+	 return;
       }
       (*insource) >> nextop;
 //	   cout << "got: " << nextop << endl;
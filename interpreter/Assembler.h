@@ -7,8 +7,9 @@
 using namespace std;
 #include <iostream>
 #include <string>
+#include <vector>
 
-const int MAXLABEL = 500;
+const int MAXLABEL = 10000;
 
 class Assembler
 {
@@ -18,11 +19,22 @@ class Assembler
    // The two passes of the assembler.
    void firstPass(); 
    void secondPass();
+   // Whether a pass found input that is not a program, and why
+   bool failed() const { return !message.empty(); }
+   const string &error() const { return message; }
+   // Source line of each word of the program, from the LINE directives
+   // before its instructions, or 0 where none was given.  Known after the
+   // first pass.
+   const vector<int> &lines() const { return lineTable; }
 
   private:
+   // Address of a label used by an instruction
+   int address(int label);
    int labelTable[MAXLABEL]; 
+   vector<int> lineTable;
    int currentAddress; 
    istream *insource;  // Input file
    ostream *outsource; // Output file 
+   string message;     // Error found by a pass
 };
 #endif
@@ -0,0 +1,135 @@
+//-----------------------------------------------------------
+// batch_io.cc
+//
+// Description: Buffered, locale independent number input and output
+//
+//-------------------------------------------------------------
+
+// INCLUDES
+
+#include <climits>
+#include <cstring>
+#include "batch_io.h"
+
+// CONSTANTS
+
+static const char output_prefix[] = "  Output: ";
+static const int prefix_length = sizeof(output_prefix) - 1;
+
+// Longest output line: prefix, sign, 10 digits and newline
+static const int max_line = prefix_length + 12;
+
+// FUNCTIONS
+
+BatchIO::BatchIO( FILE *input_file, FILE *output_file)
+  : in(input_file), out(output_file), input_length(0), input_position(0), failed(false), output_length(0)
+{
+}
+
+BatchIO::~BatchIO()
+{
+  flush();
+}
+
+int BatchIO::peek()
+{
+  if (input_position == input_length)
+  {
+    input_length = in ? fread(input, 1, IO_BUFFER_SIZE, in) : 0;
+    input_position = 0;
+    if (input_length <= 0)
+    {
+      input_length = 0;
+      return EOF;
+    }
+  }
+  return (unsigned char) input[input_position];
+}
+
+void BatchIO::read( int &value)
+{
+  if (failed)
+    return;
+  int c = peek();
+  while (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f')
+  {
+    ++input_position;
+    c = peek();
+  }
+  if (c == EOF)
+  {
+    failed = true;
+    return;
+  }
+
+  bool negative = (c == '-');
+  if (c == '-' || c == '+')
+  {
+    ++input_position;
+    c = peek();
+  }
+  if (c < '0' || c > '9')
+  {
+    value = 0;
+    failed = true;
+    return;
+  }
+  // Accumulate as a negative number so INT_MIN can be read
+  long long number = 0;
+  bool overflow = false;
+  while (c >= '0' && c <= '9')
+  {
+    number = number * 10 - (c - '0');
+    if (number < -(long long) INT_MAX - 1)
+    {
+      overflow = true;
+      number = -(long long) INT_MAX - 1;
+    }
+    ++input_position;
+    c = peek();
+  }
+  if (!negative)
+    number = -number;
+  // Out of range values are clamped, as cin does
+  if (overflow || number > INT_MAX)
+  {
+    value = negative ? INT_MIN : INT_MAX;
+    failed = true;
+    return;
+  }
+  value = number;
+}
+
+void BatchIO::write( int value)
+{
+  if (output_length + max_line > IO_BUFFER_SIZE)
+    flush();
+  char *line = output + output_length;
+  memcpy(line, output_prefix, prefix_length);
+  line += prefix_length;
+
+  // Digits are generated backwards into a small buffer
+  char digits[12];
+  int count = 0;
+  unsigned int magnitude = value < 0 ? 0u - (unsigned int) value : value;
+  do
+  {
+    digits[count++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (value < 0)
+    *line++ = '-';
+  while (count > 0)
+    *line++ = digits[--count];
+  *line++ = '\n';
+  output_length = line - output;
+}
+
+void BatchIO::flush()
+{
+  if (out && output_length > 0)
+    fwrite(output, 1, output_length, out);
+  output_length = 0;
+  if (out)
+    fflush(out);
+}
@@ -0,0 +1,60 @@
+//--------------------------------------------------
+// batch_io.h
+// Description	:	Buffered input and output of numbers for running
+//                  PL programs non-interactively
+//-------------------------------------------------------
+
+#ifndef BATCH_IO_H
+#define BATCH_IO_H
+
+// INCLUDES
+
+#include <cstdio>
+
+// CONSTANTS
+
+const int IO_BUFFER_SIZE = 1 << 16;
+
+// CLASSES
+
+//--------------------------------------------------
+// Reads numbers from standard input and writes output lines to standard
+// output through large buffers, without the formatting and locale
+// machinery of iostreams or a flush after every line.
+//--------------------------------------------------
+
+class BatchIO
+{
+public:
+
+    // CONSTRUCTION
+
+    // Input and output files, null for no input or to discard output
+    BatchIO(FILE * = stdin, FILE * = stdout);
+    ~BatchIO();
+
+    // Read the next number into value. As with cin, text that is not a
+    // number reads as 0, and once input fails nothing more is read
+    void read(int &value);
+
+    // Write an output line for value
+    void write(int value);
+
+    // Write out any buffered output
+    void flush();
+
+private:
+    // Next input character, or EOF
+    int peek();
+
+    FILE *in, *out;
+
+    char input[IO_BUFFER_SIZE];
+    int input_length, input_position;
+    bool failed;
+
+    char output[IO_BUFFER_SIZE];
+    int output_length;
+}; // end class BatchIO
+#endif
+// batch_io.h
@@ -9,19 +9,32 @@
 #include <fstream>     // for ostream, istream
 #include <string>        // for string
 #include "interp.h"      // for Interpreter
-#include "Assembler.h"
+#include "profile.h"     // for Profile
+#include "manifest.h"
+#include <cstdlib>
+#include <thread>
 using namespace std; 
 
 // file_exists checks to see whether or not the specified file
 // exists
 bool file_exists( const char* filename);
 
+// Interactive input and output, and the prompt before each step
+bool prompt_input( int &value);
+void print_output( int value);
+void step_prompt( OperationCode opcode);
+
 // MAIN PROGRAM
 
 int main( int argc, char* argv[])
 //
 // Description: The PL interpreter's main driver
-// Call       : interpret [-s] <program_filename>
+// Call       : interpret [-s | --batch] [--jit | --reg] [--count]
+//              [--profile] [--profile-stacks stacks_filename]
+//              <program_filename>
+//              interpret --manifest [-j threads]
+//              [--jit | --reg | --slice instructions]
+//              <manifest_filename>
 // Inputs     : argc - number of arguments given on the command line
 //              argv - vector of the actual command-line arguments
 // Outputs    : none
@@ -31,60 +44,125 @@ int main( int argc, char* argv[])
 {
   string program_filename; //PLAM instruction file
   bool stepping = false;   //for debugging purposes; use switch -s
+  ExecutionMode mode = INTERPRET; //use switch --jit or --reg to change
+  bool count = false;      //print instructions executed; use switch --count
+  bool batch = false;      //buffered I/O without prompts; use switch --batch
+  bool manifest = false;   //run the programs listed in a file; use --manifest
+  int threads = thread::hardware_concurrency(); //for --manifest; use -j
+  long long slice = 0;     //round robin time slice for --manifest; use --slice
+  bool profiling = false;  //report instructions executed; use --profile
+  string stacks_filename;  //call stacks for flame graphs; use --profile-stacks
+  const string usage = "Usage: interpret [-s | --batch] [--jit | --reg] [--count] "
+                       "[--profile] \n"
+                       "       [--profile-stacks stacks_filename] "
+                       "<program_filename> \n"
+                       "       interpret --manifest [-j threads] "
+                       "[--jit | --reg | --slice instructions] <manifest_filename> \n";
 
  // INITIALIZATION
 
-  if (argc == 2) // two arguments means no options specified
-  {
-  // Ensure that the actual file exists
-    if ( !file_exists( argv[1]))
-    {  
-      cout << "Program file '" << argv[1] << "' does not exist \n" << endl;
-      return 1;
-    }
-  else
-     program_filename = argv[1];
-  }
-
-  else if ( argc == 3) // three args means an option was specified
+  // options come before the program file name
+  for (int i = 1; i < argc - 1; i++)
   {
-    if ( string("-s") == string(argv[1]))
-    {
+    if ( string("-s") == string(argv[i]))
       stepping = true;
-      // ensure that the specified file exists
-      if (!file_exists( argv[2]))
-      {
-         cout << "Program file '" << argv[2]  
-              << "' does not exist \n" << endl;
-         return 1;
-      }
-      else
-         program_filename = argv[2];
+    else if ( string("--jit") == string(argv[i]))
+      mode = JIT;
+    else if ( string("--reg") == string(argv[i]))
+      mode = REGISTER;
+    else if ( string("--count") == string(argv[i]))
+      count = true;
+    else if ( string("--batch") == string(argv[i]))
+      batch = true;
+    else if ( string("--manifest") == string(argv[i]))
+      manifest = true;
+    else if ( string("-j") == string(argv[i]) && i + 1 < argc - 1 &&
+              atoi(argv[i + 1]) > 0)
+      threads = atoi(argv[++i]);
+    else if ( string("--slice") == string(argv[i]) && i + 1 < argc - 1 &&
+              atoll(argv[i + 1]) > 0)
+      slice = atoll(argv[++i]);
+    else if ( string("--profile") == string(argv[i]))
+      profiling = true;
+    else if ( string("--profile-stacks") == string(argv[i]) && i + 1 < argc - 1)
+    {
+      profiling = true;
+      stacks_filename = argv[++i];
     }
     else // invalid command line
     {
-      cout << "Usage: interpret [-s] <program_filename> \n" << endl;
+      cout << usage << endl;
       return 1;
-    } 
+    }
+  }
+  // stepping waits for the user, which makes no sense in batch mode
+  if (argc < 2 || (stepping && (batch || manifest)) || (slice && !manifest) ||
+      (profiling && manifest))
+  {
+    cout << usage << endl;
+    return 1;
+  }
+  if (manifest)
+    return run_manifest(argv[argc - 1], threads > 0 ? threads : 1, mode,
+                        slice) != 0;
+  // Ensure that the actual file exists
+  if ( !file_exists( argv[argc - 1]))
+  {
+    cout << "Program file '" << argv[argc - 1] << "' does not exist \n" << endl;
+    return 1;
   }
+  program_filename = argv[argc - 1];
   // interpret code file specified on command-line
   ifstream fin(program_filename);
   if (!fin.good()) {
     cout << "Failed to open assembler input file" << endl;
     return 1;
   }
-  ofstream fout("assembler.out");
-  if (!fout.good()) {
-    cout << "Failed to open assembler output file" << endl;
-    return 1;
+  Interpreter interpreter;
+  interpreter.set_error_stream(&cerr);
+  if (batch)
+    interpreter.set_batch_io(stdin, stdout);
+  else
+  {
+    interpreter.set_io(prompt_input, print_output);
+    cout << " Loading..." << endl;
+  }
+  // assemble in memory, so runs in the same directory don't interfere
+  vector<int> words, lines;
+  string error;
+  if (!Interpreter::assemble(fin, words, error, &lines))
+  {
+    cerr << error << endl;
+    return 2;
   }
-  Assembler assembler(fin, fout);
-  assembler.firstPass();
-  fin.seekg(0);
-  assembler.secondPass();
-  fin.close();
   fin.close();
-  Interpreter interpreter("assembler.out", stepping);
+  interpreter.load(words);
+  if (stepping)
+    interpreter.set_stepping(step_prompt);
+  Profile profile;
+  if (profiling)
+  {
+    profile.set_lines(lines);
+    interpreter.set_profile(&profile);
+  }
+  if (!batch)
+    cout << " Running ..." << endl;
+  interpreter.run(mode);
+  if (count && interpreter.dispatch_count() >= 0)
+    cout << " Instructions executed: " << interpreter.dispatch_count() << endl;
+  // the report follows the program's output, which it is kept apart from
+  if (profiling)
+    profile.write_report(cerr);
+  if (!stacks_filename.empty())
+  {
+    ofstream stacks(stacks_filename);
+    profile.write_stacks(stacks);
+    if (!stacks)
+    {
+      cerr << "Failed to write " << stacks_filename << endl;
+      return 1;
+    }
+  }
 } 
 
 
@@ -101,3 +179,22 @@ bool file_exists( const char* file_name)
 }
    
 
+
+bool prompt_input( int &value)
+{
+  cout << "Input: ";
+  return bool(cin >> value);
+}
+
+void print_output( int value)
+{
+  cout << "  Output: ";
+  cout << value << endl;
+}
+
+void step_prompt( OperationCode opcode)
+{
+  cout << endl << " press < enter > to execute "
+               << opcode_name[opcode] << " operation" << endl;
+  cin.get();
+}
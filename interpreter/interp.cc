@@ -10,25 +10,117 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include "Assembler.h"
 #include "interp.h"
+#include "jit.h"
+#include "profile.h"
+#include "regvm.h"
 // FUNCTIONS
 
-Interpreter::Interpreter( string filename, bool step)
+Interpreter::Interpreter()
+  : stack_bottom(0), batch_io(0), profile(0), error_stream(0),
+    run_status(RUN_FINISHED)
 {
-//  this->stepping = step;
-  stepping = step;
-  cout << " Loading..." << endl;
-  load_program(filename);
-  cout << " Running ..." << endl;
-  run_program();
+  load(vector<int>());
+}
+
+Interpreter::~Interpreter()
+{
+  delete batch_io;
+}
+
+void Interpreter::set_io( InputFunction in, OutputFunction out)
+{
+  delete batch_io;
+  batch_io = 0;
+  input_function = in;
+  output_function = out;
+}
+
+void Interpreter::set_batch_io( FILE *in, FILE *out)
+{
+  set_io(InputFunction(), OutputFunction());
+  batch_io = new BatchIO(in, out);
+}
+
+void Interpreter::set_stepping( StepFunction step)
+{
+  step_function = step;
+}
+
+void Interpreter::set_error_stream( ostream *stream)
+{
+  error_stream = stream;
+}
+
+void Interpreter::set_profile( Profile *counts)
+{
+  profile = counts;
+}
+
+RunStatus Interpreter::run( ExecutionMode mode, long long max_instructions)
+{
+  bool resuming = (run_status == RUN_YIELDED);
+  if (!resuming)
+  {
+    dispatches = 0;
+    error_message.clear();
+    if (profile)
+      profile->start(store, stack_bottom);
+  }
+  dispatch_limit = max_instructions >= 0 ? dispatches + max_instructions : -1;
+  // Stepping, profiling, counting against a limit and resuming need the
+  // interpreter loop
+  if (step_function || profile || max_instructions >= 0 || resuming)
+    mode = INTERPRET;
+  bool translated = false;
+  if (mode == JIT)
+  {
+    Jit translator(*this);
+    if (translator.translate())
+    {
+      dispatches = -1;
+      translator.run();
+      translated = true;
+    }
+  }
+  else if (mode == REGISTER)
+  {
+    RegisterMachine machine(*this);
+    if (machine.translate())
+    {
+      translated = machine.run();
+      resuming = !translated;
+    }
+  }
+  if (!translated && profile)
+    run_program<true>(resuming);
+  else if (!translated)
+    run_program<false>(resuming);
+  if (batch_io)
+    batch_io->flush();
+  if (failed())
+    run_status = RUN_FAILED;
+  else if (running)
+    run_status = RUN_YIELDED;
+  else
+    run_status = RUN_FINISHED;
+  running = false;
+  return run_status;
 }
 
 void Interpreter::runtime_error( string  message, int line_number)
 {
+  // Output written before the error comes first
+  if (batch_io)
+    batch_io->flush();
   if ( line_number != -1)
-     cerr << "line " << line_number << " : " << message << endl;
+     error_message = "line " + to_string(line_number) + " : " + message;
   else
-     cerr << message << endl;
+     error_message = message;
+  if (error_stream)
+     *error_stream << error_message << endl;
   running = false;
 }
 
@@ -71,6 +163,16 @@ void Interpreter::index( int bound, int line_number)
   program_register += 3;
 }
 
+// The compiler only emits this when it has proven the index is in range
+
+void Interpreter::index_unchecked()
+{
+  int i = store[stack_register];
+  --stack_register;
+  store[stack_register] = store[stack_register] + i -1;
+  ++program_register;
+}
+
 //----------------------------------------
 // factor = "constant" | variable_access "value" |
 //          expression | factor "not".
@@ -222,8 +324,7 @@ void Interpreter::read(int count)
   while ( x < stack_register + count)
   {
     ++x;
-    cout << "Input: ";
-    cin >> ( store[ store[x] ] );
+    input( store[ store[x] ] );
   }
 }
 
@@ -242,9 +343,29 @@ void Interpreter::write (int count)
   while (x < stack_register + count )
   {
     ++x;
-    cout << "  Output: ";
-    cout << ( store[x]) << endl;
+    output( store[x] );
+  }
+}
+
+void Interpreter::input( int &variable)
+{
+  if (input_function)
+  {
+    if (!input_function(variable))
+      variable = 0;
   }
+  else if (batch_io)
+    batch_io->read(variable);
+  else
+    variable = 0;
+}
+
+void Interpreter::output( int value)
+{
+  if (output_function)
+    output_function(value);
+  else if (batch_io)
+    batch_io->write(value);
 }
 
 //---------------------------------------
@@ -368,40 +489,65 @@ void Interpreter::endprog()
 // Basic operations
 //-------------------------------------------
 
-void Interpreter::load_program( string name)
+bool Interpreter::read_words( istream &program, vector<int> &words)
 {
-  int x = 0;
-  int word;
-  // const char* tempname = name.c_str();
-  ifstream program(name, ios::in);
-  
-  if (!program.good())
-  {
-    cerr << " Could not open program file" << endl;
-    return;
-  }
-  program.seekg(0);
-// read program into memory
+  int word = 0;
+  words.clear();
 
   while (!program.eof())
   {
-    
     program >> word;
     // cout << " Read word " << word << endl;
-    store[x] = word;
     if ( word == -1) break;
-    ++x;
-//    cout << "x is " << x << endl;
+    words.push_back(word);
     
-    if ( x >= STORE_SIZE)
-    {
-      cerr << "program exceeded " << x << " words " << endl;
-      cerr << "Not enough memory to load program " << endl;
-      return;
-     }
-   }
-  
-   stack_bottom = x;
+    if ( words.size() >= STORE_SIZE)
+      return false;
+  }
+  return true;
+}
+
+bool Interpreter::assemble( istream &plam, vector<int> &words, string &error,
+                            vector<int> *lines)
+{
+  stringstream assembled;
+  Assembler assembler(plam, assembled);
+  assembler.firstPass();
+  plam.clear();
+  plam.seekg(0);
+  if (!assembler.failed())
+    assembler.secondPass();
+  if (assembler.failed())
+  {
+    error = assembler.error();
+    return false;
+  }
+  if (lines)
+    *lines = assembler.lines();
+  if (!read_words(assembled, words))
+  {
+    error = "not enough memory to load program";
+    return false;
+  }
+  return true;
+}
+
+bool Interpreter::load_plam( const string &text)
+{
+  istringstream plam(text);
+  vector<int> words;
+  string error;
+  bool assembled = assemble(plam, words, error);
+  load(assembled ? words : vector<int>());
+  error_message = error;
+  return assembled;
+}
+
+void Interpreter::load( const vector<int> &words)
+{
+  for (size_t i = 0; i < words.size(); i++)
+    store[i] = words[i];
+  stack_bottom = words.size();
 
  //  cout << "stack_bottom = " << x << endl;
    
@@ -409,26 +555,33 @@ void Interpreter::load_program( string name)
 
    for (int i = stack_bottom; i <= STORE_SIZE; i++)
       store[i] = -1;
+  stack_register = base_register = program_register = 0;
+  running = false;
+  error_message.clear();
+  run_status = RUN_FINISHED;
 }
 
-void Interpreter::run_program()
+template <bool profiling>
+void Interpreter::run_program( bool resuming)
 {
   OperationCode  opcode;
-  program_register = 0; 
+  // The registers are as they were left when the program yielded
+  if (!resuming)
+    program_register = 0; 
   running = true;
   
-  while (running)
+  // A negative limit is never reached
+  while (running && dispatches != dispatch_limit)
   {
 //
     opcode = (OperationCode) store[program_register];
+    ++dispatches;
 //
  //   cout << "Opcode = " << opcode << endl;
-    if ( stepping )
-    {
-      cout << endl << " press < enter > to execute "
-                   << opcode_name[opcode] << " operation" << endl;
-      cin.get();
-    }
+    if ( step_function )
+      step_function(opcode);
+    if ( profiling )
+      profile->count(store, program_register);
     switch (opcode)
     {
       case OP_ADD:
@@ -512,6 +665,9 @@ void Interpreter::run_program()
       case OP_WRITE:
          write(store[program_register + 1]);
          break;
+      case OP_INDEX_UNCHECKED:
+         index_unchecked();
+         break;
       default:
          runtime_error(" FATAL! Damaged Program File!");
          break;
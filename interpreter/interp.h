@@ -8,7 +8,11 @@
 
 // INCLUDES
 
+#include <functional>
+#include <iostream>
 #include <string>
+#include <vector>
+#include "batch_io.h"
 using namespace std;
 
 // CONSTANTS
@@ -23,7 +27,7 @@ enum OperationCode
   OP_DIVIDE, OP_ENDPROC, OP_ENDPROG, OP_EQUAL, OP_FI, OP_GREATER,
   OP_INDEX, OP_LESS, OP_MINUS, OP_MODULO, OP_MULTIPLY, OP_NOT,
   OP_OR, OP_PROC, OP_PROG, OP_READ, OP_SUBTRACT, OP_VALUE, OP_VARIABLE,
-  OP_WRITE
+  OP_WRITE, OP_INDEX_UNCHECKED
 };
 
 // Messages
@@ -34,33 +38,147 @@ static const string opcode_name[] =
  "divide", "endproc", "endprog", "equal", "fi", "greater",
  "index", "less", "minus", "modulo", "multiply", "not",
  "or", "proc", "prog", "read", "subtract", "value",
- "variable", "write"
+ "variable", "write", "index_unchecked"
 };
 
+// Number of argument words following each operation code
+
+static const int operand_count[] =
+{
+ 0, 0, 1, 1, 1, 2, 1,
+ 0, 0, 0, 0, 1, 0,
+ 2, 0, 0, 0, 0, 0,
+ 0, 2, 2, 1, 0, 0,
+ 2, 1, 0
+};
+
+// How the loaded program is run
+
+enum ExecutionMode
+{
+  INTERPRET,   // one instruction at a time
+  JIT,         // translated to machine code
+  REGISTER     // translated to register code
+};
+
+// How the last run ended
+
+enum RunStatus
+{
+  RUN_FINISHED,      // reached the end of the program
+  RUN_FAILED,        // stopped by a runtime error
+  RUN_YIELDED        // executed as many instructions as it was allowed,
+                     // and carries on where it stopped when run again
+};
+
+// TYPES
+
+// Input of a value by read, returning false if there is none, in which
+// case the value is 0
+typedef function<bool(int &)> InputFunction;
+// Output of a value by write
+typedef function<void(int)> OutputFunction;
+// Called before each instruction is executed step by step
+typedef function<void(OperationCode)> StepFunction;
+
 // CLASSES
 
+class Profile;
+
+//--------------------------------------------------
+// An interpreter has no state outside the object, so any number of them
+// can run in one process, each on its own thread. Until it is given
+// input and output, reads give 0 and writes are discarded.
+//--------------------------------------------------
+
 class Interpreter
 {
 public:
 
     // CONSTRUCTION
 
-    Interpreter(string, bool = false);
+    // Construct with no program, to be given one by load and run with run
+    Interpreter();
+    ~Interpreter();
+
+    // Read the words written by the assembler. Returns false if the
+    // program does not fit in the store
+    static bool read_words(istream &, vector<int> &);
+
+    // Assemble PLAM text into words. Returns false with a message in the
+    // third argument if the text is not a complete program, or the
+    // program does not fit in the store. If the last argument is not null,
+    // it is given the source line of each word, from the LINE directives
+    // written by plc --line-table
+    static bool assemble(istream &, vector<int> &, string &,
+                         vector<int> * = 0);
+
+    // Replace the program, resetting the store and registers, so that
+    // the next run starts from the beginning
+    void load(const vector<int> &);
+
+    // Assemble and load PLAM text. Returns false, with the reason in
+    // error, if it can't be assembled
+    bool load_plam(const string &);
+
+    // Run the loaded program until it ends or, if the second argument is
+    // not negative, it has executed that many more instructions. A program
+    // that yielded resumes from the saved registers, otherwise it starts
+    // again. Programs that can't be translated for the given mode, and
+    // those run step by step, with a limit or resumed, are interpreted
+    RunStatus run(ExecutionMode = INTERPRET, long long = -1);
+
+    // Use the given functions for input and output
+    void set_io(InputFunction, OutputFunction);
+
+    // Use batch input and output on the given files, either of which may
+    // be null for no input or to discard output
+    void set_batch_io(FILE *, FILE *);
+
+    // Execute one instruction at a time, calling the function before each
+    void set_stepping(StepFunction);
+
+    // Stream runtime error messages are written to, or null for none
+    void set_error_stream(ostream *);
+
+    // Count the instructions executed in the profile, or stop counting if
+    // null. A profile counts from when the program is started, and
+    // profiled programs are interpreted
+    void set_profile(Profile *);
 
     // ACCESS
 
     void memory_dump(string) const;
 
+    // How the last run ended, and the message of the runtime error or
+    // load failure, if any
+    RunStatus status() const { return run_status; }
+    bool failed() const { return !error_message.empty(); }
+    const string &error() const { return error_message; }
+
+    // Instructions executed since the program was last started, or -1 if
+    // not counted as for machine code
+    long long dispatch_count() const { return dispatches; }
+
 private:
-    void load_program( string);
-    void run_program();
+    friend class Jit;
+    friend class RegisterMachine;
+
+    // Profiling is a separate instantiation of the loop, so that it costs
+    // nothing when there is no profile
+    template <bool profiling> void run_program(bool);
     void runtime_error(string, int = -1);
     void allocate( int );
 
+    // Input and output of a single value by read and write
+    void input(int &);
+    void output(int);
+
     // PL MACHINE INSTRUCTION SET
     
     void variable(int, int);
     void index(int, int);
+    void index_unchecked();
 
     void constant( int );
     void value();
@@ -106,8 +224,17 @@ private:
         base_register,         // br
         program_register;      // pc
 
+    InputFunction input_function;   // input and output, if given
+    OutputFunction output_function;
+    BatchIO *batch_io;         // buffered input and output, if batch mode
+    StepFunction step_function; // sets the step-by-step execution
+    Profile *profile;          // counts of the instructions executed, if any
+    ostream *error_stream;     // where runtime errors are reported
+    string error_message;      // last runtime error
+    RunStatus run_status;      // how the last run ended
+    long long dispatches;      // instructions executed
+    long long dispatch_limit;  // instructions the run may execute
     bool running;              // status of the interpreter
-    bool stepping;             // sets the step-by-step execution 
 }; // end class Interpreter
 #endif
 // interp.h	
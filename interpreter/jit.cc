@@ -0,0 +1,516 @@
+//-----------------------------------------------------------
+// jit.cc
+//
+// Description: Template translator from PL machine code to x86-64
+//
+//-------------------------------------------------------------
+
+// INCLUDES
+
+#include <cstring>
+#include <sys/mman.h>
+#include "jit.h"
+
+// CONSTANTS
+
+// Machine register numbers
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+       R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Kinds of runtime error raised by generated code
+enum { RANGE_ERROR, FI_ERROR, OVERFLOW_ERROR };
+
+// FUNCTIONS
+
+Jit::Jit( Interpreter &interpreter)
+  : interp(interpreter), memory(0), memory_size(0), saved_stack(0)
+{
+}
+
+Jit::~Jit()
+{
+  if (memory)
+    munmap(memory, memory_size);
+}
+
+//---------------------------------
+// Instruction encoding
+//---------------------------------
+
+void Jit::rex( bool wide, int reg, int index, int base)
+{
+  int bits = (wide << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+  if (bits)
+    code.push_back(0x40 | bits);
+}
+
+// op reg, rm with both operands registers
+
+void Jit::reg_op( std::vector<uint8_t> opcode, int reg, int rm, bool wide)
+{
+  rex(wide, reg, 0, rm);
+  code.insert(code.end(), opcode.begin(), opcode.end());
+  code.push_back(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// op reg, [base + 4*index + displacement]
+
+void Jit::mem_op( std::vector<uint8_t> opcode, int reg, int base, int index,
+                  int displacement, bool wide)
+{
+  rex(wide, reg, index, base);
+  code.insert(code.end(), opcode.begin(), opcode.end());
+  code.push_back(0x84 | ((reg & 7) << 3));
+  code.push_back(0x80 | ((index & 7) << 3) | (base & 7));
+  imm32(displacement);
+}
+
+void Jit::imm8( int value)
+{
+  code.push_back(value & 0xFF);
+}
+
+void Jit::imm32( int value)
+{
+  for (int i = 0; i < 4; i++)
+    code.push_back((uint32_t) value >> (8 * i));
+}
+
+void Jit::imm64( const void *pointer)
+{
+  uint64_t value = (uint64_t) pointer;
+  for (int i = 0; i < 8; i++)
+    code.push_back(value >> (8 * i));
+}
+
+//---------------------------------
+// Code templates
+//---------------------------------
+
+// Write the cached top of stack back to the store
+
+void Jit::spill()
+{
+  mem_op({0x89}, RAX, R15, R12, 0);
+}
+
+void Jit::reload()
+{
+  mem_op({0x8B}, RAX, R15, R12, 0);
+}
+
+// Follow level static links from the base register, leaving the result in rdx
+
+void Jit::frame_base( int level)
+{
+  reg_op({0x89}, RBX, RDX, true);
+  while (level-- > 0)
+    mem_op({0x63}, RDX, R15, RDX, 0, true);
+}
+
+// Jump or call to a PL address, patched once all code is generated
+
+void Jit::jump( std::vector<uint8_t> opcode, int address)
+{
+  code.insert(code.end(), opcode.begin(), opcode.end());
+  fixups.push_back(std::make_pair(code.size(), address));
+  imm32(0);
+}
+
+// Call a static member function with the interpreter as first argument,
+// the other two already in esi and edx
+
+void Jit::helper_call( const void *function)
+{
+  code.push_back(0x48);
+  code.push_back(0xB8 + RDI);
+  imm64(&interp);
+  code.push_back(0x48);
+  code.push_back(0xB8 + RAX);
+  imm64(function);
+  reg_op({0xFF}, 2, RAX);
+}
+
+// Report a runtime error and leave the generated code
+
+void Jit::error_exit( int kind, int line_number)
+{
+  code.push_back(0xB8 + RSI);
+  imm32(kind);
+  code.push_back(0xB8 + RDX);
+  imm32(line_number);
+  helper_call((const void *) &Jit::error);
+  code.push_back(0xE9);
+  exit_fixups.push_back(code.size());
+  imm32(0);
+}
+
+// Stop with a stack overflow if the stack register has passed the end of
+// the store, as allocate does
+
+void Jit::overflow_check()
+{
+  reg_op({0x81}, 7, R12, true);                     // cmp r12, STORE_SIZE
+  imm32(STORE_SIZE);
+  code.push_back(0x0F); code.push_back(0x8F);       // jg overflow
+  overflow_fixups.push_back(code.size());
+  imm32(0);
+}
+
+//---------------------------------
+// Translation
+//---------------------------------
+
+bool Jit::translate()
+{
+  code.clear();
+  native_address.clear();
+  fixups.clear();
+  exit_fixups.clear();
+  overflow_fixups.clear();
+
+  // Range error stubs, placed after the program: jump position and line
+  std::vector<std::pair<size_t, int>> range_stubs;
+
+  // Entry: save callee saved registers and the machine stack, which
+  // stays 16 byte aligned throughout for calls into C++
+  code.push_back(0x53);                 // push rbx
+  code.push_back(0x41); code.push_back(0x54); // push r12
+  code.push_back(0x41); code.push_back(0x57); // push r15
+  code.push_back(0x48); code.push_back(0xB8 + RAX);
+  imm64(&saved_stack);
+  code.push_back(0x48); code.push_back(0x89); code.push_back(0x20); // mov [rax], rsp
+  code.push_back(0x49); code.push_back(0xB8 + (R15 & 7));
+  imm64(interp.store);
+
+  int pc = 0;
+  while (pc < interp.stack_bottom)
+  {
+    native_address[pc] = code.size();
+    int opcode = interp.store[pc];
+    int *args = &interp.store[pc + 1];
+
+    // Checks that jump to out of line code
+    if (opcode == OP_INDEX)
+    {
+      reg_op({0x89}, RAX, RCX);                     // mov ecx, eax
+      reg_op({0xFF}, 1, R12, true);                 // dec r12
+      reload();
+      reg_op({0xFF}, 1, RCX);                       // dec ecx
+      reg_op({0x81}, 7, RCX);                       // cmp ecx, bound - 1
+      imm32(args[0] - 1);
+      code.push_back(0x0F); code.push_back(0x87);   // ja stub
+      range_stubs.push_back(std::make_pair(code.size(), args[1]));
+      imm32(0);
+      reg_op({0x01}, RCX, RAX);                     // add eax, ecx
+      pc += 3;
+      continue;
+    }
+    if (opcode == OP_CALL || opcode == OP_PROC || opcode == OP_PROG)
+    {
+      if (opcode == OP_CALL)
+      {
+        spill();
+        frame_base(args[0]);
+        reg_op({0x83}, 0, R12, true);               // add r12, 3
+        imm8(3);
+      }
+      else if (opcode == OP_PROC)
+      {
+        // CALL has spilled the top of stack, and r12 is left at the
+        // return address it wrote
+        reg_op({0x83}, 5, RSP, true);               // sub rsp, 8
+        imm8(8);
+        reg_op({0x81}, 0, R12, true);               // add r12, length
+        imm32(args[0]);
+      }
+      else
+      {
+        code.push_back(0xB8 + RBX);                 // mov ebx, stack_bottom
+        imm32(interp.stack_bottom);
+        reg_op({0x89}, RBX, R12, true);             // mov r12, rbx
+        reg_op({0x81}, 0, R12, true);               // add r12, length + 2
+        imm32(args[0] + 2);
+      }
+      overflow_check();
+      if (opcode == OP_CALL)
+      {
+        mem_op({0x89}, RDX, R15, R12, -8);          // static link
+        mem_op({0x89}, RBX, R15, R12, -4);          // dynamic link
+        mem_op({0xC7}, 0, R15, R12, 0);             // return address
+        imm32(pc + 3);
+        reg_op({0x89}, R12, RBX, true);             // mov rbx, r12
+        reg_op({0x83}, 5, RBX, true);               // sub rbx, 2
+        imm8(2);
+        jump({0xE8}, args[1]);
+      }
+      else
+      {
+        reload();
+        jump({0xE9}, args[1]);
+      }
+      pc += 3;
+      continue;
+    }
+    if (!translate_instruction(pc))
+      return false;
+  }
+
+  // Leave the generated code, with the registers written back. The top
+  // of stack has already been spilled
+  size_t exit_address = code.size();
+  code.push_back(0x48); code.push_back(0xB8 + RAX);
+  imm64(&interp.stack_register);
+  mem_op({0x89}, R12, RAX, RSP, 0);             // index rsp means none
+  code.push_back(0x48); code.push_back(0xB8 + RAX);
+  imm64(&interp.base_register);
+  mem_op({0x89}, RBX, RAX, RSP, 0);
+  code.push_back(0x48); code.push_back(0xB8 + RAX);
+  imm64(&saved_stack);
+  code.push_back(0x48); code.push_back(0x8B); code.push_back(0x20); // mov rsp, [rax]
+  code.push_back(0x41); code.push_back(0x5F); // pop r15
+  code.push_back(0x41); code.push_back(0x5C); // pop r12
+  code.push_back(0x5B);                 // pop rbx
+  code.push_back(0xC3);
+
+  for (size_t i = 0; i < range_stubs.size(); i++)
+  {
+    int rel = code.size() - (range_stubs[i].first + 4);
+    memcpy(&code[range_stubs[i].first], &rel, 4);
+    spill();
+    error_exit(RANGE_ERROR, range_stubs[i].second);
+  }
+  size_t overflow_address = code.size();
+  error_exit(OVERFLOW_ERROR, -1);
+
+  for (size_t i = 0; i < overflow_fixups.size(); i++)
+  {
+    int rel = overflow_address - (overflow_fixups[i] + 4);
+    memcpy(&code[overflow_fixups[i]], &rel, 4);
+  }
+  for (size_t i = 0; i < exit_fixups.size(); i++)
+  {
+    int rel = exit_address - (exit_fixups[i] + 4);
+    memcpy(&code[exit_fixups[i]], &rel, 4);
+  }
+  for (size_t i = 0; i < fixups.size(); i++)
+  {
+    // A target that is not the start of an instruction can't be translated
+    if (native_address.count(fixups[i].second) == 0)
+      return false;
+    int rel = native_address[fixups[i].second] - (fixups[i].first + 4);
+    memcpy(&code[fixups[i].first], &rel, 4);
+  }
+
+  memory_size = code.size();
+  memory = mmap(0, memory_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+  {
+    memory = 0;
+    return false;
+  }
+  memcpy(memory, code.data(), code.size());
+  if (mprotect(memory, memory_size, PROT_READ | PROT_EXEC) != 0)
+    return false;
+  return true;
+}
+
+// Translate the straight line instruction at store[pc], advancing pc
+
+bool Jit::translate_instruction( int &pc)
+{
+  int opcode = interp.store[pc];
+  int *args = &interp.store[pc + 1];
+
+  switch (opcode)
+  {
+    case OP_VARIABLE:
+      spill();
+      frame_base(args[0]);
+      reg_op({0xFF}, 0, R12, true);                 // inc r12
+      overflow_check();
+      reg_op({0x89}, RDX, RAX);                     // mov eax, edx
+      reg_op({0x81}, 0, RAX);                       // add eax, displacement
+      imm32(args[1]);
+      pc += 3;
+      break;
+    case OP_INDEX_UNCHECKED:
+      reg_op({0x89}, RAX, RCX);
+      reg_op({0xFF}, 1, R12, true);
+      reload();
+      reg_op({0x01}, RCX, RAX);                     // add eax, ecx
+      reg_op({0xFF}, 1, RAX);                       // dec eax
+      ++pc;
+      break;
+    case OP_CONSTANT:
+      spill();
+      reg_op({0xFF}, 0, R12, true);
+      overflow_check();
+      code.push_back(0xB8 + RAX);                   // mov eax, value
+      imm32(args[0]);
+      pc += 2;
+      break;
+    case OP_VALUE:
+      reg_op({0x63}, RAX, RAX, true);               // movsxd rax, eax
+      mem_op({0x8B}, RAX, R15, RAX, 0);
+      ++pc;
+      break;
+    case OP_NOT:
+      reg_op({0xF7}, 3, RAX);                       // neg eax
+      reg_op({0x83}, 0, RAX);                       // add eax, 1
+      imm8(1);
+      ++pc;
+      break;
+    case OP_MINUS:
+      reg_op({0xF7}, 3, RAX);
+      ++pc;
+      break;
+    case OP_ADD:
+      reg_op({0xFF}, 1, R12, true);
+      mem_op({0x03}, RAX, R15, R12, 0);             // add eax, [top]
+      ++pc;
+      break;
+    case OP_MULTIPLY:
+      reg_op({0xFF}, 1, R12, true);
+      mem_op({0x0F, 0xAF}, RAX, R15, R12, 0);       // imul eax, [top]
+      ++pc;
+      break;
+    case OP_SUBTRACT:
+    case OP_DIVIDE:
+    case OP_MODULO:
+    case OP_LESS:
+    case OP_EQUAL:
+    case OP_GREATER:
+    case OP_AND:
+    case OP_OR:
+      // Right operand to ecx, left operand to eax
+      reg_op({0x89}, RAX, RCX);
+      reg_op({0xFF}, 1, R12, true);
+      reload();
+      if (opcode == OP_SUBTRACT)
+        reg_op({0x29}, RCX, RAX);                   // sub eax, ecx
+      else if (opcode == OP_DIVIDE || opcode == OP_MODULO)
+      {
+        // Division by zero traps, as it does in the interpreter
+        code.push_back(0x99);                       // cdq
+        reg_op({0xF7}, 7, RCX);                     // idiv ecx
+        if (opcode == OP_MODULO)
+          reg_op({0x89}, RDX, RAX);
+      }
+      else if (opcode == OP_AND || opcode == OP_OR)
+      {
+        reg_op({0x83}, 7, RAX);                     // cmp eax, 1 or 0
+        imm8(opcode == OP_AND ? 1 : 0);
+        code.push_back(0x75); code.push_back(0x02); // jne over the mov
+        reg_op({0x89}, RCX, RAX);
+      }
+      else
+      {
+        uint8_t set = (opcode == OP_LESS ? 0x9C :
+                       opcode == OP_EQUAL ? 0x94 : 0x9F);
+        reg_op({0x39}, RCX, RAX);                   // cmp eax, ecx
+        reg_op({0x0F, set}, 0, RAX);                // setcc al
+        reg_op({0x0F, 0xB6}, RAX, RAX);             // movzx eax, al
+      }
+      ++pc;
+      break;
+    case OP_READ:
+    case OP_WRITE:
+      spill();
+      reg_op({0x89}, R12, RSI);                     // mov esi, r12d
+      code.push_back(0xB8 + RDX);
+      imm32(args[0]);
+      helper_call(opcode == OP_READ ? (const void *) &Jit::read
+                                    : (const void *) &Jit::write);
+      reg_op({0x81}, 5, R12, true);                 // sub r12, count
+      imm32(args[0]);
+      reload();
+      pc += 2;
+      break;
+    case OP_ASSIGN:
+      spill();
+      reg_op({0x81}, 5, R12, true);
+      imm32(2 * args[0]);
+      for (int i = 1; i <= args[0]; i++)
+      {
+        mem_op({0x63}, RDX, R15, R12, 4 * i, true);
+        mem_op({0x8B}, RCX, R15, R12, 4 * (i + args[0]));
+        mem_op({0x89}, RCX, R15, RDX, 0);
+      }
+      reload();
+      pc += 2;
+      break;
+    case OP_ARROW:
+      reg_op({0x89}, RAX, RCX);
+      reg_op({0xFF}, 1, R12, true);
+      reload();
+      reg_op({0x83}, 7, RCX);                       // cmp ecx, 1
+      imm8(1);
+      jump({0x0F, 0x85}, args[0]);                  // jne
+      pc += 2;
+      break;
+    case OP_BAR:
+      jump({0xE9}, args[0]);
+      pc += 2;
+      break;
+    case OP_FI:
+      spill();
+      error_exit(FI_ERROR, args[0]);
+      pc += 2;
+      break;
+    case OP_ENDPROC:
+      reg_op({0x89}, RBX, R12, true);               // mov r12, rbx
+      reg_op({0xFF}, 1, R12, true);
+      mem_op({0x8B}, RBX, R15, RBX, 4);             // dynamic link
+      reload();
+      reg_op({0x83}, 0, RSP, true);                 // add rsp, 8
+      imm8(8);
+      code.push_back(0xC3);
+      ++pc;
+      break;
+    case OP_ENDPROG:
+      spill();
+      code.push_back(0xE9);
+      exit_fixups.push_back(code.size());
+      imm32(0);
+      ++pc;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+void Jit::run()
+{
+  interp.running = true;
+  ((void (*)()) memory)();
+  interp.running = false;
+}
+
+//---------------------------------
+// Called from generated code
+//---------------------------------
+
+void Jit::read( Interpreter *interp, int stack_register, int count)
+{
+  interp->stack_register = stack_register;
+  interp->read(count);
+}
+
+void Jit::write( Interpreter *interp, int stack_register, int count)
+{
+  interp->stack_register = stack_register;
+  interp->write(count);
+}
+
+void Jit::error( Interpreter *interp, int kind, int line_number)
+{
+  if (kind == RANGE_ERROR)
+    interp->runtime_error(" range error", line_number);
+  else if (kind == FI_ERROR)
+    interp->runtime_error(" if statement fails", line_number);
+  else
+    interp->runtime_error(" stack overflow");
+}
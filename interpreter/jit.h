@@ -0,0 +1,85 @@
+//--------------------------------------------------
+// jit.h
+// Description	:	Translates loaded PL machine code into x86-64
+//                  machine code, run in place of the interpreter loop
+//-------------------------------------------------------
+
+#ifndef JIT_H
+#define JIT_H
+
+// INCLUDES
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "interp.h"
+
+// CLASSES
+
+//--------------------------------------------------
+// Each PL instruction is replaced by a fixed snippet of machine code.
+// The generated code works on the interpreter's own store, with
+//   r15  address of store[0]
+//   rbx  base register
+//   r12  stack register
+//   eax  value on top of the stack, store[stack_register] is not kept
+//        up to date in memory
+// Procedure calls use the machine call and ret instructions, with the
+// return address written to the store as the interpreter does.
+//--------------------------------------------------
+
+class Jit
+{
+public:
+
+    // CONSTRUCTION
+
+    Jit(Interpreter &);
+    ~Jit();
+
+    // Translate the program in store[0 .. stack_bottom). Returns false
+    // if it uses an operation the translator does not support, in which
+    // case the program must be interpreted
+    bool translate();
+
+    // Run the translated program to completion
+    void run();
+
+private:
+    // Bytes of each kind of register operand
+    void rex(bool, int, int, int);
+    void reg_op(std::vector<uint8_t>, int, int, bool = false);
+    void mem_op(std::vector<uint8_t>, int, int, int, int, bool = false);
+    void imm8(int);
+    void imm32(int);
+    void imm64(const void *);
+
+    void spill();
+    void reload();
+    void frame_base(int);
+    void jump(std::vector<uint8_t>, int);
+    void helper_call(const void *);
+    void error_exit(int, int);
+    void overflow_check();
+
+    bool translate_instruction(int &);
+
+    // Called from generated code
+    static void read(Interpreter *, int, int);
+    static void write(Interpreter *, int, int);
+    static void error(Interpreter *, int, int);
+
+    Interpreter &interp;
+
+    std::vector<uint8_t> code;
+    std::map<int, size_t> native_address;  // of each PL instruction
+    std::vector<std::pair<size_t, int>> fixups; // rel32 to a PL address
+    std::vector<size_t> exit_fixups;       // rel32 to the exit code
+    std::vector<size_t> overflow_fixups;   // rel32 to the stack overflow exit
+
+    void *memory;                          // executable copy of code
+    size_t memory_size;
+    void *saved_stack;                     // machine stack at entry
+}; // end class Jit
+#endif
+// jit.h
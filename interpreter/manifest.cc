@@ -0,0 +1,333 @@
+//-----------------------------------------------------------
+// manifest.cc
+//
+// Description: Runs the programs listed in a manifest file in parallel
+//
+//-------------------------------------------------------------
+
+// INCLUDES
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "manifest.h"
+
+// CONSTANTS
+
+// Runs sharing the threads round robin at any one time. Each holds its
+// input and output files open and its own buffers
+const size_t MAX_LIVE_TASKS = 256;
+
+// File descriptors left for everything but the runs' files
+const size_t RESERVED_FILES = 16;
+
+// TYPES
+
+struct Job
+{
+  string program, input, output;
+  int image;                // index of the assembled program, -1 if none
+  long long microseconds;
+  string error;
+};
+
+// A run shared round robin between the threads
+struct Task
+{
+  Job *job;
+  FILE *in, *out;
+  Interpreter interpreter;
+};
+
+// Runs waiting for a thread, the number started and not yet finished,
+// and the next job to start
+struct RoundRobin
+{
+  mutex lock;
+  condition_variable ready_changed;
+  vector<Job> *jobs;
+  const vector<vector<int>> *images;
+  size_t next_job;
+  deque<Task *> ready;
+  size_t live;
+  size_t max_live;
+  long long switches;       // slices that ended by yielding
+};
+
+// FUNCTIONS
+
+// Assemble a PLAM file in memory. Returns false with a message in error
+// if it can't be read or assembled
+
+static bool assemble( const string &filename, vector<int> &words, string &error)
+{
+  ifstream fin(filename);
+  if (!fin.good())
+  {
+    error = "could not open program file";
+    return false;
+  }
+  return Interpreter::assemble(fin, words, error);
+}
+
+// Open a job's input and output files, if it has them. Returns false
+// with a message in the job's error if either can't be opened
+
+static bool open_files( Job &job, FILE *&in, FILE *&out)
+{
+  in = out = 0;
+  if (!job.input.empty() && (in = fopen(job.input.c_str(), "r")) == 0)
+  {
+    job.error = "could not open input file " + job.input;
+    return false;
+  }
+  if (!job.output.empty() && (out = fopen(job.output.c_str(), "w")) == 0)
+  {
+    job.error = "could not open output file " + job.output;
+    if (in)
+      fclose(in);
+    return false;
+  }
+  return true;
+}
+
+static void close_files( FILE *in, FILE *out)
+{
+  if (in)
+    fclose(in);
+  if (out)
+    fclose(out);
+}
+
+// Run jobs taken from the shared counter until there are none left, with
+// one interpreter reused for all of them
+
+static void worker( vector<Job> &jobs, const vector<vector<int>> &images,
+                    atomic<size_t> &next, ExecutionMode mode)
+{
+  Interpreter interpreter;
+  for (size_t i = next++; i < jobs.size(); i = next++)
+  {
+    Job &job = jobs[i];
+    if (job.image == -1)
+      continue;
+    FILE *in, *out;
+    if (!open_files(job, in, out))
+      continue;
+
+    auto start = chrono::steady_clock::now();
+    interpreter.set_batch_io(in, out);
+    interpreter.load(images[job.image]);
+    interpreter.run(mode);
+    auto end = chrono::steady_clock::now();
+    job.microseconds = chrono::duration_cast<chrono::microseconds>(end - start).count();
+    job.error = interpreter.error();
+
+    // The buffered output has been flushed by run
+    interpreter.set_batch_io(0, 0);
+    close_files(in, out);
+  }
+}
+
+// Runs that can be live at once: MAX_LIVE_TASKS, or fewer if the limit
+// on open files would not allow two for each
+
+static size_t live_task_limit()
+{
+  size_t limit = MAX_LIVE_TASKS;
+  rlimit files;
+  if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur != RLIM_INFINITY)
+  {
+    size_t spare = files.rlim_cur > RESERVED_FILES ? files.rlim_cur - RESERVED_FILES : 0;
+    limit = min(limit, spare / 2);
+  }
+  return max(limit, (size_t) 1);
+}
+
+// Start the job as a task, opening its files. Returns null, with the
+// reason in the job's error, if it can't be started
+
+static Task *start_task( Job &job, const vector<vector<int>> &images)
+{
+  FILE *in, *out;
+  if (job.image == -1 || !open_files(job, in, out))
+    return 0;
+  Task *task = new Task;
+  task->job = &job;
+  task->in = in;
+  task->out = out;
+  task->interpreter.set_batch_io(in, out);
+  task->interpreter.load(images[job.image]);
+  return task;
+}
+
+// Start the next job while fewer than max_live are running, or take
+// the next ready task, run it for one slice and queue it again if it
+// yielded, until every job has finished
+
+static void round_robin_worker( RoundRobin &tasks, long long slice)
+{
+  unique_lock<mutex> guard(tasks.lock);
+  for (;;)
+  {
+    bool can_start = tasks.next_job < tasks.jobs->size() &&
+                     tasks.live < tasks.max_live;
+    while (!can_start && tasks.ready.empty() && tasks.live > 0)
+    {
+      tasks.ready_changed.wait(guard);
+      can_start = tasks.next_job < tasks.jobs->size() &&
+                  tasks.live < tasks.max_live;
+    }
+    if (!can_start && tasks.ready.empty())
+      return;
+    Task *task;
+    if (can_start)
+    {
+      Job &job = (*tasks.jobs)[tasks.next_job++];
+      tasks.live++;
+      guard.unlock();
+      task = start_task(job, *tasks.images);
+      if (!task)
+      {
+        guard.lock();
+        tasks.live--;
+        tasks.ready_changed.notify_all();
+        continue;
+      }
+    }
+    else
+    {
+      task = tasks.ready.front();
+      tasks.ready.pop_front();
+      guard.unlock();
+    }
+
+    auto start = chrono::steady_clock::now();
+    RunStatus status = task->interpreter.run(INTERPRET, slice);
+    auto end = chrono::steady_clock::now();
+    task->job->microseconds +=
+      chrono::duration_cast<chrono::microseconds>(end - start).count();
+    if (status != RUN_YIELDED)
+    {
+      task->job->error = task->interpreter.error();
+      // The buffered output has been flushed by run
+      task->interpreter.set_batch_io(0, 0);
+      close_files(task->in, task->out);
+      delete task;
+    }
+
+    guard.lock();
+    if (status == RUN_YIELDED)
+    {
+      tasks.ready.push_back(task);
+      tasks.switches++;
+      tasks.ready_changed.notify_one();
+    }
+    else
+    {
+      // Another job can start, or the run is over
+      tasks.live--;
+      tasks.ready_changed.notify_all();
+    }
+  }
+}
+
+int run_manifest( const string &filename, int threads, ExecutionMode mode,
+                  long long slice)
+{
+  ifstream manifest(filename);
+  if (!manifest.good())
+  {
+    cerr << "Could not open manifest file '" << filename << "'" << endl;
+    return 1;
+  }
+
+  vector<Job> jobs;
+  vector<vector<int>> images;
+  map<string, int> image_index;
+  map<string, string> load_errors;
+  string line;
+  while (getline(manifest, line))
+  {
+    istringstream fields(line);
+    Job job;
+    if (!(fields >> job.program) || job.program[0] == '#')
+      continue;
+    fields >> job.input >> job.output;
+    if (job.input == "-")
+      job.input.clear();
+    if (job.output == "-")
+      job.output.clear();
+    job.microseconds = 0;
+    if (!image_index.count(job.program) && !load_errors.count(job.program))
+    {
+      vector<int> words;
+      string error;
+      if (assemble(job.program, words, error))
+      {
+        image_index[job.program] = images.size();
+        images.push_back(words);
+      }
+      else
+        load_errors[job.program] = error;
+    }
+    job.image = image_index.count(job.program) ? image_index[job.program] : -1;
+    if (job.image == -1)
+      job.error = load_errors[job.program];
+    jobs.push_back(job);
+  }
+
+  auto start = chrono::steady_clock::now();
+  atomic<size_t> next(0);
+  RoundRobin tasks;
+  tasks.jobs = &jobs;
+  tasks.images = &images;
+  tasks.next_job = 0;
+  tasks.live = 0;
+  tasks.max_live = live_task_limit();
+  tasks.switches = 0;
+  vector<thread> pool;
+  for (int i = 0; i < threads; i++)
+  {
+    if (slice > 0)
+      pool.push_back(thread(round_robin_worker, ref(tasks), slice));
+    else
+      pool.push_back(thread(worker, ref(jobs), cref(images), ref(next), mode));
+  }
+  for (size_t i = 0; i < pool.size(); i++)
+    pool[i].join();
+  auto end = chrono::steady_clock::now();
+
+  int failures = 0;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    Job &job = jobs[i];
+    cout << job.program;
+    if (!job.input.empty())
+      cout << " < " << job.input;
+    cout << ": " << job.microseconds << " us";
+    if (!job.error.empty())
+    {
+      cout << ", " << job.error;
+      failures++;
+    }
+    cout << endl;
+  }
+  cout << jobs.size() << " runs of " << images.size() << " programs in "
+       << chrono::duration_cast<chrono::microseconds>(end - start).count()
+       << " us on " << threads << " threads";
+  if (slice > 0)
+    cout << ", " << tasks.switches << " switches";
+  cout << endl;
+  return failures;
+}
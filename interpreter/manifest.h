@@ -0,0 +1,38 @@
+//--------------------------------------------------
+// manifest.h
+// Description	:	Running many programs, listed in a manifest file,
+//                  on a pool of worker threads in one process
+//-------------------------------------------------------
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+// INCLUDES
+
+#include <string>
+#include "interp.h"
+
+// FUNCTIONS
+
+//--------------------------------------------------
+// Each line of the manifest names a PLAM program and optionally an input
+// file and an output file:
+//     program [input [output]]
+// where - stands for no file. Blank lines and lines starting with # are
+// ignored. Each program is assembled once, however many times it is
+// listed. Runs use batch input and output, and without an output file
+// the output is discarded. A line
+// with the time taken by each run, and any runtime error, is written to
+// cout in manifest order. Returns the number of runs that failed.
+//
+// If the last argument is positive, up to 256 runs, fewer if
+// the limit on open files is low, are started at once and the threads
+// share them round robin, each run being interpreted for at most that
+// many instructions before it yields its thread to the next. A run's
+// files are open only while it is started.
+//--------------------------------------------------
+
+int run_manifest( const string &, int, ExecutionMode, long long = 0);
+
+#endif
+// manifest.h
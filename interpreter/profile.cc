@@ -0,0 +1,221 @@
+//-----------------------------------------------------------
+// profile.cc
+//
+// Description: Instruction counts of a program's run
+//
+//-------------------------------------------------------------
+
+// INCLUDES
+
+#include <algorithm>
+#include <iomanip>
+#include "profile.h"
+
+// CONSTANTS
+
+// Rough machine cycles each operation takes to interpret: its dispatch
+// and the work it does, plus cycles for each unit of its first argument,
+// the static links followed by variable and call, and the values moved by
+// assign, read and write. Reads and writes are dominated by input and
+// output. They are estimates for weighing operations against each other,
+// not measurements.
+
+static const int base_cycles[OPCODE_COUNT] =
+{
+ 3, 4, 4, 4, 2, 8, 3,
+ 25, 5, 1, 3, 1, 3,
+ 5, 3, 2, 25, 4, 2,
+ 4, 4, 4, 4, 3, 3,
+ 4, 4, 3
+};
+
+static const int unit_cycles[OPCODE_COUNT] =
+{
+ 0, 0, 0, 3, 0, 2, 0,
+ 0, 0, 0, 0, 0, 0,
+ 0, 0, 0, 0, 0, 0,
+ 0, 0, 0, 100, 0, 0,
+ 2, 100, 0
+};
+
+// FUNCTIONS
+
+Profile::Profile()
+  : line_of(STORE_SIZE + 1, 0), cost(STORE_SIZE + 1, 0)
+{
+  start(0, 0);
+}
+
+void Profile::set_lines( const vector<int> &lines)
+{
+  line_table = lines;
+}
+
+void Profile::start( const int *store, int length)
+{
+  fill(line_of.begin(), line_of.end(), 0);
+  fill(cost.begin(), cost.end(), 0);
+  int last_line = 0;
+  // Decode the program, giving each instruction the line of its first word
+  for (int address = 0; address < length; address += 1 + operand_count[store[address]])
+  {
+    int opcode = store[address];
+    if (opcode < 0 || opcode >= OPCODE_COUNT)
+      break;
+    int line = address < (int) line_table.size() ? line_table[address] : 0;
+    if (line == 0 && opcode == OP_INDEX)
+      line = store[address + 2];
+    else if (line == 0 && opcode == OP_FI)
+      line = store[address + 1];
+    line_of[address] = max(line, 0);
+    last_line = max(last_line, line_of[address]);
+    cost[address] = base_cycles[opcode];
+    if (unit_cycles[opcode] && address + 1 < length)
+      cost[address] += unit_cycles[opcode] * store[address + 1];
+  }
+  fill(opcode_counts, opcode_counts + OPCODE_COUNT, 0);
+  fill(opcode_cycles, opcode_cycles + OPCODE_COUNT, 0);
+  line_counts.assign(last_line + 1, 0);
+  nodes.assign(1, Node{-1, -1, 1, 0});
+  children.clear();
+  current = 0;
+}
+
+void Profile::enter( int procedure)
+{
+  auto found = children.find(make_pair(current, procedure));
+  if (found == children.end())
+  {
+    nodes.push_back(Node{procedure, current, 0, 0});
+    found = children.insert(make_pair(make_pair(current, procedure),
+                                      (int) nodes.size() - 1)).first;
+  }
+  current = found->second;
+  ++nodes[current].calls;
+}
+
+long long Profile::instructions() const
+{
+  long long total = 0;
+  for (int op = 0; op < OPCODE_COUNT; op++)
+    total += opcode_counts[op];
+  return total;
+}
+
+string Profile::procedure_name( int procedure) const
+{
+  if (procedure < 0)
+    return "program";
+  if (procedure <= STORE_SIZE && line_of[procedure] > 0)
+    return "proc at line " + to_string(line_of[procedure]);
+  return "proc at address " + to_string(procedure);
+}
+
+vector<ProcedureProfile> Profile::procedures() const
+{
+  // Nodes come after their parents, so the instructions executed under
+  // each node are added up from the last
+  vector<long long> total(nodes.size());
+  for (size_t i = nodes.size(); i-- > 0; )
+  {
+    total[i] += nodes[i].self;
+    if (nodes[i].parent >= 0)
+      total[nodes[i].parent] += total[i];
+  }
+  vector<ProcedureProfile> list;
+  map<int, size_t> position;
+  for (size_t i = 0; i < nodes.size(); i++)
+  {
+    const Node &n = nodes[i];
+    if (!position.count(n.procedure))
+    {
+      position[n.procedure] = list.size();
+      list.push_back(ProcedureProfile{procedure_name(n.procedure), 0, 0, 0});
+    }
+    ProcedureProfile &p = list[position[n.procedure]];
+    p.calls += n.calls;
+    p.exclusive += n.self;
+    // A recursive call is already counted by the outermost one
+    bool outermost = true;
+    for (int a = n.parent; a >= 0 && outermost; a = nodes[a].parent)
+      outermost = nodes[a].procedure != n.procedure;
+    if (outermost)
+      p.inclusive += total[i];
+  }
+  return list;
+}
+
+void Profile::write_report( ostream &out) const
+{
+  long long total = instructions();
+  long long total_cycles = 0;
+  for (int op = 0; op < OPCODE_COUNT; op++)
+    total_cycles += opcode_cycles[op];
+  auto percent = [](long long part, long long whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+  };
+  ios::fmtflags flags = out.flags();
+  streamsize precision = out.precision();
+  out << fixed << setprecision(1);
+  out << " Instructions executed: " << total << endl
+      << " Estimated cycles: " << total_cycles << endl << endl;
+
+  vector<int> ops;
+  for (int op = 0; op < OPCODE_COUNT; op++)
+    if (opcode_counts[op])
+      ops.push_back(op);
+  stable_sort(ops.begin(), ops.end(), [this](int a, int b) {
+    return opcode_counts[a] > opcode_counts[b];
+  });
+  out << left << setw(18) << " operation" << right << setw(14) << "count"
+      << setw(8) << "%" << setw(16) << "cycles" << setw(8) << "%" << endl;
+  for (int op: ops)
+    out << " " << left << setw(17) << opcode_name[op] << right
+        << setw(14) << opcode_counts[op]
+        << setw(8) << percent(opcode_counts[op], total)
+        << setw(16) << opcode_cycles[op]
+        << setw(8) << percent(opcode_cycles[op], total_cycles) << endl;
+
+  vector<int> lines;
+  for (size_t line = 0; line < line_counts.size(); line++)
+    if (line_counts[line])
+      lines.push_back(line);
+  stable_sort(lines.begin(), lines.end(), [this](int a, int b) {
+    return line_counts[a] > line_counts[b];
+  });
+  out << endl << left << setw(18) << " line" << right << setw(14) << "count"
+      << setw(8) << "%" << endl;
+  for (int line: lines)
+    out << " " << left << setw(17) << (line ? to_string(line) : "unknown")
+        << right << setw(14) << line_counts[line]
+        << setw(8) << percent(line_counts[line], total) << endl;
+
+  vector<ProcedureProfile> procs = procedures();
+  stable_sort(procs.begin(), procs.end(),
+              [](const ProcedureProfile &a, const ProcedureProfile &b) {
+                return a.inclusive > b.inclusive;
+              });
+  out << endl << left << setw(24) << " procedure" << right << setw(10) << "calls"
+      << setw(14) << "exclusive" << setw(8) << "%"
+      << setw(14) << "inclusive" << setw(8) << "%" << endl;
+  for (auto &p: procs)
+    out << " " << left << setw(23) << p.name << right << setw(10) << p.calls
+        << setw(14) << p.exclusive << setw(8) << percent(p.exclusive, total)
+        << setw(14) << p.inclusive << setw(8) << percent(p.inclusive, total)
+        << endl;
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void Profile::write_stacks( ostream &out) const
+{
+  for (size_t i = 0; i < nodes.size(); i++)
+  {
+    if (!nodes[i].self)
+      continue;
+    string stack;
+    for (int n = i; n >= 0; n = nodes[n].parent)
+      stack = procedure_name(nodes[n].procedure) + (stack.empty() ? "" : ";") + stack;
+    out << stack << ' ' << nodes[i].self << endl;
+  }
+}
@@ -0,0 +1,131 @@
+//--------------------------------------------------
+// profile.h
+// Description	:	Counts of the instructions a program executes, by
+//                  operation, source line and procedure
+//-------------------------------------------------------
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// INCLUDES
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "interp.h"
+using namespace std;
+
+// CONSTANTS
+
+const int OPCODE_COUNT = OP_INDEX_UNCHECKED + 1;
+
+// TYPES
+
+// Instructions executed in a procedure, or in the main program
+struct ProcedureProfile
+{
+  string name;
+  long long calls;
+  long long exclusive;   // in its own code
+  long long inclusive;   // in its own code and the procedures it calls
+};
+
+// CLASSES
+
+//--------------------------------------------------
+// Given to an interpreter by set_profile, a profile counts each
+// instruction before it is executed: by operation, with an estimate of
+// the machine cycles it takes, by source line, and by the chain of calls
+// it was executed in. Procedures are known by the address CALL jumps to
+// and named by the line their body begins on.
+//
+// Source lines come from the line table of the assembled program. Without
+// one, only INDEX and FI instructions, which carry their line, are
+// counted by line, and the rest under line 0.
+//--------------------------------------------------
+
+class Profile
+{
+public:
+
+    // CONSTRUCTION
+
+    Profile();
+
+    // Source line of each word of the program, as given by the assembler
+    void set_lines(const vector<int> &);
+
+    // Start counting a run of the program in the first words of the store,
+    // forgetting the counts of the last run
+    void start(const int *, int);
+
+    // Count the instruction at the given address of the store, before it
+    // is executed
+    void count(const int *store, int address)
+    {
+      int opcode = store[address];
+      if (opcode < 0 || opcode >= OPCODE_COUNT)
+        return;
+      ++opcode_counts[opcode];
+      opcode_cycles[opcode] += cost[address];
+      ++line_counts[line_of[address]];
+      ++nodes[current].self;
+      if (opcode == OP_CALL)
+        enter(store[address + 2]);
+      else if (opcode == OP_ENDPROC && nodes[current].parent >= 0)
+        current = nodes[current].parent;
+    }
+
+    // ACCESS
+
+    long long instructions() const;
+    long long executed(OperationCode op) const { return opcode_counts[op]; }
+    long long cycles(OperationCode op) const { return opcode_cycles[op]; }
+
+    // Instructions executed on each source line, 0 for those with none
+    const vector<long long> &lines() const { return line_counts; }
+
+    // The main program and each procedure called, in the order first called
+    vector<ProcedureProfile> procedures() const;
+
+    // Counts by operation, line and procedure, most executed first
+    void write_report(ostream &) const;
+
+    // A line for each chain of calls that executed instructions, with the
+    // number it executed itself, as read by flame graph tools:
+    //     program;proc at line 5;proc at line 12 1042
+    void write_stacks(ostream &) const;
+
+private:
+
+    // A chain of calls from the main program, which is node 0
+    struct Node
+    {
+      int procedure;     // address of the procedure, -1 for the main program
+      int parent;
+      long long calls;
+      long long self;    // instructions executed in the procedure itself
+    };
+
+    // Move to the node for a call of the procedure at the address
+    void enter(int);
+
+    string procedure_name(int) const;
+
+    vector<int> line_table;
+    // Line and estimated cycles of the instruction at each address
+    vector<int> line_of;
+    vector<int> cost;
+
+    long long opcode_counts[OPCODE_COUNT];
+    long long opcode_cycles[OPCODE_COUNT];
+    vector<long long> line_counts;
+
+    vector<Node> nodes;
+    map<pair<int, int>, int> children;   // node of (parent, procedure)
+    int current;
+}; // end class Profile
+#endif
+// profile.h
@@ -0,0 +1,515 @@
+//-----------------------------------------------------------
+// regvm.cc
+//
+// Description: Register machine alternative to the PL stack machine
+//
+//-------------------------------------------------------------
+
+// INCLUDES
+
+#include <iostream>
+#include "regvm.h"
+
+// FUNCTIONS
+
+RegisterMachine::RegisterMachine( Interpreter &interpreter)
+  : interp(interpreter), frame_top(0), max_depth(0)
+{
+}
+
+RegisterMachine::Operand RegisterMachine::operand( Mode mode, int value, int level)
+{
+  Operand o;
+  o.mode = mode;
+  o.level = level;
+  o.value = value;
+  return o;
+}
+
+int RegisterMachine::emit( Operation op, Operand dst, Operand a, Operand b,
+                           int x, int y)
+{
+  Instruction in;
+  in.op = op;
+  in.dst = dst;
+  in.a = a;
+  in.b = b;
+  in.x = x;
+  in.y = y;
+  code.push_back(in);
+  return code.size() - 1;
+}
+
+//---------------------------------
+// Translation. The stack is simulated, holding operands that name where
+// each value can be found instead of copying it to its own word
+//---------------------------------
+
+// Displacement of the word the stack machine would use for stack[k]
+
+int RegisterMachine::slot( int k)
+{
+  return frame_top + 1 + k;
+}
+
+// Copy stack[k] to its own word
+
+void RegisterMachine::materialize( int k)
+{
+  Operand own = operand(SLOT, slot(k));
+  if (stack[k].mode == SLOT && stack[k].value == own.value)
+    return;
+  emit(R_MOVE, own, stack[k], operand(IMMEDIATE, 0));
+  stack[k] = own;
+}
+
+// Operand for the word whose address is stack[k], usable as a value or
+// as the destination of an instruction
+
+RegisterMachine::Operand RegisterMachine::lvalue_of( int k)
+{
+  Operand &address = stack[k];
+  if (address.mode == LOCAL_ADDR)
+    return operand(SLOT, address.value);
+  if (address.mode == OUTER_ADDR)
+    return operand(OUTER, address.value, address.level);
+  materialize(k);
+  return operand(DEREF, slot(k));
+}
+
+// Replace the top two values by the result of op
+
+void RegisterMachine::binary( Operation op)
+{
+  int k = stack.size() - 2;
+  Operand own = operand(SLOT, slot(k));
+  emit(op, own, stack[k], stack[k + 1]);
+  stack.pop_back();
+  stack[k] = own;
+}
+
+bool RegisterMachine::translate()
+{
+  code.clear();
+  stack.clear();
+  address_map.assign(interp.stack_bottom + 1, -1);
+
+  // Jump targets, where the stack must be empty as nothing is known
+  // about the values on it
+  std::vector<bool> target(interp.stack_bottom + 1, false);
+  int pc = 0;
+  while (pc < interp.stack_bottom)
+  {
+    int opcode = interp.store[pc];
+    if (opcode < OP_ADD || opcode > OP_INDEX_UNCHECKED)
+      return false;
+    int *args = &interp.store[pc + 1];
+    int address = -1;
+    if (opcode == OP_ARROW || opcode == OP_BAR)
+      address = args[0];
+    else if (opcode == OP_CALL || opcode == OP_PROC || opcode == OP_PROG)
+      address = args[1];
+    if (address != -1)
+    {
+      if (address < 0 || address >= interp.stack_bottom)
+        return false;
+      target[address] = true;
+    }
+    pc += 1 + operand_count[opcode];
+  }
+
+  // Enclosing frames while translating nested procedures: the last
+  // variable, deepest stack and the instruction that allocates the frame
+  struct Frame { int top, depth, entry; };
+  std::vector<Frame> frames;
+  int entry = -1;
+  Operand none = operand(IMMEDIATE, 0);
+
+  pc = 0;
+  while (pc < interp.stack_bottom)
+  {
+    int opcode = interp.store[pc];
+    int *args = &interp.store[pc + 1];
+    if (target[pc] && !stack.empty())
+      return false;
+    address_map[pc] = code.size();
+    int k = stack.size() - 1;
+
+    // Values each operation takes from the stack, 2 for binary operations
+    // and indexing
+    int pops = 2;
+    if (opcode == OP_VALUE || opcode == OP_NOT || opcode == OP_MINUS ||
+        opcode == OP_ARROW)
+      pops = 1;
+    else if (opcode == OP_READ || opcode == OP_WRITE)
+      pops = args[0];
+    else if (opcode == OP_ASSIGN)
+      pops = 2 * args[0];
+    else if (opcode == OP_VARIABLE || opcode == OP_CONSTANT || opcode == OP_CALL ||
+             opcode == OP_BAR || opcode == OP_FI || opcode == OP_PROC ||
+             opcode == OP_PROG || opcode == OP_ENDPROC || opcode == OP_ENDPROG)
+      pops = 0;
+    if ((int) stack.size() < pops)
+      return false;
+
+    switch (opcode)
+    {
+      case OP_VARIABLE:
+        if (args[0] == 0)
+          stack.push_back(operand(LOCAL_ADDR, args[1]));
+        else
+          stack.push_back(operand(OUTER_ADDR, args[1], args[0]));
+        break;
+      case OP_CONSTANT:
+        stack.push_back(operand(IMMEDIATE, args[0]));
+        break;
+      case OP_VALUE:
+        stack[k] = lvalue_of(k);
+        break;
+      case OP_INDEX:
+      case OP_INDEX_UNCHECKED:
+      {
+        Operand own = operand(SLOT, slot(k - 1));
+        emit(opcode == OP_INDEX ? R_INDEX : R_INDEX_UNCHECKED,
+             own, stack[k - 1], stack[k], args[0], args[1]);
+        stack.pop_back();
+        stack[k - 1] = own;
+        break;
+      }
+      case OP_NOT:
+      case OP_MINUS:
+      {
+        Operand own = operand(SLOT, slot(k));
+        emit(opcode == OP_NOT ? R_NOT : R_NEGATE, own, stack[k], none);
+        stack[k] = own;
+        break;
+      }
+      case OP_ADD:      binary(R_ADD);      break;
+      case OP_SUBTRACT: binary(R_SUBTRACT); break;
+      case OP_MULTIPLY: binary(R_MULTIPLY); break;
+      case OP_DIVIDE:   binary(R_DIVIDE);   break;
+      case OP_MODULO:   binary(R_MODULO);   break;
+      case OP_LESS:     binary(R_LESS);     break;
+      case OP_EQUAL:    binary(R_EQUAL);    break;
+      case OP_GREATER:  binary(R_GREATER);  break;
+      case OP_AND:      binary(R_AND);      break;
+      case OP_OR:       binary(R_OR);       break;
+      case OP_READ:
+      case OP_WRITE:
+      {
+        int first = stack.size() - args[0];
+        for (int i = first; i < (int) stack.size(); i++)
+        {
+          if (opcode == OP_READ)
+            emit(R_READ, lvalue_of(i), none, none);
+          else
+            emit(R_WRITE, none, stack[i], none);
+        }
+        stack.resize(first);
+        break;
+      }
+      case OP_ASSIGN:
+      {
+        int count = args[0];
+        int first = stack.size() - 2 * count;
+        if (count > 1)
+        {
+          // Every value is taken before any variable changes
+          for (int i = first + count; i < (int) stack.size(); i++)
+            if (stack[i].mode != IMMEDIATE)
+              materialize(i);
+        }
+        for (int i = first; i < first + count; i++)
+        {
+          size_t emitted = code.size();
+          Operand dst = lvalue_of(i);
+          Operand src = stack[i + count];
+          // A result computed just before can be stored straight to the
+          // variable instead of being copied
+          if (count == 1 && emitted == code.size() && !code.empty() &&
+              src.mode == SLOT && src.value == slot(i + count) &&
+              code.back().dst.mode == SLOT && code.back().dst.value == src.value)
+            code.back().dst = dst;
+          else
+            emit(R_MOVE, dst, src, none);
+        }
+        stack.resize(first);
+        break;
+      }
+      case OP_CALL:
+        for (int i = 0; i < (int) stack.size(); i++)
+          materialize(i);
+        emit(R_CALL, none, operand(IMMEDIATE, args[0]), operand(IMMEDIATE, pc + 3),
+             args[1], frame_top + stack.size());
+        break;
+      case OP_ARROW:
+        emit(R_JUMP_FALSE, none, stack[k], none, args[0]);
+        stack.pop_back();
+        if (!stack.empty())
+          return false;
+        break;
+      case OP_BAR:
+        if (!stack.empty())
+          return false;
+        emit(R_JUMP, none, none, none, args[0]);
+        break;
+      case OP_FI:
+        emit(R_FI, none, none, none, args[0]);
+        stack.clear();
+        break;
+      case OP_PROC:
+      case OP_PROG:
+        if (!stack.empty())
+          return false;
+        if (opcode == OP_PROC)
+        {
+          Frame enclosing = { frame_top, max_depth, entry };
+          frames.push_back(enclosing);
+        }
+        frame_top = args[0] + 2;
+        max_depth = 0;
+        // a holds the frame without its stack and b the address of the
+        // body, for handing the run to the stack machine
+        entry = emit(opcode == OP_PROC ? R_PROC : R_PROG, none,
+                     operand(IMMEDIATE, frame_top), operand(IMMEDIATE, args[1]),
+                     args[1], frame_top);
+        break;
+      case OP_ENDPROC:
+      case OP_ENDPROG:
+        if (!stack.empty() || (opcode == OP_ENDPROC && frames.empty()))
+          return false;
+        // The frame is checked for room for its deepest stack on entry.
+        // The loader repeats the last word, so a second endprog may follow
+        if (entry != -1)
+          code[entry].y += max_depth;
+        emit(opcode == OP_ENDPROC ? R_RETURN : R_HALT, none, none, none);
+        if (opcode == OP_ENDPROC)
+        {
+          frame_top = frames.back().top;
+          max_depth = frames.back().depth;
+          entry = frames.back().entry;
+          frames.pop_back();
+        }
+        else
+          entry = -1;
+        break;
+      default:
+        return false;
+    }
+    if ((int) stack.size() > max_depth)
+      max_depth = stack.size();
+    pc += 1 + operand_count[opcode];
+  }
+
+  for (size_t i = 0; i < code.size(); i++)
+  {
+    Operation op = code[i].op;
+    if (op == R_JUMP || op == R_JUMP_FALSE || op == R_CALL ||
+        op == R_PROC || op == R_PROG)
+    {
+      code[i].x = address_map[code[i].x];
+      if (code[i].x == -1)
+        return false;
+    }
+  }
+  return address_map[0] == 0 && !code.empty();
+}
+
+//---------------------------------
+// Execution
+//---------------------------------
+
+int RegisterMachine::frame_base( int level) const
+{
+  int x = interp.base_register;
+  while (level-- > 0)
+    x = interp.store[x];
+  return x;
+}
+
+int RegisterMachine::value( const Operand &o) const
+{
+  int *store = interp.store;
+  switch (o.mode)
+  {
+    case IMMEDIATE:  return o.value;
+    case SLOT:       return store[interp.base_register + o.value];
+    case OUTER:      return store[frame_base(o.level) + o.value];
+    case DEREF:      return store[store[interp.base_register + o.value]];
+    case LOCAL_ADDR: return interp.base_register + o.value;
+    default:         return frame_base(o.level) + o.value;
+  }
+}
+
+int &RegisterMachine::lvalue( const Operand &o)
+{
+  int *store = interp.store;
+  switch (o.mode)
+  {
+    case SLOT:  return store[interp.base_register + o.value];
+    case OUTER: return store[frame_base(o.level) + o.value];
+    default:    return store[store[interp.base_register + o.value]];
+  }
+}
+
+bool RegisterMachine::run()
+{
+  int *store = interp.store;
+  int &bp = interp.base_register;
+  int pc = 0;
+  interp.running = true;
+
+  while (interp.running)
+  {
+    const Instruction &in = code[pc++];
+    ++interp.dispatches;
+    switch (in.op)
+    {
+      case R_MOVE:
+        lvalue(in.dst) = value(in.a);
+        break;
+      case R_ADD:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = a + b;
+        break;
+      }
+      case R_SUBTRACT:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = a - b;
+        break;
+      }
+      case R_MULTIPLY:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = a * b;
+        break;
+      }
+      case R_DIVIDE:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = a / b;
+        break;
+      }
+      case R_MODULO:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = a % b;
+        break;
+      }
+      case R_LESS:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = a < b;
+        break;
+      }
+      case R_EQUAL:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = a == b;
+        break;
+      }
+      case R_GREATER:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = a > b;
+        break;
+      }
+      case R_AND:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = (a == 1 ? b : a);
+        break;
+      }
+      case R_OR:
+      {
+        int a = value(in.a), b = value(in.b);
+        lvalue(in.dst) = (a == 0 ? b : a);
+        break;
+      }
+      case R_NEGATE:
+        lvalue(in.dst) = -value(in.a);
+        break;
+      case R_NOT:
+        lvalue(in.dst) = 1 - value(in.a);
+        break;
+      case R_INDEX:
+      {
+        int i = value(in.b);
+        if (i < 1 || i > in.x)
+          interp.runtime_error(" range error", in.y);
+        else
+          lvalue(in.dst) = value(in.a) + i - 1;
+        break;
+      }
+      case R_INDEX_UNCHECKED:
+      {
+        int i = value(in.b);
+        lvalue(in.dst) = value(in.a) + i - 1;
+        break;
+      }
+      case R_READ:
+        interp.input(lvalue(in.dst));
+        break;
+      case R_WRITE:
+        interp.output(value(in.a));
+        break;
+      case R_JUMP:
+        pc = in.x;
+        break;
+      case R_JUMP_FALSE:
+        if (value(in.a) != 1)
+          pc = in.x;
+        break;
+      case R_CALL:
+      {
+        // Same activation record as the stack machine builds
+        int link = frame_base(in.a.value);
+        int base = bp + in.y + 1;
+        if (base + 2 > STORE_SIZE)
+        {
+          interp.runtime_error(" stack overflow");
+          break;
+        }
+        store[base] = link;
+        store[base + 1] = bp;
+        store[base + 2] = in.b.value;
+        bp = base;
+        pc = in.x;
+        break;
+      }
+      case R_FI:
+        interp.runtime_error(" if statement fails", in.x);
+        break;
+      case R_PROG:
+        bp = interp.stack_bottom;
+        // fall through
+      case R_PROC:
+        if (bp + in.y > STORE_SIZE)
+        {
+          if (bp + in.a.value > STORE_SIZE)
+          {
+            interp.runtime_error(" stack overflow");
+            break;
+          }
+          // The variables fit but not the deepest stack, which the stack
+          // machine only needs if it is reached. It carries on from the
+          // body with the registers it would have had
+          interp.stack_register = bp + in.a.value;
+          interp.program_register = in.b.value;
+          return false;
+        }
+        pc = in.x;
+        break;
+      case R_RETURN:
+        pc = address_map[store[bp + 2]];
+        bp = store[bp + 1];
+        break;
+      case R_HALT:
+        interp.running = false;
+        break;
+    }
+  }
+  return true;
+}
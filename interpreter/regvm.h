@@ -0,0 +1,101 @@
+//--------------------------------------------------
+// regvm.h
+// Description	:	Three-address register code translated from the
+//                  loaded PL machine code, and the machine that runs it
+//-------------------------------------------------------
+
+#ifndef REGVM_H
+#define REGVM_H
+
+// INCLUDES
+
+#include <vector>
+#include "interp.h"
+
+// CLASSES
+
+//--------------------------------------------------
+// Registers are the words of the current activation record, addressed
+// relative to the base register. Named variables keep their displacement
+// and each expression stack position gets the word the stack machine
+// would have pushed it to, so the store is laid out as before.
+//--------------------------------------------------
+
+class RegisterMachine
+{
+public:
+
+    // CONSTRUCTION
+
+    RegisterMachine(Interpreter &);
+
+    // Translate the program in store[0 .. stack_bottom). Returns false
+    // if the stack is not empty at every jump, or an operation is not
+    // known, in which case the program must be interpreted
+    bool translate();
+
+    // Run the translated program to completion. Returns false if a
+    // frame has no room for its deepest stack, leaving the registers set
+    // for the stack machine to carry on from the start of its body
+    bool run();
+
+    // Number of register instructions, for comparison with the program
+    int size() const { return code.size(); }
+
+private:
+    enum Mode
+    {
+      IMMEDIATE,   // value
+      SLOT,        // store[bp + displacement]
+      OUTER,       // store[frame + displacement], level static links out
+      DEREF,       // store[store[bp + displacement]]
+      LOCAL_ADDR,  // bp + displacement
+      OUTER_ADDR   // frame + displacement
+    };
+
+    struct Operand
+    {
+      Mode mode;
+      int level;
+      int value;   // displacement or immediate value
+    };
+
+    enum Operation
+    {
+      R_MOVE, R_ADD, R_SUBTRACT, R_MULTIPLY, R_DIVIDE, R_MODULO,
+      R_LESS, R_EQUAL, R_GREATER, R_AND, R_OR, R_NEGATE, R_NOT,
+      R_INDEX, R_INDEX_UNCHECKED, R_READ, R_WRITE, R_JUMP, R_JUMP_FALSE,
+      R_CALL, R_FI, R_PROC, R_PROG, R_RETURN, R_HALT
+    };
+
+    // dst := a op b, with x and y holding any other arguments
+    struct Instruction
+    {
+      Operation op;
+      Operand dst, a, b;
+      int x, y;
+    };
+
+    Operand operand(Mode, int, int = 0);
+    int emit(Operation, Operand, Operand, Operand, int = 0, int = 0);
+
+    // Expression stack during translation
+    int slot(int);
+    void materialize(int);
+    Operand lvalue_of(int);
+    void binary(Operation);
+
+    int frame_base(int) const;
+    int value(const Operand &) const;
+    int &lvalue(const Operand &);
+
+    Interpreter &interp;
+    std::vector<Instruction> code;
+    std::vector<int> address_map;  // register code index of each address
+
+    std::vector<Operand> stack;    // values not yet in their own word
+    int frame_top;                 // displacement of the last variable
+    int max_depth;                 // deepest stack in the current frame
+}; // end class RegisterMachine
+#endif
+// regvm.h
@@ -0,0 +1,74 @@
+/*  Run-time support for PL programs compiled with plc --target=x86-64. The generated assembly
+    provides pl_main and the store; this file provides the entry point and everything that needs
+    the C library. Messages match those of the interpreter
+*/
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int pl_store[];
+extern const int pl_store_words;
+void pl_main(void);
+
+/* Set once input could not be read, after which the interpreter leaves variables unchanged */
+static int input_failed = 0;
+
+void pl_read(int *variable)
+{
+    printf("Input: ");
+    if (input_failed) {
+        return;
+    }
+    int value;
+    int result = scanf("%d", &value);
+    if (result == 1) {
+        *variable = value;
+        return;
+    }
+    /* Text that is not a number reads as 0, end of input leaves the variable as it was */
+    if (result == 0) {
+        *variable = 0;
+    }
+    input_failed = 1;
+}
+
+void pl_write(int value)
+{
+    printf("  Output: %d\n", value);
+}
+
+static void runtime_error(const char *message, int line_number)
+{
+    fflush(stdout);
+    if (line_number != -1) {
+        fprintf(stderr, "line %d : %s\n", line_number, message);
+    }
+    else {
+        fprintf(stderr, "%s\n", message);
+    }
+    exit(0);
+}
+
+void pl_range_error(int line_number)
+{
+    runtime_error(" range error", line_number);
+}
+
+void pl_fi_error(int line_number)
+{
+    runtime_error(" if statement fails", line_number);
+}
+
+void pl_stack_overflow(void)
+{
+    runtime_error(" stack overflow", -1);
+}
+
+int main(void)
+{
+    /* Unused words of the interpreter's store read as -1 */
+    for (int i = 0; i < pl_store_words; i++) {
+        pl_store[i] = -1;
+    }
+    pl_main();
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*  Replacement operator new and delete counting every heap allocation in HeapCounters, once it is
+    enabled by plc --time-report. Until then they only call malloc and free. Linked into plc only
+*/
+
+#include "time_report.h"
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+
+static void *allocate(size_t size)
+{
+    void *p = malloc(size ? size : 1);
+    if (p && HeapCounters::enabled()) {
+        HeapCounters::allocated(malloc_usable_size(p));
+    }
+    return p;
+}
+
+
+static void release(void *p)
+{
+    if (p && HeapCounters::enabled()) {
+        HeapCounters::freed(malloc_usable_size(p));
+    }
+    free(p);
+}
+
+
+void *operator new(size_t size)
+{
+    void *p = allocate(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+
+void operator delete(void *p) noexcept
+{
+    release(p);
+}
+
+
+void operator delete[](void *p) noexcept
+{
+    release(p);
+}
+
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    release(p);
+}
+
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    release(p);
+}
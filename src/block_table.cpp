@@ -15,35 +15,61 @@ BlockTable::BlockTable(): curr_level{0} {}
 
 void BlockTable::push_new() {
     curr_level++;
-    table.push_back(Block());
+    block_starts.push_back(definitions.size());
 }
 
 void BlockTable::pop()
 {
-    assert(table.size() > 0);
-    table.erase(table.end() - 1);
+    assert(block_starts.size() > 0);
+    // Undo the block's definitions, latest first
+    while ((int)definitions.size() > block_starts.back()) {
+        *undo.back() = shadowed.back();
+        undo.pop_back();
+        shadowed.pop_back();
+        definitions.pop_back();
+    }
+    block_starts.pop_back();
     curr_level--;
 }
 
-BlockData& BlockTable::find(std::string id) 
+BlockData *BlockTable::lookup(const std::string &id)
+{
+    assert(block_starts.size() > 0);
+    auto found = innermost.find(id);
+    if (found == innermost.end() || found->second < 0) {
+        return nullptr;
+    }
+    return &definitions[found->second];
+}
+
+const BlockData *BlockTable::lookup(const std::string &id, int count) const
 {
-    assert(table.size() > 0);
-    for (auto it = table.rbegin(); it != table.rend(); it++) {
-        if (it->find(id) != it->end()) {
-            return it->at(id);
-        }
+    auto found = innermost.find(id);
+    if (found == innermost.end()) {
+        return nullptr;
+    }
+    // Definitions made later shadow earlier ones, so the one wanted is further down the chain
+    int index = found->second;
+    while (index >= count) {
+        index = shadowed[index];
     }
-    throw scope_error("Identifier " + id + " is undefined");
+    return index < 0 ? nullptr : &definitions[index];
 }
 
-void BlockTable::insert(std::string id, BlockData new_block)
+bool BlockTable::insert(const std::string &id, const BlockData &new_block)
 {
-    assert(table.size() > 0);
-    auto last = table.rbegin();
-    if (last->find(id) != last->end()) {
-        throw scope_error("Identifier " + id + " already defined in currents scope");
+    assert(block_starts.size() > 0);
+    // Entries of an unordered_map don't move when it grows, so the undo log can point to them
+    int &head = innermost.emplace(id, -1).first->second;
+    // Definitions in enclosing blocks are shadowed, but not one in the same block
+    if (head >= block_starts.back()) {
+        return false;
     }
+    shadowed.push_back(head);
+    undo.push_back(&head);
+    head = definitions.size();
+    definitions.push_back(new_block);
     // automatically set the level
-    new_block.level = curr_level;
-    last->emplace(id, new_block);
+    definitions.back().level = curr_level;
+    return true;
 }
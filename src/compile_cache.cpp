@@ -0,0 +1,213 @@
+#include "compile_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static const std::string ENTRY_HEADER = "plc-cache 2";
+
+// Length of an entry's name, the key in hexadecimal
+static const size_t KEY_LENGTH = 32;
+
+// Seconds after which a temporary file no longer being written is removed
+static const long STALE_SECONDS = 3600;
+
+// Number of each temporary file written by this process
+static std::atomic<unsigned long> temp_count(0);
+
+// 64 bit FNV-1a, starting from basis
+static unsigned long long fnv1a(const std::string &data, unsigned long long basis)
+{
+    unsigned long long hash = basis;
+    for (unsigned char c: data) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Whether name begins with a key
+static bool starts_with_key(const std::string &name)
+{
+    return name.size() >= KEY_LENGTH &&
+           name.find_first_not_of("0123456789abcdef") >= KEY_LENGTH;
+}
+
+// Create directory and any missing parents
+static void make_directories(const std::string &directory)
+{
+    for (size_t slash = directory.find('/', 1); ; slash = directory.find('/', slash + 1)) {
+        mkdir(directory.substr(0, slash).c_str(), 0777);
+        if (slash == std::string::npos) {
+            break;
+        }
+    }
+}
+
+
+CompileCache::CompileCache(const std::string &dir, long long max, const CompilerOptions &options) :
+    directory(dir), max_bytes(max), num_hits(0), num_misses(0)
+{
+    make_directories(directory);
+    /*  Any change to the compiler executable changes its size or modification time, and so every
+        key, without needing a version number to be kept up to date
+    */
+    std::ostringstream text;
+    struct stat exe;
+    if (stat("/proc/self/exe", &exe) == 0) {
+        text << exe.st_size << ':' << exe.st_mtim.tv_sec << '.' << exe.st_mtim.tv_nsec;
+    }
+    text << ' ' << options.debug << options.bounds_elim << options.dead_code_elim << ' '
+         << options.inline_limit << ' ' << options.line_table << ' ' << options.target << ' ' << options.diagnostics_format;
+    settings = text.str();
+}
+
+
+std::string CompileCache::key_text(const std::string &source) const
+{
+    return settings + '\0' + source;
+}
+
+
+std::string CompileCache::entry_path(const std::string &source) const
+{
+    std::string data = key_text(source);
+    char name[33];
+    snprintf(name, sizeof(name), "%016llx%016llx", fnv1a(data, 0xcbf29ce484222325ULL),
+             fnv1a(data, 0x84222325cbf29ce4ULL));
+    return directory + "/" + name;
+}
+
+
+bool CompileCache::compile(Compiler &compiler, const std::string &source, std::ostream &output,
+                           std::ostream &out, std::ostream &err)
+{
+    std::string path = entry_path(source);
+    Entry entry;
+    entry.key = key_text(source);
+    if (load(path, entry)) {
+        // Mark the entry as recently used
+        utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+        num_hits++;
+    }
+    else {
+        std::istringstream input(source);
+        std::ostringstream compiled, messages, errors;
+        compiler.set_message_streams(messages, errors);
+        entry.failed = compiler.compile(input, compiled);
+        compiler.set_message_streams(out, err);
+        entry.output = compiled.str();
+        entry.out = messages.str();
+        entry.err = errors.str();
+        save(path, entry);
+        num_misses++;
+    }
+    // Messages to each stream are in order, as when compiling directly
+    out << entry.out;
+    err << entry.err;
+    output << entry.output;
+    return entry.failed;
+}
+
+
+bool CompileCache::load(const std::string &path, Entry &entry)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string header;
+    if (!std::getline(file, header) || header != ENTRY_HEADER) {
+        return false;
+    }
+    // Names can collide, so the entry is only used if it was compiled from the same key
+    std::string key;
+    file >> entry.failed;
+    for (std::string *part: {&key, &entry.output, &entry.out, &entry.err}) {
+        size_t length;
+        if (!(file >> length) || file.get() != '\n') {
+            return false;
+        }
+        part->resize(length);
+        if (length > 0 && !file.read(&(*part)[0], length)) {
+            return false;
+        }
+    }
+    return key == entry.key;
+}
+
+
+void CompileCache::save(const std::string &path, const Entry &entry)
+{
+    // Threads of one process, as well as processes, write their own temporary files
+    std::string temp = path + ".tmp" + std::to_string(getpid()) + "." + std::to_string(temp_count++);
+    {
+        std::ofstream file(temp, std::ios::binary);
+        file << ENTRY_HEADER << '\n' << entry.failed << '\n';
+        for (const std::string *part: {&entry.key, &entry.output, &entry.out, &entry.err}) {
+            file << part->size() << '\n' << *part;
+        }
+        if (!file.good()) {
+            file.close();
+            std::remove(temp.c_str());
+            return;
+        }
+    }
+    std::rename(temp.c_str(), path.c_str());
+}
+
+
+void CompileCache::evict()
+{
+    struct File
+    {
+        std::string path;
+        long long size;
+        struct timespec used;
+    };
+    std::vector<File> files;
+    long long total = 0;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+    // Only entries and the temporary files they are written to are touched, never other files
+    time_t now = time(nullptr);
+    while (dirent *item = readdir(dir)) {
+        std::string name = item->d_name;
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if (!starts_with_key(name) || lstat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+        if (name.size() == KEY_LENGTH) {
+            files.push_back(File{path, (long long)info.st_size, info.st_mtim});
+            total += info.st_size;
+        }
+        // Left by a process that stopped while writing it
+        else if (name.compare(KEY_LENGTH, 4, ".tmp") == 0 && now - info.st_mtime > STALE_SECONDS) {
+            std::remove(path.c_str());
+        }
+    }
+    closedir(dir);
+    if (total <= max_bytes) {
+        return;
+    }
+    std::sort(files.begin(), files.end(), [](const File &a, const File &b) {
+        return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec 
+                                              : a.used.tv_nsec < b.used.tv_nsec;
+    });
+    for (auto &file: files) {
+        if (total <= max_bytes) {
+            break;
+        }
+        if (std::remove(file.path.c_str()) == 0) {
+            total -= file.size;
+        }
+    }
+}
@@ -1,45 +1,262 @@
 #include "compiler.h"
 #include "symbol.h"
+#include "optimizer.h"
+#include "x86_backend.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <numeric>
+#include <sstream>
 
 
-Compiler::Compiler(std::ifstream &input_file, std::ofstream &output_file, bool debug) : 
-    scanner(input_file, sym_table), 
-    parser(debug),
-    output(output_file),
-    current_line(1), 
-    error_count(0) {}
+CompilerOptions::CompilerOptions(): 
+    debug(false), bounds_elim(true), dead_code_elim(true), inline_limit(30), line_table(false),
+    target("plam"), diagnostics_format("text"), incremental(false), procedure_threads(1) {}
+
+
+Compiler::Compiler(std::ifstream &input_file, std::ofstream &output_file, CompilerOptions opts) : 
+    input(&input_file),
+    output(&output_file),
+    options(opts),
+    out(&std::cout),
+    err(&std::cerr),
+    // The final code is printed here in debug mode, after optimization
+    parser(false, opts.bounds_elim),
+    current_line(1),
+    error_lines(0),
+    symbols(nullptr),
+    time_report(nullptr)
+{
+    if (options.incremental) {
+        parser.set_procedure_cache(&procedure_cache);
+    }
+    parser.set_threads(options.procedure_threads);
+}
+
+Compiler::Compiler(CompilerOptions opts) : 
+    input(nullptr),
+    output(nullptr),
+    options(opts),
+    out(&std::cout),
+    err(&std::cerr),
+    parser(false, opts.bounds_elim),
+    current_line(1),
+    error_lines(0),
+    symbols(nullptr),
+    time_report(nullptr)
+{
+    if (options.incremental) {
+        parser.set_procedure_cache(&procedure_cache);
+    }
+    parser.set_threads(options.procedure_threads);
+}
+
+void Compiler::set_message_streams(std::ostream &out_stream, std::ostream &err_stream)
+{
+    out = &out_stream;
+    err = &err_stream;
+    parser.set_message_stream(out_stream);
+}
+
+void Compiler::set_symbol_index(SymbolIndex *index)
+{
+    symbols = index;
+    parser.set_symbol_index(index);
+}
 
 bool Compiler::run()
 {
+    return compile(*input, *output);
+}
+
+bool Compiler::compile(std::istream &input, std::ostream &output)
+{
+    // Identifiers of the previous program are forgotten, the reserved words are kept
+    sym_table.reset();
+    current_line = 1;
+    diagnostics.clear();
+    if (symbols) {
+        symbols->clear();
+        symbols->finish();
+    }
+    bool failed = options.incremental ? recompile(input, output) : translate(input, output);
+    if (options.diagnostics_format == "json") {
+        diagnostics.render_json(*err);
+    }
+    else {
+        diagnostics.render_text(*err);
+    }
+    return failed;
+}
+
+bool Compiler::translate(std::istream &input, std::ostream &output)
+{
+    Scanner scanner(input, sym_table);
     std::vector<Token> input_tokens;    
-    if (scan(input_tokens)) {
-        return true;
+    {
+        TimeReport::Scope phase(time_report, "scan");
+        if (scan(scanner, input_tokens)) {
+            return true;
+        }
     }
-    std::cout << "Scan completed without errors" << std::endl;
-    std::string plam_prog;
-    if (parser.verify_syntax(&input_tokens, plam_prog)) {
-        std::cout << "Parsing completed with errors - no output written" << std::endl;
+    *out << "Scan completed without errors" << std::endl;
+    return generate(input_tokens, output);
+}
+
+bool Compiler::generate(std::vector<Token> &tokens, std::ostream &output)
+{
+    std::vector<Instruction> plam_prog;
+    int parse_errors;
+    {
+        TimeReport::Scope phase(time_report, "parse/check");
+        parse_errors = parser.verify_syntax(&tokens, plam_prog);
+    }
+    diagnostics.append(parser.messages());
+    if (time_report) {
+        time_report->count("tokens", tokens.size());
+        time_report->count("labels", parser.labels());
+        time_report->count("instructions parsed", plam_prog.size());
+    }
+    if (parse_errors) {
+        *out << "Parsing completed with errors - no output written" << std::endl;
         return true;
     }
-    std::cout << "Parsing completed without errors" << std::endl;
-    output << plam_prog;
+    *out << "Parsing completed without errors" << std::endl;
+    {
+        TimeReport::Scope phase(time_report, "optimize");
+        Optimizer optimizer(plam_prog);
+        if (options.inline_limit > 0) {
+            optimizer.inline_procedures(options.inline_limit);
+        }
+        // Inlined procedures are usually left unreachable, so this runs afterwards
+        if (options.dead_code_elim) {
+            optimizer.eliminate_dead_code();
+        }
+    }
+    if (time_report) {
+        time_report->count("instructions written", plam_prog.size());
+    }
+    std::string plam_text_prog, target_text;
+    {
+        TimeReport::Scope phase(time_report, "emit");
+        plam_text_prog = plam_text(plam_prog, options.line_table);
+        if (options.target == "x86-64") {
+            target_text = X86Backend(plam_prog).assembly();
+        }
+    }
+    if (options.debug) {
+        *out << plam_text_prog;
+    }
+    TimeReport::Scope phase(time_report, "write");
+    output << (options.target == "x86-64" ? target_text : plam_text_prog);
+    // Written to the file now rather than when it is closed, so it is measured
+    if (time_report) {
+        output.flush();
+    }
     return false;
 }
 
-int Compiler::scan(std::vector<Token> &scanner_output)
+bool Compiler::recompile(std::istream &input, std::ostream &output)
 {
-    auto token_list = tokenize();
+    std::ostringstream program_text;
+    program_text << input.rdbuf();
+    std::string text = program_text.str();
+    {
+        TimeReport::Scope phase(time_report, "scan");
+        rescan(text);
+    }
+    if (error_lines) {
+        std::istringstream program(text);
+        return translate(program, output);
+    }
+    *out << "Scan completed without errors" << std::endl;
+    return generate(tokens, output);
+}
+
+void Compiler::rescan(const std::string &text)
+{
+    if (tokens.empty()) {
+        // Nothing kept yet: the previous program was the empty text, with a single empty line
+        tokens.push_back(Token(END_OF_FILE, "EOF"));
+        line_tokens.assign(1, 0);
+        line_errors.assign(1, 0);
+        error_lines = 0;
+    }
+    // The changed text starts at the beginning of the line of the first difference...
+    size_t common = std::min(text.size(), source.size());
+    size_t prefix = std::mismatch(text.begin(), text.begin() + common, source.begin()).first -
+                    text.begin();
+    while (prefix > 0 && text[prefix - 1] != '\n') {
+        prefix--;
+    }
+    // ...and ends at the beginning of a line after the last one
+    size_t suffix = 0;
+    while (suffix < common - prefix &&
+           text[text.size() - 1 - suffix] == source[source.size() - 1 - suffix]) {
+        suffix++;
+    }
+    auto line_start = [&suffix](const std::string &s) {
+        return s.size() == suffix || s[s.size() - 1 - suffix] == '\n';
+    };
+    while (suffix > 0 && !(line_start(text) && line_start(source))) {
+        suffix--;
+    }
+    size_t first_line = std::count(text.begin(), text.begin() + prefix, '\n');
+    size_t kept_lines = suffix ? std::count(text.end() - suffix, text.end(), '\n') + 1 : 0;
+    size_t old_lines = line_tokens.size() - first_line - kept_lines;
+
+    // Each line's tokens end with its newline. Scanning stops at the end of the changed lines
+    std::istringstream changed(text.substr(prefix, text.size() - suffix - prefix));
+    Scanner scanner(changed, sym_table);
+    std::vector<Token> new_tokens;
+    std::vector<int> new_counts(1, 0);
+    std::vector<char> new_errors(1, 0);
+    for (Token tok = scanner.get_token(); tok.symbol != END_OF_FILE; tok = scanner.get_token()) {
+        new_tokens.push_back(tok);
+        new_counts.back()++;
+        new_errors.back() |= error_token(tok);
+        if (tok.symbol == NEWLINE) {
+            new_counts.push_back(0);
+            new_errors.push_back(0);
+        }
+    }
+    // Changed lines ending with a newline don't start another line
+    if (suffix) {
+        new_counts.pop_back();
+        new_errors.pop_back();
+    }
+
+    size_t start = std::accumulate(line_tokens.begin(), line_tokens.begin() + first_line, (size_t)0);
+    size_t old_count = std::accumulate(line_tokens.begin() + first_line,
+                                       line_tokens.begin() + first_line + old_lines, (size_t)0);
+    if (old_count == new_tokens.size()) {
+        std::copy(new_tokens.begin(), new_tokens.end(), tokens.begin() + start);
+    }
+    else {
+        tokens.erase(tokens.begin() + start, tokens.begin() + start + old_count);
+        tokens.insert(tokens.begin() + start, new_tokens.begin(), new_tokens.end());
+    }
+    error_lines -= std::count(line_errors.begin() + first_line,
+                              line_errors.begin() + first_line + old_lines, 1);
+    error_lines += std::count(new_errors.begin(), new_errors.end(), 1);
+    line_tokens.erase(line_tokens.begin() + first_line, line_tokens.begin() + first_line + old_lines);
+    line_tokens.insert(line_tokens.begin() + first_line, new_counts.begin(), new_counts.end());
+    line_errors.erase(line_errors.begin() + first_line, line_errors.begin() + first_line + old_lines);
+    line_errors.insert(line_errors.begin() + first_line, new_errors.begin(), new_errors.end());
+    source = text;
+}
+
+int Compiler::scan(Scanner &scanner, std::vector<Token> &scanner_output)
+{
+    auto token_list = tokenize(scanner);
     scanner_output.resize(token_list.size());
     std::copy(token_list.begin(), token_list.end(), scanner_output.begin());
     // False if errors were found in tokenization
-    return error_count;
+    return diagnostics.error_count();
 }
 
-std::vector<Token> Compiler::tokenize()
+std::vector<Token> Compiler::tokenize(Scanner &scanner)
 {
     Token tok;
     std::vector<Token> token_list;
@@ -47,12 +264,11 @@ std::vector<Token> Compiler::tokenize()
     do {
         tok = scanner.get_token();
         if (error_token(tok)) {
-            error_count++;
-            print_error_msg(tok);
+            report_error(tok);
             // Only one error allowed per line, rest of line is ignored
-            skip_line();
-            if (error_count >= MAX_ERRORS) {
-                std::cerr << "Number of errors reached maximum, aborting scan" << std::endl;
+            skip_line(scanner);
+            if (diagnostics.error_count() >= MAX_ERRORS) {
+                diagnostics.report(Severity::NOTE, current_line, 0, DiagnosticCode::TOO_MANY_ERRORS);
                 break;
             }
         }
@@ -60,12 +276,12 @@ std::vector<Token> Compiler::tokenize()
             current_line++;
         }
         token_list.push_back(tok);
-    } while ((tok.symbol != END_OF_FILE) && (error_count <= MAX_ERRORS));
+    } while ((tok.symbol != END_OF_FILE) && (diagnostics.error_count() <= MAX_ERRORS));
 
     return token_list;
 }
 
-void Compiler::skip_line()
+void Compiler::skip_line(Scanner &scanner)
 {
     Token tok;
     do {
@@ -89,24 +305,22 @@ bool Compiler::error_token(Token t)
     }
 }
 
-void Compiler::print_error_msg(Token t)
+void Compiler::report_error(Token t)
 {
-    std::cerr << "Error " << error_count << " on line " << current_line << ": ";
-    Symbol s = t.symbol;
-    if (s == INVALID_CHAR) {
-        std::cerr << "Unrecognized character ";
-    }
-    else if (s == INVALID_NUMERAL) {
-        std::cerr << "Invalid numeral "; 
-    }
-    else if (s == INVALID_SYMBOL) {
-        std::cerr << "Invalid symbol ";
-    }
-    else if (s == INVALID_WORD) {
-        std::cerr << "Invalid identifier ";
-    }
-    else  {
-        std::cerr << "No error -- Shouldn't be here " << std::endl;
+    DiagnosticCode code;
+    switch (t.symbol)
+    {
+        case INVALID_CHAR:
+            code = DiagnosticCode::INVALID_CHARACTER;
+            break;
+        case INVALID_NUMERAL:
+            code = DiagnosticCode::INVALID_NUMERAL;
+            break;
+        case INVALID_SYMBOL:
+            code = DiagnosticCode::INVALID_SYMBOL;
+            break;
+        default:
+            code = DiagnosticCode::INVALID_IDENTIFIER;
     }
-    std::cerr << "\"" << t.lexeme << "\"" << std::endl;
-}
\ No newline at end of file
+    diagnostics.error(current_line, t.column, code, {t.lexeme});
+}
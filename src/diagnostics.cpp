@@ -0,0 +1,145 @@
+#include "diagnostics.h"
+#include "json.h"
+#include <sstream>
+#include <utility>
+
+
+namespace {
+
+struct CodeInfo
+{
+    const char *name;
+    const char *format;
+};
+
+// Indexed by DiagnosticCode
+const CodeInfo CODES[] = {
+    {"invalid-character", "Unrecognized character \"{0}\""},
+    {"invalid-numeral", "Invalid numeral \"{0}\""},
+    {"invalid-symbol", "Invalid symbol \"{0}\""},
+    {"invalid-identifier", "Invalid identifier \"{0}\""},
+    {"too-many-errors", "Number of errors reached maximum, aborting scan"},
+    {"expected-symbol", "Expected {0}, found {1}"},
+    {"unexpected-symbol", "Unexpected {0} symbol"},
+    {"unexpected-eof", "Reached end of file while parsing"},
+    {"resuming", "Resuming from {0}"},
+    {"undefined-identifier", "Identifier {0} is undefined"},
+    {"redefined-identifier", "Identifier {0} already defined in currents scope"},
+    {"not-constant", "Found non-constant value where constant expected"},
+    {"array-bound-type", "Array bounds must be of type integer"},
+    {"read-constant", "Cannot read value for constant {0}"},
+    {"read-procedure", "Cannot read value for procedure {0}"},
+    {"write-procedure", "Cannot write procedure"},
+    {"assignment-count", "Number of variables does not match number of expressions"},
+    {"assign-constant", "Cannot assign value to constant {0}"},
+    {"assign-procedure", "Procedure type cannot be used in assignment statement"},
+    {"assignment-type", "Mismatch between types of LHS and RHS of assignment statement"},
+    {"call-non-procedure", "Cannot call a non procedure type"},
+    {"guard-type", "Guarded command must evaluate to Boolean type"},
+    {"logical-operand-type", "Both operands for logical operator must be Boolean"},
+    {"comparison-operand-type", "Both operands of a comparison must be integers"},
+    {"negate-type", "Cannot negate a non integer value"},
+    {"adding-operand-type", "Both operands of addition type operator must be integers"},
+    {"multiplying-operand-type", "Both operands of multiplication type operators must be integers"},
+    {"not-operand-type", "Cannot take logical inverse of a non Boolean expression"},
+    {"index-type", "Array index must be integer type"}
+};
+
+}
+
+
+void Diagnostics::report(Severity severity, int line, int column, DiagnosticCode code,
+                         std::vector<std::string> args)
+{
+    if (severity == Severity::ERROR) {
+        errors++;
+    }
+    diagnostics.push_back(Diagnostic{severity, line, column, code, std::move(args)});
+}
+
+
+void Diagnostics::error(int line, int column, DiagnosticCode code, std::vector<std::string> args)
+{
+    report(Severity::ERROR, line, column, code, std::move(args));
+}
+
+
+void Diagnostics::append(const Diagnostics &other)
+{
+    diagnostics.insert(diagnostics.end(), other.diagnostics.begin(), other.diagnostics.end());
+    errors += other.errors;
+}
+
+
+void Diagnostics::clear()
+{
+    diagnostics.clear();
+    errors = 0;
+}
+
+
+void Diagnostics::render_text(std::ostream &out) const
+{
+    // Built up first so the messages are written to out at once
+    std::ostringstream text;
+    int number = 0;
+    for (auto &d: diagnostics) {
+        if (d.severity == Severity::ERROR) {
+            text << "Error " << ++number << " on line " << d.line << ": " << message(d) << '\n';
+        }
+        else {
+            text << "-- " << message(d) << " on line " << d.line << '\n';
+        }
+    }
+    out << text.str() << std::flush;
+}
+
+
+void Diagnostics::render_json(std::ostream &out) const
+{
+    std::ostringstream text;
+    text << '[';
+    for (size_t i = 0; i < diagnostics.size(); i++) {
+        const Diagnostic &d = diagnostics[i];
+        text << (i ? ",\n " : "\n ") << "{\"severity\": "
+             << (d.severity == Severity::ERROR ? "\"error\"" : "\"note\"")
+             << ", \"line\": " << d.line << ", \"column\": " << d.column << ", \"code\": ";
+        write_json_string(text, code_name(d.code));
+        text << ", \"message\": ";
+        write_json_string(text, message(d));
+        text << ", \"args\": [";
+        for (size_t a = 0; a < d.args.size(); a++) {
+            text << (a ? ", " : "");
+            write_json_string(text, d.args[a]);
+        }
+        text << "]}";
+    }
+    text << (diagnostics.empty() ? "]\n" : "\n]\n");
+    out << text.str() << std::flush;
+}
+
+
+std::string Diagnostics::message(const Diagnostic &d)
+{
+    std::string result;
+    for (const char *c = CODES[(int)d.code].format; *c; c++) {
+        // Arguments are numbered from 0 to 9
+        if (c[0] == '{' && c[1] >= '0' && c[1] <= '9' && c[2] == '}') {
+            size_t arg = c[1] - '0';
+            if (arg < d.args.size()) {
+                result += d.args[arg];
+            }
+            c += 2;
+        }
+        else {
+            result += *c;
+        }
+    }
+    return result;
+}
+
+
+std::string Diagnostics::code_name(DiagnosticCode code)
+{
+    return CODES[(int)code].name;
+}
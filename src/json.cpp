@@ -0,0 +1,375 @@
+#include "json.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+
+void write_json_string(std::ostream &out, const std::string &s)
+{
+    out << '"';
+    for (char c: s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if (c == '\n') {
+            out << "\\n";
+        }
+        else if (c == '\t') {
+            out << "\\t";
+        }
+        else if ((unsigned char)c < 0x20) {
+            char escape[7];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out << escape;
+        }
+        else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+
+namespace {
+
+// Deepest nesting of arrays and objects read, so a hostile message can't exhaust the stack
+const int MAX_DEPTH = 512;
+
+// Recursive descent over the text of a single JSON value
+class Reader
+{
+public:
+    Reader(const std::string &s): text(s), pos(0), depth(0) {}
+
+    bool value(Json &result)
+    {
+        skip_space();
+        if (pos >= text.size()) {
+            return false;
+        }
+        char c = text[pos];
+        if (c == '{' || c == '[') {
+            if (depth == MAX_DEPTH) {
+                return false;
+            }
+            depth++;
+            bool read = c == '{' ? object(result) : array(result);
+            depth--;
+            return read;
+        }
+        if (c == '"') {
+            std::string s;
+            if (!string(s)) {
+                return false;
+            }
+            result = Json(s);
+            return true;
+        }
+        if (literal("true")) {
+            result = Json(true);
+            return true;
+        }
+        if (literal("false")) {
+            result = Json(false);
+            return true;
+        }
+        if (literal("null")) {
+            result = Json();
+            return true;
+        }
+        return number(result);
+    }
+
+    // True if only white space is left
+    bool at_end()
+    {
+        skip_space();
+        return pos == text.size();
+    }
+
+private:
+    const std::string &text;
+    size_t pos;
+    // Arrays and objects open around pos
+    int depth;
+
+    void skip_space()
+    {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' ||
+                                     text[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    bool literal(const char *word)
+    {
+        std::string w(word);
+        if (text.compare(pos, w.size(), w) != 0) {
+            return false;
+        }
+        pos += w.size();
+        return true;
+    }
+
+    bool number(Json &result)
+    {
+        const char *start = text.c_str() + pos;
+        char *end;
+        double n = strtod(start, &end);
+        if (end == start) {
+            return false;
+        }
+        pos += end - start;
+        result = Json(n);
+        return true;
+    }
+
+    bool string(std::string &s)
+    {
+        pos++;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c != '\\') {
+                s += c;
+                continue;
+            }
+            if (pos >= text.size()) {
+                return false;
+            }
+            char e = text[pos++];
+            switch (e) {
+                case 'n': s += '\n'; break;
+                case 't': s += '\t'; break;
+                case 'r': s += '\r'; break;
+                case 'b': s += '\b'; break;
+                case 'f': s += '\f'; break;
+                case 'u': {
+                    if (pos + 4 > text.size()) {
+                        return false;
+                    }
+                    unsigned code = strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                    // Written as UTF-8. Surrogate pairs are kept as they are, PL source is ASCII
+                    if (code < 0x80) {
+                        s += (char)code;
+                    }
+                    else if (code < 0x800) {
+                        s += (char)(0xc0 | (code >> 6));
+                        s += (char)(0x80 | (code & 0x3f));
+                    }
+                    else {
+                        s += (char)(0xe0 | (code >> 12));
+                        s += (char)(0x80 | ((code >> 6) & 0x3f));
+                        s += (char)(0x80 | (code & 0x3f));
+                    }
+                    break;
+                }
+                default: s += e;
+            }
+        }
+        if (pos >= text.size()) {
+            return false;
+        }
+        pos++;
+        return true;
+    }
+
+    bool array(Json &result)
+    {
+        pos++;
+        result = Json::array();
+        skip_space();
+        if (pos < text.size() && text[pos] == ']') {
+            pos++;
+            return true;
+        }
+        while (true) {
+            Json item;
+            if (!value(item)) {
+                return false;
+            }
+            result.push_back(item);
+            skip_space();
+            if (pos < text.size() && text[pos] == ',') {
+                pos++;
+            }
+            else if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return true;
+            }
+            else {
+                return false;
+            }
+        }
+    }
+
+    bool object(Json &result)
+    {
+        pos++;
+        result = Json::object();
+        skip_space();
+        if (pos < text.size() && text[pos] == '}') {
+            pos++;
+            return true;
+        }
+        while (true) {
+            skip_space();
+            std::string key;
+            if (pos >= text.size() || text[pos] != '"' || !string(key)) {
+                return false;
+            }
+            skip_space();
+            if (pos >= text.size() || text[pos] != ':') {
+                return false;
+            }
+            pos++;
+            Json member;
+            if (!value(member)) {
+                return false;
+            }
+            result.set(key, member);
+            skip_space();
+            if (pos < text.size() && text[pos] == ',') {
+                pos++;
+            }
+            else if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return true;
+            }
+            else {
+                return false;
+            }
+        }
+    }
+};
+
+const Json NULL_JSON;
+
+}
+
+
+Json::Json(): type(NUL), boolean(false), number(0) {}
+
+Json::Json(bool b): type(BOOLEAN), boolean(b), number(0) {}
+
+Json::Json(int n): type(NUMBER), boolean(false), number(n) {}
+
+Json::Json(double n): type(NUMBER), boolean(false), number(n) {}
+
+Json::Json(const char *s): type(STRING), boolean(false), number(0), text(s) {}
+
+Json::Json(const std::string &s): type(STRING), boolean(false), number(0), text(s) {}
+
+
+Json Json::array()
+{
+    Json value;
+    value.type = ARRAY;
+    return value;
+}
+
+
+Json Json::object()
+{
+    Json value;
+    value.type = OBJECT;
+    return value;
+}
+
+
+bool Json::parse(const std::string &text, Json &value)
+{
+    Reader reader(text);
+    return reader.value(value) && reader.at_end();
+}
+
+
+const Json &Json::operator[](const std::string &key) const
+{
+    for (auto &m: members) {
+        if (m.first == key) {
+            return m.second;
+        }
+    }
+    return NULL_JSON;
+}
+
+
+Json &Json::set(const std::string &key, Json value)
+{
+    for (auto &m: members) {
+        if (m.first == key) {
+            m.second = std::move(value);
+            return *this;
+        }
+    }
+    members.emplace_back(key, std::move(value));
+    return *this;
+}
+
+
+bool Json::has(const std::string &key) const
+{
+    for (auto &m: members) {
+        if (m.first == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void Json::push_back(Json value)
+{
+    items.push_back(std::move(value));
+}
+
+
+std::string Json::dump() const
+{
+    std::ostringstream out;
+    write(out);
+    return out.str();
+}
+
+
+void Json::write(std::ostream &out) const
+{
+    switch (type) {
+        case NUL:
+            out << "null";
+            break;
+        case BOOLEAN:
+            out << (boolean ? "true" : "false");
+            break;
+        case NUMBER:
+            if (number == (long long)number) {
+                out << (long long)number;
+            }
+            else {
+                out << number;
+            }
+            break;
+        case STRING:
+            write_json_string(out, text);
+            break;
+        case ARRAY:
+            out << '[';
+            for (size_t i = 0; i < items.size(); i++) {
+                out << (i ? "," : "");
+                items[i].write(out);
+            }
+            out << ']';
+            break;
+        case OBJECT:
+            out << '{';
+            for (size_t i = 0; i < members.size(); i++) {
+                out << (i ? "," : "");
+                write_json_string(out, members[i].first);
+                out << ':';
+                members[i].second.write(out);
+            }
+            out << '}';
+            break;
+    }
+}
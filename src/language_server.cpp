@@ -0,0 +1,265 @@
+#include "language_server.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+
+// JSON-RPC error codes
+const int PARSE_ERROR = -32700;
+const int INVALID_REQUEST = -32600;
+const int METHOD_NOT_FOUND = -32601;
+
+// Longest message content read
+static const long long MAX_CONTENT_LENGTH = 64 << 20;
+
+// Positions count lines and characters from 0, where spans count from 1
+static Json position(int line, int column)
+{
+    return Json::object().set("line", line - 1).set("character", column - 1);
+}
+
+static Json location(const std::string &uri, const SourceSpan &span)
+{
+    Json range = Json::object()
+        .set("start", position(span.line, span.column))
+        .set("end", position(span.line, span.column + span.length));
+    return Json::object().set("uri", uri).set("range", range);
+}
+
+
+LanguageServer::LanguageServer(CompilerOptions opts): options(opts), shut_down(false)
+{
+    options.incremental = true;
+    // Only the front end matters for queries, so the code isn't optimized
+    options.inline_limit = 0;
+    options.dead_code_elim = false;
+}
+
+
+int LanguageServer::serve(std::istream &in, std::ostream &out)
+{
+    std::string content, invalid;
+    while (read_message(in, content, invalid)) {
+        Json message;
+        // There is no id to answer either error to
+        if (!invalid.empty()) {
+            Json error = Json::object().set("code", INVALID_REQUEST).set("message", invalid);
+            send(out, Json::object().set("jsonrpc", "2.0").set("id", Json()).set("error", error));
+        }
+        else if (!Json::parse(content, message)) {
+            Json error = Json::object().set("code", PARSE_ERROR).set("message", "Parse error");
+            send(out, Json::object().set("jsonrpc", "2.0").set("id", Json()).set("error", error));
+        }
+        else if (!handle(message, out)) {
+            return shut_down ? 0 : 1;
+        }
+    }
+    return 1;
+}
+
+
+bool LanguageServer::read_message(std::istream &in, std::string &content, std::string &invalid)
+{
+    // Headers, each ended by \r\n, then an empty line and the content
+    std::string header;
+    bool has_length = false;
+    long long length = -1;
+    invalid.clear();
+    while (std::getline(in, header)) {
+        if (!header.empty() && header.back() == '\r') {
+            header.pop_back();
+        }
+        if (header.empty()) {
+            if (has_length) {
+                break;
+            }
+            continue;
+        }
+        const std::string name = "Content-Length:";
+        if (header.compare(0, name.size(), name) == 0) {
+            std::string value = header.substr(name.size());
+            value.erase(0, value.find_first_not_of(' '));
+            has_length = true;
+            length = -1;
+            // Too many digits read as the largest number, which is over the limit
+            if (!value.empty() && value.find_first_not_of("0123456789") == std::string::npos) {
+                length = strtoll(value.c_str(), nullptr, 10);
+            }
+        }
+    }
+    if (!has_length) {
+        return false;
+    }
+    content.clear();
+    // Where the content ends isn't known, so the next headers are looked for after it
+    if (length < 0) {
+        invalid = "Invalid Content-Length";
+        return true;
+    }
+    if (length > MAX_CONTENT_LENGTH) {
+        invalid = "Content-Length over " + std::to_string(MAX_CONTENT_LENGTH) + " bytes";
+        in.ignore(length);
+        return true;
+    }
+    content.assign(length, '\0');
+    return (bool)in.read(&content[0], length);
+}
+
+
+void LanguageServer::send(std::ostream &out, const Json &message)
+{
+    std::string content = message.dump();
+    out << "Content-Length: " << content.size() << "\r\n\r\n" << content << std::flush;
+}
+
+
+bool LanguageServer::handle(const Json &message, std::ostream &out)
+{
+    Json reply = Json::object().set("jsonrpc", "2.0");
+    const std::string &method = message["method"].as_string();
+    const Json &params = message["params"];
+    Json result;
+    if (method == "initialize") {
+        Json capabilities = Json::object()
+            // Documents are sent whole on each change
+            .set("textDocumentSync", 1)
+            .set("definitionProvider", true)
+            .set("referencesProvider", true)
+            .set("hoverProvider", true);
+        result = Json::object().set("capabilities", capabilities)
+                               .set("serverInfo", Json::object().set("name", "plc"));
+    }
+    else if (method == "shutdown") {
+        shut_down = true;
+    }
+    else if (method == "exit") {
+        return false;
+    }
+    else if (method == "textDocument/didOpen") {
+        update(params["textDocument"]["uri"].as_string(), params["textDocument"]["text"].as_string(),
+               out);
+    }
+    else if (method == "textDocument/didChange") {
+        auto &changes = params["contentChanges"].elements();
+        if (!changes.empty()) {
+            update(params["textDocument"]["uri"].as_string(), changes.back()["text"].as_string(), out);
+        }
+    }
+    else if (method == "textDocument/didClose") {
+        documents.erase(params["textDocument"]["uri"].as_string());
+    }
+    else if (method == "textDocument/definition") {
+        result = definition(params);
+    }
+    else if (method == "textDocument/references") {
+        result = references(params);
+    }
+    else if (method == "textDocument/hover") {
+        result = hover(params);
+    }
+    else if (message.has("id")) {
+        reply.set("id", message["id"]);
+        reply.set("error", Json::object().set("code", METHOD_NOT_FOUND)
+                                         .set("message", "Method not found: " + method));
+        send(out, reply);
+        return true;
+    }
+
+    // Notifications have no id and are not answered
+    if (message.has("id")) {
+        reply.set("id", message["id"]);
+        reply.set("result", result);
+        send(out, reply);
+    }
+    return true;
+}
+
+
+void LanguageServer::update(const std::string &uri, const std::string &text, std::ostream &out)
+{
+    auto &doc = documents[uri];
+    if (!doc) {
+        doc.reset(new Document);
+        doc->compiler.reset(new Compiler(options));
+        doc->compiler->set_symbol_index(&doc->symbols);
+    }
+    std::istringstream source(text);
+    std::ostringstream output, messages;
+    doc->compiler->set_message_streams(messages, messages);
+    doc->compiler->compile(source, output);
+
+    Json diagnostics = Json::array();
+    for (auto &d: doc->compiler->messages().records()) {
+        int column = std::max(d.column, 1);
+        Json range = Json::object().set("start", position(d.line, column))
+                                   .set("end", position(d.line, column));
+        diagnostics.push_back(Json::object()
+            .set("range", range)
+            // Error or Information
+            .set("severity", d.severity == Severity::ERROR ? 1 : 3)
+            .set("code", Diagnostics::code_name(d.code))
+            .set("source", "plc")
+            .set("message", Diagnostics::message(d)));
+    }
+    Json params = Json::object().set("uri", uri).set("diagnostics", diagnostics);
+    send(out, Json::object().set("jsonrpc", "2.0")
+                            .set("method", "textDocument/publishDiagnostics")
+                            .set("params", params));
+}
+
+
+LanguageServer::Document *LanguageServer::document(const Json &params)
+{
+    auto it = documents.find(params["textDocument"]["uri"].as_string());
+    return it == documents.end() ? nullptr : it->second.get();
+}
+
+
+// The symbol at the position given in params, or -1
+static int symbol_at(const SymbolIndex &symbols, const Json &params)
+{
+    return symbols.find(params["position"]["line"].as_int() + 1,
+                        params["position"]["character"].as_int() + 1);
+}
+
+
+Json LanguageServer::definition(const Json &params)
+{
+    Document *doc = document(params);
+    int symbol = doc ? symbol_at(doc->symbols, params) : -1;
+    if (symbol < 0) {
+        return Json();
+    }
+    return location(params["textDocument"]["uri"].as_string(), doc->symbols.definition(symbol).span);
+}
+
+
+Json LanguageServer::references(const Json &params)
+{
+    Document *doc = document(params);
+    int symbol = doc ? symbol_at(doc->symbols, params) : -1;
+    if (symbol < 0) {
+        return Json();
+    }
+    bool declaration = params["context"]["includeDeclaration"].as_bool();
+    const SourceSpan &defined = doc->symbols.definition(symbol).span;
+    Json result = Json::array();
+    for (auto &span: doc->symbols.occurrences(symbol)) {
+        if (declaration || span.line != defined.line || span.column != defined.column) {
+            result.push_back(location(params["textDocument"]["uri"].as_string(), span));
+        }
+    }
+    return result;
+}
+
+
+Json LanguageServer::hover(const Json &params)
+{
+    Document *doc = document(params);
+    int symbol = doc ? symbol_at(doc->symbols, params) : -1;
+    if (symbol < 0) {
+        return Json();
+    }
+    Json contents = Json::object().set("kind", "plaintext").set("value", doc->symbols.describe(symbol));
+    return Json::object().set("contents", contents);
+}
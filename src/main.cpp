@@ -1,15 +1,120 @@
 #include "symbol_table.h"
 #include "scanner.h"
 #include "compiler.h"
+#include "compile_cache.h"
 #include "parser.h"
+#include "server.h"
+#include "language_server.h"
+#include "time_report.h"
+#include "work_pool.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <fstream>
 #include <iterator>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include <algorithm>
 
-const std::string usage_info = "Usage:\n\tplc src_file [-o output_file]";
+const std::string usage_info = "Usage:\n\tplc src_file [-o output_file] [-d] [--no-bounds-elim] [--no-dce] "
+                               "[-finline-limit=N]\n\t\t[--target=plam|x86-64] [-fdiagnostics-format=text|json] "
+                               "[--procedure-threads=N]\n\t\t[--line-table] [--time-report]"
+                               "\n\tplc src_file... [-j threads] [options]"
+                               "\n\toptions also include [--cache-dir=directory] [--cache-size=bytes[K|M|G]]"
+                               "\n\tplc --server[=socket_path] [--incremental] [options]"
+                               "\n\tplc --lsp";
+
+/*  Output file for one of several source files: the source file name with its extension replaced
+    by .plam, or .s for x86-64 assembly
+*/
+std::string output_name(const std::string &input_file, const CompilerOptions &options)
+{
+    auto slash = input_file.find_last_of('/');
+    auto dot = input_file.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        return input_file.substr(0, dot) + (options.target == "x86-64" ? ".s" : ".plam");
+    }
+    return input_file + (options.target == "x86-64" ? ".s" : ".plam");
+}
+
+// Compile the program read from file_in, through the cache if there is one
+bool compile_file(Compiler &compiler, CompileCache *cache, std::ifstream &file_in, std::ofstream &file_out,
+                  std::ostream &out, std::ostream &err)
+{
+    compiler.set_message_streams(out, err);
+    if (!cache) {
+        return compiler.compile(file_in, file_out);
+    }
+    std::ostringstream source;
+    source << file_in.rdbuf();
+    return cache->compile(compiler, source.str(), file_out, out, err);
+}
+
+// Most threads -j and --procedure-threads= can ask for
+const long long MAX_THREADS = 1024;
+
+/*  Read text, which must be only digits, as a number from min to max. Returns false if it isn't one
+*/
+static bool parse_number(const std::string &text, long long min, long long max, long long &value)
+{
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    errno = 0;
+    value = std::strtoll(text.c_str(), nullptr, 10);
+    return errno != ERANGE && value >= min && value <= max;
+}
+
+
+/*  Compile each file with its own compiler, on a pool of threads. Messages are kept for each file
+    and printed in the order the files were given, after a line naming the file. Returns the
+    number of files that failed to compile
+*/
+int compile_all(const std::vector<std::string> &input_files, const CompilerOptions &options, int threads,
+                CompileCache *cache)
+{
+    struct Job
+    {
+        std::ostringstream out, err;
+        bool failed;
+    };
+    std::vector<Job> results(input_files.size());
+    std::vector<std::function<void()>> jobs;
+    for (size_t i = 0; i < input_files.size(); i++) {
+        jobs.push_back([&, i]() {
+            Job &job = results[i];
+            std::ifstream file_in(input_files[i]);
+            std::string output_file = output_name(input_files[i], options);
+            job.failed = true;
+            if (!file_in.good()) {
+                job.err << "failed to open input file " + input_files[i] << std::endl;
+                return;
+            }
+            std::ofstream file_out(output_file);
+            if (!file_out.good()) {
+                job.err << "failed to open output file " + output_file << std::endl;
+                return;
+            }
+            Compiler compiler(options);
+            job.failed = compile_file(compiler, cache, file_in, file_out, job.out, job.err);
+        });
+    }
+    WorkPool(threads).run(jobs);
+
+    int failures = 0;
+    for (size_t i = 0; i < input_files.size(); i++) {
+        std::cout << input_files[i] << ":" << std::endl << results[i].out.str();
+        if (!results[i].err.str().empty()) {
+            std::cerr << input_files[i] << ":" << std::endl << results[i].err.str();
+        }
+        failures += results[i].failed;
+    }
+    return failures;
+}
 
 int main(int argc, char *argv[]) 
 {
@@ -19,7 +124,57 @@ int main(int argc, char *argv[])
         std::cerr << "Missing source file" << std::endl << usage_info << std::endl;
         return 1;
     }
-    std::string input_file(argv[1]);
+    // Allocations are counted from the start, so memory freed during compilation is known
+    bool time_report = std::find(argv + 1, argv + argc, std::string("--time-report")) != argv + argc;
+    if (time_report) {
+        HeapCounters::enable();
+    }
+    // Queries about programs being edited are answered over JSON-RPC on stdin and stdout
+    if (std::find(argv + 1, argv + argc, std::string("--lsp")) != argv + argc) {
+        return LanguageServer().serve(std::cin, std::cout);
+    }
+    // In server mode source files are named by each request, on stdin or the socket
+    const std::string server_flag = "--server";
+    auto server_arg = std::find_if(argv, argv + argc, [&](char *arg) { 
+        return std::string(arg).compare(0, server_flag.size(), server_flag) == 0;
+    });
+    bool server = server_arg != argv + argc;
+    std::string socket_path;
+    if (server) {
+        std::string arg(*server_arg);
+        if (arg != server_flag && arg.compare(0, server_flag.size() + 1, server_flag + "=") != 0) {
+            std::cerr << "unknown option " << arg << "\n" << usage_info << "\n";
+            return 1;
+        }
+        socket_path = arg.substr(std::min(arg.size(), server_flag.size() + 1));
+    }
+    // Source files are the arguments that are neither options nor the values of -o and -j
+    std::vector<std::string> input_files;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-o") {
+            i++;
+        }
+        else if (arg == "-j") {
+            std::string count = i + 1 < argc ? argv[++i] : "";
+            long long value;
+            if (!parse_number(count, 1, MAX_THREADS, value)) {
+                std::cerr << "-j option must be followed by a number of threads up to " << MAX_THREADS
+                          << "\n" << usage_info << "\n";
+                return 1;
+            }
+            threads = value;
+        }
+        else if (arg[0] != '-') {
+            input_files.push_back(arg);
+        }
+    }
+    if (input_files.empty() && !server) {
+        std::cerr << "Missing source file" << std::endl << usage_info << std::endl;
+        return 1;
+    }
+    std::string input_file = server ? "" : input_files[0];
     std::string output_file = "a.out";
 
     auto it = std::find(argv, argv + argc, std::string("-o"));
@@ -28,11 +183,134 @@ int main(int argc, char *argv[])
             std::cerr << "-o option must be followed by output file\n" << usage_info << "\n";
             return 1;
         }
+        if (input_files.size() > 1) {
+            std::cerr << "-o option can't be used with several source files\n" << usage_info << "\n";
+            return 1;
+        }
         output_file = std::string(*(it + 1));
     }
+    if (time_report && (input_files.size() > 1 || server)) {
+        std::cerr << "--time-report can only be used with a single source file\n" << usage_info << "\n";
+        return 1;
+    }
 
+    CompilerOptions options;
     it = std::find(argv, argv + argc, std::string("-d"));
-    bool debug_mode = it != argv + argc;
+    options.debug = it != argv + argc;
+
+    // Keep the run-time range check on every array access
+    it = std::find(argv, argv + argc, std::string("--no-bounds-elim"));
+    options.bounds_elim = it == argv + argc;
+
+    // Keep unreachable procedures and guarded commands in the output
+    it = std::find(argv, argv + argc, std::string("--no-dce"));
+    options.dead_code_elim = it == argv + argc;
+
+    const std::string inline_flag = "-finline-limit=";
+    it = std::find_if(argv, argv + argc, [&](char *arg) { 
+        return std::string(arg).compare(0, inline_flag.size(), inline_flag) == 0;
+    });
+    if (it != argv + argc) {
+        std::string limit = std::string(*it).substr(inline_flag.size());
+        long long value;
+        if (!parse_number(limit, 0, INT_MAX, value)) {
+            std::cerr << inline_flag << " must be followed by a number of instructions\n" 
+                      << usage_info << "\n";
+            return 1;
+        }
+        options.inline_limit = value;
+    }
+
+    // Source lines of the code, for plinterp --profile
+    it = std::find(argv, argv + argc, std::string("--line-table"));
+    options.line_table = it != argv + argc;
+
+    const std::string target_flag = "--target=";
+    it = std::find_if(argv, argv + argc, [&](char *arg) { 
+        return std::string(arg).compare(0, target_flag.size(), target_flag) == 0;
+    });
+    if (it != argv + argc) {
+        options.target = std::string(*it).substr(target_flag.size());
+        if (options.target != "plam" && options.target != "x86-64") {
+            std::cerr << "unknown target " << options.target << "\n" << usage_info << "\n";
+            return 1;
+        }
+    }
+
+    const std::string diagnostics_flag = "-fdiagnostics-format=";
+    it = std::find_if(argv, argv + argc, [&](char *arg) { 
+        return std::string(arg).compare(0, diagnostics_flag.size(), diagnostics_flag) == 0;
+    });
+    if (it != argv + argc) {
+        options.diagnostics_format = std::string(*it).substr(diagnostics_flag.size());
+        if (options.diagnostics_format != "text" && options.diagnostics_format != "json") {
+            std::cerr << "unknown diagnostics format " << options.diagnostics_format << "\n" 
+                      << usage_info << "\n";
+            return 1;
+        }
+    }
+
+    const std::string procedure_threads_flag = "--procedure-threads=";
+    it = std::find_if(argv, argv + argc, [&](char *arg) { 
+        return std::string(arg).compare(0, procedure_threads_flag.size(), procedure_threads_flag) == 0;
+    });
+    if (it != argv + argc) {
+        std::string count = std::string(*it).substr(procedure_threads_flag.size());
+        long long value;
+        if (!parse_number(count, 1, MAX_THREADS, value)) {
+            std::cerr << procedure_threads_flag << " must be followed by a number of threads up to "
+                      << MAX_THREADS << "\n" << usage_info << "\n";
+            return 1;
+        }
+        options.procedure_threads = value;
+    }
+
+    // A server keeps each program's tokens and procedure code to reuse in the next request
+    it = std::find(argv, argv + argc, std::string("--incremental"));
+    options.incremental = it != argv + argc;
+
+    // Earlier compilations are kept in the cache directory, if one is given
+    const std::string cache_flag = "--cache-dir=", cache_size_flag = "--cache-size=";
+    std::unique_ptr<CompileCache> cache;
+    long long cache_size = DEFAULT_CACHE_SIZE;
+    it = std::find_if(argv, argv + argc, [&](char *arg) { 
+        return std::string(arg).compare(0, cache_size_flag.size(), cache_size_flag) == 0;
+    });
+    if (it != argv + argc) {
+        std::string size = std::string(*it).substr(cache_size_flag.size());
+        size_t digits = size.find_first_not_of("0123456789");
+        std::string unit = digits == std::string::npos ? "" : size.substr(digits);
+        int shift = unit == "K" ? 10 : unit == "M" ? 20 : unit == "G" ? 30 : 0;
+        if ((unit != "" && shift == 0) ||
+            !parse_number(size.substr(0, digits), 0, LLONG_MAX >> shift, cache_size)) {
+            std::cerr << cache_size_flag << " must be followed by a number of bytes\n" << usage_info << "\n";
+            return 1;
+        }
+        cache_size <<= shift;
+    }
+    it = std::find_if(argv, argv + argc, [&](char *arg) { 
+        return std::string(arg).compare(0, cache_flag.size(), cache_flag) == 0;
+    });
+    if (it != argv + argc) {
+        cache.reset(new CompileCache(std::string(*it).substr(cache_flag.size()), cache_size, options));
+    }
+
+    if (server) {
+        CompileServer compile_server(options);
+        if (socket_path.empty()) {
+            compile_server.serve(std::cin, std::cout);
+            return 0;
+        }
+        return compile_server.listen(socket_path) ? 0 : 1;
+    }
+
+    if (input_files.size() > 1) {
+        int failures = compile_all(input_files, options, threads, cache.get());
+        if (cache) {
+            cache->evict();
+        }
+        return failures != 0;
+    }
 
     /* Open input/output files
     */
@@ -49,6 +327,17 @@ int main(int argc, char *argv[])
 
     /* Compilation
     */
-    Compiler compiler(file_in, file_out, debug_mode);
-    return compiler.run();
+    Compiler compiler(options);
+    TimeReport report;
+    if (time_report) {
+        compiler.set_time_report(&report);
+    }
+    bool failed = compile_file(compiler, cache.get(), file_in, file_out, std::cout, std::cerr);
+    if (cache) {
+        cache->evict();
+    }
+    if (time_report) {
+        report.write(std::cerr);
+    }
+    return failed;
 }
\ No newline at end of file
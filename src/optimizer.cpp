@@ -0,0 +1,411 @@
+#include "optimizer.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <functional>
+
+
+const int Optimizer::MAIN;
+
+
+Optimizer::Optimizer(std::vector<Instruction> &program): code(program) {}
+
+
+int Optimizer::eliminate_dead_code()
+{
+    int size = code.size();
+    // Calls inside dead guarded commands don't make a procedure reachable, so remove them first
+    remove_false_guards();
+    remove_unreachable_procs();
+    return size - code.size();
+}
+
+
+void Optimizer::remove_false_guards()
+{
+    /*  A guarded command is emitted as
+            DEFADDR start  <guard>  ARROW next  <statements>  BAR done
+        If the guard is always false, only the label needs to be kept
+    */
+    std::vector<std::pair<int, int>> ranges;
+    for (int i = 0; i < (int)code.size(); i++) {
+        if (code[i].op != "ARROW") {
+            continue;
+        }
+        int start = i - 1;
+        while (start >= 0 && code[start].op != "DEFADDR") {
+            start--;
+        }
+        int value;
+        if (start >= 0 && constant_guard(start + 1, i, value) && value == 0) {
+            // Guarded commands nested in this one go with it
+            int bar = matching_bar(i);
+            ranges.push_back(std::make_pair(start + 1, bar));
+            i = bar;
+        }
+    }
+    erase_ranges(ranges);
+}
+
+
+void Optimizer::remove_unreachable_procs()
+{
+    auto all = frames();
+    std::set<int> reachable;
+    std::vector<int> work{MAIN};
+    while (!work.empty()) {
+        int label = work.back();
+        work.pop_back();
+        if (!reachable.insert(label).second) {
+            continue;
+        }
+        for (auto c: all[label].calls) {
+            work.push_back(c);
+        }
+    }
+
+    // Ranges of dead procedures, leaving out those nested in another dead procedure
+    std::map<int, int> dead;
+    for (auto &f: all) {
+        if (!reachable.count(f.first)) {
+            dead[f.second.begin] = f.second.end;
+        }
+    }
+    std::vector<std::pair<int, int>> ranges;
+    for (auto &d: dead) {
+        if (ranges.empty() || d.first > ranges.back().second) {
+            ranges.push_back(d);
+        }
+    }
+    erase_ranges(ranges);
+}
+
+
+void Optimizer::erase_ranges(const std::vector<std::pair<int, int>> &ranges)
+{
+    // Each instruction is moved once, however many ranges there are
+    int kept = 0;
+    size_t next = 0;
+    for (int i = 0; i < (int)code.size(); i++) {
+        if (next < ranges.size() && i == ranges[next].first) {
+            i = ranges[next++].second;
+            continue;
+        }
+        if (kept != i) {
+            code[kept] = std::move(code[i]);
+        }
+        kept++;
+    }
+    code.resize(kept);
+}
+
+
+int Optimizer::inline_procedures(int limit)
+{
+    int replaced = 0;
+    int next_label = 1;
+    // DEFARG of each label, whose lengths grow as variables are moved into callers
+    std::map<int, int> defargs;
+    for (int i = 0; i < (int)code.size(); i++) {
+        auto &instr = code[i];
+        if (instr.op == "DEFADDR" || instr.op == "DEFARG") {
+            next_label = std::max(next_label, instr.args[0] + 1);
+        }
+        if (instr.op == "DEFARG") {
+            defargs[instr.args[0]] = i;
+        }
+    }
+
+    /*  Visit callees before callers, so a procedure is measured after its own calls are inlined.
+        Procedures the main program doesn't reach are visited too, as calls in them are inlined
+    */
+    std::vector<int> order;
+    std::set<int> visited;
+    auto all = frames();
+    std::function<void(int)> visit = [&](int label) {
+        if (!visited.insert(label).second) {
+            return;
+        }
+        for (auto c: all[label].calls) {
+            if (all.count(c)) {
+                visit(c);
+            }
+        }
+        order.push_back(label);
+    };
+    visit(MAIN);
+    for (auto &f: all) {
+        visit(f.first);
+    }
+    // Inlining a procedure that isn't recursive never makes another one recursive
+    std::set<int> recursive = recursive_procedures(all);
+
+    /*  The statements of each frame with the calls of earlier procedures replaced, built once from
+        the code as it was parsed, which they are moved out of. Frames' statements don't overlap, as
+        nested procedures come before them
+    */
+    std::map<int, std::vector<Instruction>> bodies;
+    std::set<int> inlined;
+    // Displacement of each procedure's variables in each caller's frame
+    std::map<std::pair<int, int>, int> offsets;
+    for (auto label: order) {
+        const Frame &frame = all[label];
+        std::vector<Instruction> &body = bodies[label];
+        body.reserve(frame.end - frame.body);
+        for (int i = frame.body; i < frame.end; i++) {
+            Instruction &instr = code[i];
+            if (instr.op != "CALL" || !inlined.count(instr.args[1])) {
+                body.push_back(std::move(instr));
+                continue;
+            }
+            int callee = instr.args[1];
+            auto key = std::make_pair(frame.var_label, callee);
+            if (!offsets.count(key)) {
+                // Variables are stored after the static link, dynamic link and return address
+                Instruction &length = code[defargs[frame.var_label]];
+                offsets[key] = 3 + length.args[1];
+                length.args[1] += code[defargs[all[callee].var_label]].args[1];
+            }
+            inline_call(bodies[callee], instr, offsets[key], next_label, body);
+            replaced++;
+        }
+        if (label == MAIN || recursive.count(label)) {
+            continue;
+        }
+        int size = 0;
+        bool calls_nested = false;
+        for (auto &instr: body) {
+            // Labels take no space
+            size += (instr.op != "DEFADDR");
+            // Nested procedures need this procedure's activation record as their static link
+            calls_nested = calls_nested || (instr.op == "CALL" && instr.args[0] == 0);
+        }
+        if (size <= limit && !calls_nested) {
+            inlined.insert(label);
+        }
+    }
+    // Put the new statements in place of each frame's old ones
+    // Label of the frame whose statements start at each index, or -1
+    std::vector<int> body_frames(code.size(), -1);
+    size_t size = code.size();
+    for (auto &f: all) {
+        body_frames[f.second.body] = f.first;
+        size += bodies[f.first].size() - (f.second.end - f.second.body);
+    }
+    std::vector<Instruction> result;
+    result.reserve(size);
+    for (int i = 0; i < (int)code.size(); i++) {
+        int label = body_frames[i];
+        if (label < 0) {
+            result.push_back(std::move(code[i]));
+            continue;
+        }
+        for (auto &instr: bodies[label]) {
+            result.push_back(std::move(instr));
+        }
+        i = all[label].end;
+        result.push_back(std::move(code[i]));
+    }
+    code.swap(result);
+    return replaced;
+}
+
+
+std::map<int, Optimizer::Frame> Optimizer::frames()
+{
+    std::map<int, Frame> all;
+    // Frames not yet ended, and the label of the first statement of each
+    std::vector<int> open;
+    std::vector<int> start_labels;
+    for (int i = 0; i < (int)code.size(); i++) {
+        auto &instr = code[i];
+        if (instr.op == "PROG") {
+            all[MAIN] = Frame{i, -1, -1, instr.args[0], std::set<int>()};
+            open.push_back(MAIN);
+            start_labels.push_back(instr.args[1]);
+        }
+        else if (instr.op == "PROC" && i > 0 && code[i - 1].op == "DEFADDR") {
+            int label = code[i - 1].args[0];
+            all[label] = Frame{i - 1, -1, -1, instr.args[0], std::set<int>()};
+            open.push_back(label);
+            start_labels.push_back(instr.args[1]);
+        }
+        else if (open.empty()) {
+            continue;
+        }
+        else if (instr.op == "DEFADDR" && instr.args[0] == start_labels.back()) {
+            all[open.back()].body = i + 1;
+        }
+        else if (instr.op == "ENDPROC" || instr.op == "ENDPROG") {
+            all[open.back()].end = i;
+            open.pop_back();
+            start_labels.pop_back();
+        }
+        else if (instr.op == "CALL") {
+            all[open.back()].calls.insert(instr.args[1]);
+        }
+    }
+    assert(open.empty());
+    return all;
+}
+
+
+std::set<int> Optimizer::recursive_procedures(const std::map<int, Frame> &all)
+{
+    // Tarjan's algorithm: a procedure is recursive if it is in a cycle of calls of its own
+    std::map<int, int> index, low;
+    std::vector<int> stack;
+    std::set<int> on_stack, recursive;
+    std::function<void(int)> visit = [&](int label) {
+        int n = index.size();
+        index[label] = low[label] = n;
+        stack.push_back(label);
+        on_stack.insert(label);
+        for (auto c: all.at(label).calls) {
+            if (!all.count(c)) {
+                continue;
+            }
+            if (c == label) {
+                recursive.insert(label);
+            }
+            if (!index.count(c)) {
+                visit(c);
+                low[label] = std::min(low[label], low[c]);
+            }
+            else if (on_stack.count(c)) {
+                low[label] = std::min(low[label], index[c]);
+            }
+        }
+        if (low[label] != index[label]) {
+            return;
+        }
+        // Pop the cycle this procedure starts
+        std::vector<int> cycle;
+        do {
+            cycle.push_back(stack.back());
+            on_stack.erase(stack.back());
+            stack.pop_back();
+        } while (cycle.back() != label);
+        if (cycle.size() > 1) {
+            recursive.insert(cycle.begin(), cycle.end());
+        }
+    };
+    for (auto &f: all) {
+        if (!index.count(f.first)) {
+            visit(f.first);
+        }
+    }
+    return recursive;
+}
+
+
+void Optimizer::inline_call(const std::vector<Instruction> &body, const Instruction &call,
+                            int var_offset, int &next_label, std::vector<Instruction> &out)
+{
+    /*  The call's level is the number of static links from the caller to the frame the procedure
+        is defined in. Anything the body reaches through k links is k - 1 + level links from the
+        caller, and the body's own variables now live in the caller's frame
+    */
+    int level = call.args[0];
+    std::map<int, int> labels;
+    for (auto &instr: body) {
+        if (instr.op == "DEFADDR") {
+            labels[instr.args[0]] = next_label++;
+        }
+    }
+    for (auto instr: body) {
+        if (instr.op == "VARIABLE" && instr.args[0] == 0) {
+            instr.args[1] += var_offset - 3;
+        }
+        else if (instr.op == "VARIABLE" || instr.op == "CALL") {
+            instr.args[0] += level - 1;
+        }
+        else if (instr.op == "DEFADDR" || instr.op == "ARROW" || instr.op == "BAR") {
+            instr.args[0] = labels[instr.args[0]];
+        }
+        out.push_back(instr);
+    }
+}
+
+
+bool Optimizer::constant_guard(int begin, int end, int &value)
+{
+    std::vector<long long> stack;
+    for (int i = begin; i < end; i++) {
+        auto &op = code[i].op;
+        if (op == "CONSTANT") {
+            stack.push_back(code[i].args[0]);
+            continue;
+        }
+        if (stack.empty()) {
+            return false;
+        }
+        long long &top = stack.back();
+        if (op == "NOT") {
+            top = 1 - top;
+            continue;
+        }
+        else if (op == "MINUS") {
+            top = -top;
+            continue;
+        }
+        if (stack.size() < 2) {
+            return false;
+        }
+        long long rhs = stack.back();
+        stack.pop_back();
+        long long &lhs = stack.back();
+        // Division by zero is left for the interpreter to fail on
+        if (op == "ADD") lhs = lhs + rhs;
+        else if (op == "SUBTRACT") lhs = lhs - rhs;
+        else if (op == "MULTIPLY") lhs = lhs * rhs;
+        else if (op == "DIVIDE" && rhs != 0) lhs = lhs / rhs;
+        else if (op == "MODULO" && rhs != 0) lhs = lhs % rhs;
+        else if (op == "LESS") lhs = lhs < rhs;
+        else if (op == "EQUAL") lhs = lhs == rhs;
+        else if (op == "GREATER") lhs = lhs > rhs;
+        else if (op == "AND") lhs = (lhs == 1 ? rhs : lhs);
+        else if (op == "OR") lhs = (lhs == 0 ? rhs : lhs);
+        else return false;
+        if (lhs < INT_MIN || lhs > INT_MAX) {
+            return false;
+        }
+    }
+    if (stack.size() != 1) {
+        return false;
+    }
+    value = stack.back();
+    return true;
+}
+
+
+int Optimizer::matching_bar(int arrow)
+{
+    int depth = 0;
+    for (int i = arrow + 1; i < (int)code.size(); i++) {
+        if (code[i].op == "ARROW") {
+            depth++;
+        }
+        else if (code[i].op == "BAR" && depth-- == 0) {
+            return i;
+        }
+    }
+    assert(false);
+    return code.size() - 1;
+}
+
+
+int Optimizer::matching_endproc(int proc)
+{
+    int depth = 0;
+    for (int i = proc + 1; i < (int)code.size(); i++) {
+        if (code[i].op == "PROC") {
+            depth++;
+        }
+        else if (code[i].op == "ENDPROC" && depth-- == 0) {
+            return i;
+        }
+    }
+    assert(false);
+    return code.size() - 1;
+}
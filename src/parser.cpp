@@ -1,42 +1,303 @@
 #include "parser.h"
 #include "symbol.h"
+#include "work_pool.h"
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <cassert>
 #include <set>
+#include <utility>
 
 #define PRINT 1
 
-using std::cout;
-using std::cerr;
 using std::endl;
 
 // Slightly simpler syntax for looking up an element of a set, return true if found
-bool sfind(std::set<Symbol> set, Symbol s) { return set.find(s) != set.end(); }
+bool sfind(const std::set<Symbol> &set, Symbol s) { return set.find(s) != set.end(); }
 
 
-Parser::Parser(bool debug):
-    line(1), num_errors(0), label_num(1), debug_mode(debug)
+Parser::Parser(bool debug, bool bounds_elim):
+    line(1), label_num(1), out(&std::cout), debug_mode(debug), 
+    bounds_elim(bounds_elim), loop_depth(0), procedures(nullptr), symbols(nullptr), threads(1), plan(nullptr),
+    planned(nullptr), next_planned(0)
 {
     init_symbol_sets();
 }
 
 
+void Parser::set_message_stream(std::ostream &out_stream)
+{
+    out = &out_stream;
+}
+
+
+void Parser::set_procedure_cache(ProcedureCache *cache)
+{
+    procedures = cache;
+}
+
+
+void Parser::set_symbol_index(SymbolIndex *index)
+{
+    symbols = index;
+}
+
+
 int Parser::verify_syntax(std::vector<Token> *input_tokens, std::string &output_prog)
 {
-    num_errors = 0;
+    std::vector<Instruction> prog;
+    int errors = verify_syntax(input_tokens, prog);
+    output_prog = plam_text(prog);
+    return errors;
+}
+
+
+void Parser::set_threads(int count)
+{
+    threads = count;
+}
+
+
+void Parser::start(std::vector<Token> *input_tokens)
+{
+    // A parser can be reused for several programs, each compiled as if by a new one
+    diagnostics.clear();
+    output.clear();
     line = 1;
+    label_num = 1;
+    block_table = BlockTable();
     next_token = input_tokens->begin();
+    ranges = RangeAnalysis();
+    unchecked.clear();
+    loop_depth = 0;
+}
+
+
+int Parser::verify_syntax(std::vector<Token> *input_tokens, std::vector<Instruction> &output_prog)
+{
+    /*  Procedure bodies are parsed on their own first, and the whole program afterwards, using the
+        code of each body that means the same there
+    */
+    std::vector<BodyJob> bodies;
+    if (threads > 1 && !procedures && !symbols) {
+        start(input_tokens);
+        parse_bodies(bodies);
+        planned = &bodies;
+        next_planned = 0;
+    }
+    start(input_tokens);
+    if (procedures) {
+        procedures->next_generation();
+    }
+    if (symbols) {
+        symbols->clear();
+        symbol_of.clear();
+    }
     try {
         skip_whitespace();
         program();  
     }
     catch (const eof_error &e) {
-        error_preamble();
-        cerr << e.what() << endl;
+        error(DiagnosticCode::UNEXPECTED_EOF);
+    }
+    if (symbols) {
+        symbols->finish();
     }
+    planned = nullptr;
     // Pass the resulting program back out to caller to be written to file
-    output_prog = output;
-    return num_errors;
+    output_prog = std::move(output);
+    return diagnostics.error_count();
+}
+
+
+void Parser::parse_bodies(std::vector<BodyJob> &bodies)
+{
+    // The first pass goes as far as the program block's statements, skipping procedure bodies
+    plan = &bodies;
+    try {
+        skip_whitespace();
+        new_label();
+        new_label();
+        block_table.push_new();
+        match(BEGIN, "block");
+        definition_part(3);
+    }
+    catch (const eof_error &e) {
+    }
+    plan = nullptr;
+
+    /*  Its messages are found again by the last pass. Each job parses a run of bodies with one
+        parser, with enough jobs for the threads to share them out evenly
+    */
+    auto parse_all = [this](std::vector<BodyJob *> &list, const std::map<int, ModSet> &siblings) {
+        size_t count = std::min(list.size(), (size_t)threads * 8);
+        std::vector<std::function<void()>> jobs;
+        for (size_t i = 0; i < count; i++) {
+            jobs.push_back([this, &list, &siblings, i, count]() {
+                Parser parser(false, bounds_elim);
+                for (size_t b = list.size() * i / count; b < list.size() * (i + 1) / count; b++) {
+                    list[b]->parsed = parser.parse_body(block_table, siblings, *list[b]);
+                }
+            });
+        }
+        WorkPool(threads).run(jobs);
+    };
+    std::vector<BodyJob *> all;
+    for (auto &body: bodies) {
+        all.push_back(&body);
+    }
+    parse_all(all, std::map<int, ModSet>());
+
+    /*  Each procedure's modification set is then worked out in program order, as the procedures
+        called by one are always defined before it
+    */
+    std::map<int, ModSet> siblings;
+    std::vector<BodyJob *> again;
+    for (auto &body: bodies) {
+        if (!body.parsed) {
+            continue;
+        }
+        if (!body.uses_siblings) {
+            siblings[body.label_base] = body.entry.mods[body.label_base];
+            continue;
+        }
+        std::map<int, ModSet> complete;
+        std::set<int> open;
+        if (complete_mods(body, body.label_base, siblings, complete, open)) {
+            siblings[body.label_base] = complete[body.label_base];
+            again.push_back(&body);
+        }
+    }
+    parse_all(again, siblings);
+}
+
+
+bool Parser::complete_mods(const BodyJob &body, int label, const std::map<int, ModSet> &siblings,
+                           std::map<int, ModSet> &complete, std::set<int> &open)
+{
+    if (complete.count(label)) {
+        return true;
+    }
+    auto effects = body.effects.find(label);
+    if (effects == body.effects.end()) {
+        return false;
+    }
+    open.insert(label);
+    // As RangeAnalysis::call adds the changes of each procedure called to the caller's
+    ModSet mods{effects->second.own, false};
+    for (auto &call: effects->second.calls) {
+        int callee = call.first;
+        const ModSet *callee_mods;
+        // Other procedures of the block come before the body's own labels
+        if (callee < body.label_base) {
+            auto found = siblings.find(callee);
+            if (found == siblings.end()) {
+                return false;
+            }
+            callee_mods = &found->second;
+        }
+        else if (open.count(callee)) {
+            mods.all = true;
+            continue;
+        }
+        else {
+            if (!complete_mods(body, callee, siblings, complete, open)) {
+                return false;
+            }
+            callee_mods = &complete[callee];
+        }
+        if (callee_mods->all) {
+            mods.all = true;
+            continue;
+        }
+        for (auto &v: callee_mods->vars) {
+            if (v.first <= call.second) {
+                mods.vars.insert(v);
+            }
+        }
+    }
+    open.erase(label);
+    complete[label] = mods;
+    return true;
+}
+
+
+bool Parser::parse_body(const BlockTable &scope, const std::map<int, ModSet> &siblings, BodyJob &body)
+{
+    output.clear();
+    diagnostics.clear();
+    block_table = BlockTable();
+    ranges = RangeAnalysis();
+    unchecked.clear();
+    loop_depth = 0;
+    // Only the definitions the body uses are made, in the blocks they were made in
+    std::set<std::string> ids;
+    for (auto t = body.first; t != body.last; t++) {
+        if (t->symbol == IDENTIFIER) {
+            ids.insert(t->lexeme);
+        }
+    }
+    std::vector<std::pair<std::string, const BlockData *>> outer;
+    for (auto &id: ids) {
+        const BlockData *data = scope.lookup(id, body.definitions);
+        if (data) {
+            outer.push_back(std::make_pair(id, data));
+        }
+    }
+    std::stable_sort(outer.begin(), outer.end(), [](const std::pair<std::string, const BlockData *> &a,
+                                                    const std::pair<std::string, const BlockData *> &b) {
+        return a.second->level < b.second->level;
+    });
+    for (auto &o: outer) {
+        while (block_table.curr_level < o.second->level) {
+            block_table.push_new();
+        }
+        block_table.insert(o.first, *o.second);
+    }
+    while (block_table.curr_level < body.level) {
+        block_table.push_new();
+    }
+
+    // The procedure itself is open, as in a recursive call
+    std::set<int> deferred;
+    for (auto &o: outer) {
+        const BlockData *data = o.second;
+        if (data->type != PLType::PROCEDURE || data->start_addr == body.label_base) {
+            continue;
+        }
+        auto found = siblings.find(data->start_addr);
+        if (found != siblings.end()) {
+            ranges.add_procedure(data->start_addr, found->second);
+        }
+        else {
+            deferred.insert(data->start_addr);
+        }
+    }
+    ranges.defer(deferred);
+    body.uses_siblings = !deferred.empty();
+
+    next_token = body.first;
+    line = body.line;
+    label_num = body.label_base + 3;
+    auto uses = bindings(body.last);
+    try {
+        procedure_body(body.label_base, body.label_base + 1, body.label_base + 2);
+    }
+    catch (const eof_error &e) {
+        return false;
+    }
+    // Error recovery can take the parse past the END, or end it early
+    auto after = body.last;
+    do {
+        after++;
+    } while (after->symbol == NEWLINE || after->symbol == COMMENT);
+    if (next_token != after) {
+        return false;
+    }
+    body.entry = procedure_entry(body.label_base, body.line, body.first, body.last, 0, 0);
+    body.entry.uses = std::move(uses);
+    body.effects = ranges.effects();
+    return true;
 }
 
 
@@ -48,19 +309,15 @@ int Parser::new_label()
 
 void Parser::emit(std::string instr, std::vector<int> args)
 {
-    output +=  instr + ' ';
-    for (auto a: args) {
-        output += std::to_string(a) + ' ';
-    }
-    output += '\n';
     // Output to command line as well
     if (debug_mode) {
-        cout << instr << ' ';
+        *out << instr << ' ';
         for (auto a: args) {
-            cout << a << ' ';
+            *out << a << ' ';
         }
-        cout << endl;        
+        *out << endl;        
     }
+    output.push_back(Instruction{std::move(instr), std::move(args), line});
 }
 
 
@@ -88,40 +345,30 @@ void Parser::skip_whitespace()
 void Parser::match(Symbol s, std::string nonterminal)
 {
     if (s != next_token->symbol) {
-        error_preamble();
-        cerr << "Expected " << SYMBOL_STRINGS.at(s) << ", found " 
-             << SYMBOL_STRINGS.at(next_token->symbol) << std::endl;
+        error(DiagnosticCode::EXPECTED_SYMBOL, {SYMBOL_STRINGS.at(s), SYMBOL_STRINGS.at(next_token->symbol)});
         synchronize(nonterminal);
     }
     if (s == IDENTIFIER) {
         matched_id = *next_token;
+        matched_span = SourceSpan{line, next_token->column, (int)next_token->lexeme.size()};
     }
     read_next();
 }
 
 
-void Parser::error_preamble()
+void Parser::error(DiagnosticCode code, std::vector<std::string> args)
 {
-    num_errors++;
-    cerr << "Error " << num_errors << " on line " << line << ": ";
+    diagnostics.error(line, next_token->column, code, args);
 }
 
 
 void Parser::syntax_error(std::string nonterminal)
 {
-    error_preamble();
-    cerr << "Unexpected " << SYMBOL_STRINGS.at(next_token->symbol) << " symbol" << endl;
+    error(DiagnosticCode::UNEXPECTED_SYMBOL, {SYMBOL_STRINGS.at(next_token->symbol)});
     synchronize(nonterminal);
 }
 
 
-void Parser::type_error(std::string msg)
-{
-    error_preamble();
-    std::cout << msg << std::endl;
-}
-
-
 void Parser::synchronize(std::string nonterminal)
 {
     auto sync = follow[nonterminal];
@@ -129,8 +376,8 @@ void Parser::synchronize(std::string nonterminal)
     while (!sfind(sync, next_token->symbol)) {
         read_next();
     }
-    cerr << "-- Resuming from " << SYMBOL_STRINGS.at(next_token->symbol) << " on line " 
-         << line << endl; 
+    diagnostics.report(Severity::NOTE, line, next_token->column, DiagnosticCode::RESUMING,
+                       {SYMBOL_STRINGS.at(next_token->symbol)});
 }
 
 
@@ -142,22 +389,151 @@ void Parser::check_follow(std::string nonterminal)
 }
 
 
+bool Parser::scalar_var(const BlockData *data, VarKey &key)
+{
+    if (!data || data->constant || data->array || data->type == PLType::PROCEDURE) {
+        return false;
+    }
+    key = VarKey(data->level, data->displacement);
+    return true;
+}
+
+
+LoopSummary Parser::loop_summary()
+{
+    LoopSummary summary;
+    summary.changes_all = false;
+    auto change = [&](VarKey key, LoopEffect effect) {
+        auto it = summary.effects.find(key);
+        if (it == summary.effects.end()) {
+            summary.effects[key] = effect;
+        }
+        else if (it->second != effect) {
+            it->second = LoopEffect::CHANGED;
+        }
+    };
+    // Skip newlines and comments, never moving past the end of input
+    auto next = [](std::vector<Token>::iterator it) {
+        if (it->symbol == END_OF_FILE) return it;
+        do {
+            it++;
+        } while (it->symbol == NEWLINE || it->symbol == COMMENT);
+        return it;
+    };
+
+    int depth = 0;
+    bool statement_start = false;
+    for (auto it = next_token; it->symbol != END_OF_FILE; it = next(it)) {
+        auto s = it->symbol;
+        if (s == DO) {
+            depth++;
+        }
+        else if (s == OD && --depth == 0) {
+            break;
+        }
+        if (!statement_start) {
+            statement_start = (s == RIGHT_ARROW || s == SEMICOLON);
+            continue;
+        }
+        statement_start = false;
+
+        if (s == IDENTIFIER || s == READ) {
+            // Variables outside of brackets, up to the := or end of statement, are changed
+            std::vector<VarKey> targets;
+            int brackets = 0;
+            auto t = it;
+            for (; t->symbol != END_OF_FILE && t->symbol != SEMICOLON; t = next(t)) {
+                if (t->symbol == LEFT_BRACKET) brackets++;
+                else if (t->symbol == RIGHT_BRACKET) brackets--;
+                else if (t->symbol == ASSIGN && brackets == 0) break;
+                VarKey key;
+                if (brackets == 0 && t->symbol == IDENTIFIER && scalar_var(block_table.lookup(t->lexeme), key)) {
+                    targets.push_back(key);
+                }
+            }
+            // Recognize var := var + constant and var := var - constant
+            LoopEffect effect = LoopEffect::CHANGED;
+            if (s == IDENTIFIER && targets.size() == 1 && t->symbol == ASSIGN) {
+                auto rhs = next(t);
+                auto op = next(rhs);
+                auto amount = next(op);
+                auto end = next(amount);
+                int value = -1;
+                if (amount->symbol == NUMERAL) {
+                    value = amount->value;
+                }
+                else if (amount->symbol == IDENTIFIER) {
+                    BlockData *data = block_table.lookup(amount->lexeme);
+                    if (data && data->constant && data->type == PLType::INTEGER) {
+                        value = data->value;
+                    }
+                }
+                if (rhs->symbol == IDENTIFIER && rhs->lexeme == it->lexeme && value >= 0
+                    && end->symbol == SEMICOLON) {
+                    if (op->symbol == ADD) effect = LoopEffect::INCREASING;
+                    else if (op->symbol == SUBTRACT) effect = LoopEffect::DECREASING;
+                }
+            }
+            for (auto &key: targets) {
+                change(key, effect);
+            }
+        }
+        else if (s == CALL) {
+            auto proc = next(it);
+            ModSet mods;
+            BlockData *data = block_table.lookup(proc->lexeme);
+            if (data && (data->type != PLType::PROCEDURE 
+                || !ranges.modifications(data->start_addr, data->level, mods) || mods.all)) {
+                summary.changes_all = true;
+            }
+            for (auto &key: mods.vars) {
+                change(key, LoopEffect::CHANGED);
+            }
+        }
+        else if (s == DO || s == IF) {
+            // Guard expressions follow, not a statement
+        }
+        else {
+            statement_start = (s == RIGHT_ARROW || s == SEMICOLON);
+        }
+    }
+    return summary;
+}
+
+
 void Parser::define_var(std::string id, PLType type, int size, int value, bool constant, bool array, 
-                        int displacement, int start_addr) {
+                        int displacement, int start_addr, const SourceSpan &span) {
     BlockData b;
     b.type = type;
     b.size = size;
-    b.value = value;
     b.constant = constant;
     b.array = array;
     b.displacement = displacement;
-    b.start_addr = start_addr; 
-    try {
-        block_table.insert(id, b);
+    // Only procedures have a start address, which takes the place of the value
+    if (type == PLType::PROCEDURE) {
+        b.start_addr = start_addr;
     }
-    catch (const scope_error &e) {
-        error_preamble();
-        cerr << e.what() << endl;
+    else {
+        b.value = value;
+    }
+    if (!block_table.insert(id, b)) {
+        error(DiagnosticCode::REDEFINED_IDENTIFIER, {id});
+    }
+    else if (symbols) {
+        BlockData *data = block_table.lookup(id);
+        size_t position = block_table.position(data);
+        if (symbol_of.size() <= position) {
+            symbol_of.resize(position + 1);
+        }
+        symbol_of[position] = symbols->define(id, span, *data);
+    }
+}
+
+
+void Parser::note_reference(const BlockData *data)
+{
+    if (symbols && data) {
+        symbols->reference(matched_span, symbol_of[block_table.position(data)]);
     }
 }
 
@@ -175,10 +551,8 @@ void Parser::program()
     emit("ENDPROG");
     // Matching an eof token would normally produce an error, so handle in special case here
     if (next_token->symbol != END_OF_FILE) {
-        num_errors++;
-        std::cout << "Error " << num_errors << " on line " << line << ": Expected " 
-                  << SYMBOL_STRINGS.at(END_OF_FILE) << ", found " 
-                  << SYMBOL_STRINGS.at(next_token->symbol) << std::endl;
+        error(DiagnosticCode::EXPECTED_SYMBOL,
+              {SYMBOL_STRINGS.at(END_OF_FILE), SYMBOL_STRINGS.at(next_token->symbol)});
     }
 }
 
@@ -246,6 +620,7 @@ void Parser::constant_definition()
     match(CONST, nonterm);    
     match(IDENTIFIER, nonterm);
     auto id = matched_id.lexeme;
+    auto span = matched_span;
     match(EQUALS, nonterm);
     int value;
     auto type = constant(value);
@@ -257,7 +632,8 @@ void Parser::constant_definition()
         true,   // constant
         false,  // array
         0,      // displacement - doesn't apply to constants
-        0       // start_addr, for procedures, doesn't apply to constants
+        0,      // start_addr, for procedures, doesn't apply to constants
+        span    // where id is defined
     );
 }
 
@@ -273,7 +649,7 @@ int Parser::variable_definition(int &offset)
 int Parser::variable_definition_type(PLType varlist_type, int &offset)
 {
     std::string nonterm = "variable_definition_type";
-    std::vector<std::string> vars;
+    std::vector<DefinedId> vars;
     int size = 1;
     auto s = next_token->symbol;
     bool arr = false;
@@ -289,7 +665,7 @@ int Parser::variable_definition_type(PLType varlist_type, int &offset)
         // Get size of the array from constant
         auto arr_size_type = constant(size);
         if (!equals(arr_size_type, PLType::INTEGER)) {
-            type_error("Array bounds must be of type integer");
+            error(DiagnosticCode::ARRAY_BOUND_TYPE);
         }
         match(RIGHT_BRACKET, nonterm);
     }
@@ -297,16 +673,17 @@ int Parser::variable_definition_type(PLType varlist_type, int &offset)
         syntax_error(nonterm);
     }
     int len = 0;
-    for (auto &id: vars) {
+    for (auto &var: vars) {
         define_var(
-            id,             // id
+            var.id,         // id
             varlist_type,   // type
             size,           // size
             0,              // value
             false,          // constant
             arr,            // array
             offset,         // displacement
-            0               // start_addr - for procedures, doesn't apply to vars 
+            0,              // start_addr - for procedures, doesn't apply to vars 
+            var.span        // where id is defined
         );
         offset += size;
         len += size;
@@ -334,23 +711,23 @@ PLType Parser::type_symbol()
 }
 
 
-void Parser::variable_list(std::vector<std::string> &var_list)
+void Parser::variable_list(std::vector<DefinedId> &var_list)
 {
     std::string nonterm = "variable_list";
     match(IDENTIFIER, nonterm);
-    var_list.push_back(matched_id.lexeme);
+    var_list.push_back(DefinedId{matched_id.lexeme, matched_span});
     variable_list_end(var_list);
 }
 
 
-void Parser::variable_list_end(std::vector<std::string> &var_list)
+void Parser::variable_list_end(std::vector<DefinedId> &var_list)
 {
     std::string nonterm = "variable_list_end";
     auto s = next_token->symbol;
     if (s == COMMA) {
         match(s, nonterm);
         match(IDENTIFIER, nonterm);
-        var_list.push_back(matched_id.lexeme);
+        var_list.push_back(DefinedId{matched_id.lexeme, matched_span});
         variable_list_end(var_list);
     }
     // epsilon production
@@ -381,16 +758,311 @@ void Parser::procedure_definition()
         false,              // constant
         false,              // array
         0,                  // displacement - doesn't apply to procedures
-        proc_label          // start_addr 
+        proc_label,         // start_addr 
+        matched_span        // where id is defined
     );
 
+    // In the first pass of a parallel parse, the program block's procedure bodies are only found
+    if (plan && block_table.curr_level == 1 && next_token->symbol == BEGIN) {
+        auto body_end = block_end();
+        if (body_end->symbol == END) {
+            plan->push_back(BodyJob{next_token, body_end, block_table.size(), block_table.curr_level,
+                                    line, proc_label, false, CachedProcedure(), false,
+                                    std::map<int, ProcedureEffects>()});
+            skip_body(body_end, std::count_if(next_token, body_end, [](const Token &t) {
+                return t.symbol == NEWLINE;
+            }));
+            return;
+        }
+    }
+    // In the last, they are used if they mean the same as where they were parsed on their own
+    if (planned) {
+        while (next_planned < planned->size() && (*planned)[next_planned].first < next_token) {
+            next_planned++;
+        }
+        if (next_planned < planned->size() && (*planned)[next_planned].first == next_token) {
+            BodyJob &body = (*planned)[next_planned++];
+            if (body.parsed && splice_procedure(body.entry, proc_label, body.last, true)) {
+                return;
+            }
+        }
+    }
+
+    /*  With a procedure cache, the body is looked up by its tokens before it is parsed. The
+        bindings of the identifiers it uses are taken now, as they are on entry to the body
+    */
+    auto body_end = next_token;
+    unsigned long long key = 0;
+    std::vector<Binding> uses;
+    if (procedures && next_token->symbol == BEGIN) {
+        body_end = block_end();
+        if (body_end->symbol == END) {
+            key = ProcedureCache::key(next_token, body_end);
+            if (reuse_procedure(key, proc_label, body_end)) {
+                return;
+            }
+            procedures->miss();
+            uses = bindings(body_end);
+        }
+    }
+    int errors = diagnostics.error_count();
+    int body_line = line;
+    auto body_start = next_token;
+    size_t code_start = output.size();
+    size_t messages_start = diagnostics.records().size();
+    size_t symbols_start = symbols ? symbols->all_definitions().size() : 0;
+    size_t occurrences_start = symbols ? symbols->all_occurrences().size() : 0;
+
+    procedure_body(proc_label, var_label, start_label);
+
+    // Only bodies without errors are kept, so reusing one never needs to report anything
+    if (key && diagnostics.error_count() == errors) {
+        CachedProcedure entry = procedure_entry(proc_label, body_line, body_start, body_end, code_start,
+                                                messages_start);
+        entry.tokens.assign(body_start, body_end + 1);
+        entry.uses = std::move(uses);
+        entry.has_symbols = symbols != nullptr;
+        if (symbols) {
+            auto &defs = symbols->all_definitions();
+            entry.symbol_defs.assign(defs.begin() + symbols_start, defs.end());
+            auto &occurrences = symbols->all_occurrences();
+            std::map<int, int> outer;
+            for (size_t i = occurrences_start; i < occurrences.size(); i++) {
+                Occurrence o = occurrences[i];
+                if (o.definition >= (int)symbols_start) {
+                    o.definition -= symbols_start;
+                }
+                else {
+                    if (!outer.count(o.definition)) {
+                        outer[o.definition] = -1 - entry.outer_ids.size();
+                        entry.outer_ids.push_back(defs[o.definition].id);
+                    }
+                    o.definition = outer[o.definition];
+                }
+                entry.symbol_uses.push_back(o);
+            }
+        }
+        procedures->store(key, std::move(entry));
+    }
+} 
+
+
+void Parser::procedure_body(int proc_label, int var_label, int start_label)
+{
     block_table.push_new();
+    ranges.enter_procedure();
     emit("DEFADDR", {proc_label});
     emit("PROC", {var_label, start_label});
     block(var_label, start_label);
     emit("ENDPROC");
+    ranges.exit_procedure(proc_label);
     block_table.pop();
-} 
+}
+
+
+CachedProcedure Parser::procedure_entry(int proc_label, int body_line,
+                                        std::vector<Token>::iterator body_start,
+                                        std::vector<Token>::iterator body_end, size_t code_start,
+                                        size_t messages_start)
+{
+    CachedProcedure entry;
+    entry.level = block_table.curr_level;
+    entry.label_base = proc_label;
+    entry.label_count = label_num - proc_label;
+    entry.line = body_line;
+    entry.newlines = std::count_if(body_start, body_end, [](const Token &t) {
+        return t.symbol == NEWLINE;
+    });
+    entry.code.assign(output.begin() + code_start, output.end());
+    auto &procs = ranges.procedures();
+    entry.mods.insert(procs.lower_bound(proc_label), procs.lower_bound(label_num));
+    auto &records = diagnostics.records();
+    entry.messages.assign(records.begin() + messages_start, records.end());
+    entry.has_symbols = false;
+    return entry;
+}
+
+
+void Parser::skip_body(std::vector<Token>::iterator body_end, int newlines)
+{
+    line += newlines;
+    next_token = body_end;
+    read_next();
+}
+
+
+std::vector<Token>::iterator Parser::block_end() const
+{
+    int depth = 0;
+    for (auto t = next_token; ; t++) {
+        if (t->symbol == BEGIN) {
+            depth++;
+        }
+        else if (t->symbol == END && --depth == 0) {
+            return t;
+        }
+        else if (t->symbol == END_OF_FILE) {
+            return t;
+        }
+    }
+}
+
+
+Binding Parser::binding(const std::string &id) const
+{
+    Binding b;
+    b.id = id;
+    // lookup doesn't change the table, it only hands out a pointer callers may write through
+    BlockData *data = const_cast<BlockTable &>(block_table).lookup(id);
+    b.defined = data != nullptr;
+    b.mods_known = false;
+    b.mods.all = false;
+    if (data) {
+        b.data = *data;
+        if (data->type == PLType::PROCEDURE) {
+            b.mods_known = ranges.modifications(data->start_addr, data->level, b.mods);
+        }
+    }
+    return b;
+}
+
+
+std::vector<Binding> Parser::bindings(std::vector<Token>::iterator last) const
+{
+    std::set<std::string> ids;
+    for (auto t = next_token; t != last; t++) {
+        if (t->symbol == IDENTIFIER) {
+            ids.insert(t->lexeme);
+        }
+    }
+    std::vector<Binding> result;
+    for (auto &id: ids) {
+        result.push_back(binding(id));
+    }
+    return result;
+}
+
+
+bool Parser::same_binding(const Binding &use, std::map<int, int> &labels) const
+{
+    Binding now = binding(use.id);
+    if (now.defined != use.defined) {
+        return false;
+    }
+    if (!now.defined) {
+        return true;
+    }
+    const BlockData &a = now.data, &b = use.data;
+    if (a.type != b.type || a.constant != b.constant || a.array != b.array || a.level != b.level ||
+        a.size != b.size || a.displacement != b.displacement) {
+        return false;
+    }
+    if (a.type != PLType::PROCEDURE) {
+        return a.value == b.value;
+    }
+    if (now.mods_known != use.mods_known || now.mods.all != use.mods.all ||
+        now.mods.vars != use.mods.vars) {
+        return false;
+    }
+    labels[b.start_addr] = a.start_addr;
+    return true;
+}
+
+
+bool Parser::reuse_procedure(unsigned long long key, int label_base,
+                             std::vector<Token>::iterator body_end)
+{
+    for (CachedProcedure *entry: procedures->find(key, next_token, body_end)) {
+        if (symbols && !entry->has_symbols) {
+            continue;
+        }
+        if (splice_procedure(*entry, label_base, body_end, false)) {
+            procedures->use(*entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool Parser::splice_procedure(CachedProcedure &entry, int label_base,
+                              std::vector<Token>::iterator body_end, bool take)
+{
+    if (entry.level != block_table.curr_level) {
+        return false;
+    }
+    std::map<int, int> labels;
+    for (auto &use: entry.uses) {
+        if (!same_binding(use, labels)) {
+            return false;
+        }
+    }
+
+    // The procedure's own labels keep their order, procedures it calls may have moved
+    int label_shift = label_base - entry.label_base;
+    int line_shift = line - entry.line;
+    auto relocate = [&](int &label) {
+        if (label >= entry.label_base && label < entry.label_base + entry.label_count) {
+            label += label_shift;
+        }
+        else if (labels.count(label)) {
+            label = labels[label];
+        }
+    };
+    for (auto &instr: entry.code) {
+        std::vector<int> args = take ? std::move(instr.args) : instr.args;
+        auto &op = instr.op;
+        if (op == "CALL") {
+            relocate(args[1]);
+        }
+        else if (op == "PROC") {
+            relocate(args[0]);
+            relocate(args[1]);
+        }
+        else if (op == "DEFADDR" || op == "DEFARG" || op == "ARROW" || op == "BAR") {
+            relocate(args[0]);
+        }
+        else if (op == "FI") {
+            args[0] += line_shift;
+        }
+        else if (op == "INDEX") {
+            args[1] += line_shift;
+        }
+        emit(take ? std::move(op) : op, std::move(args));
+        output.back().line = instr.line + line_shift;
+    }
+    for (auto &m: entry.mods) {
+        ranges.add_procedure(m.first + label_shift, m.second);
+    }
+    if (symbols) {
+        // Definitions outside the body are found by name, as they were when it was parsed
+        std::vector<int> outer;
+        for (auto &id: entry.outer_ids) {
+            outer.push_back(symbol_of[block_table.position(block_table.lookup(id))]);
+        }
+        int first = symbols->all_definitions().size();
+        for (auto o: entry.symbol_uses) {
+            o.span.line += line_shift;
+            if (o.is_definition) {
+                SymbolDefinition def = entry.symbol_defs[o.definition];
+                if (def.data.type == PLType::PROCEDURE) {
+                    def.data.start_addr += label_shift;
+                }
+                symbols->define(def.id, o.span, def.data);
+            }
+            else {
+                symbols->reference(o.span, o.definition < 0 ? outer[-1 - o.definition] : 
+                                                              first + o.definition);
+            }
+        }
+    }
+    for (auto &d: entry.messages) {
+        diagnostics.report(d.severity, d.line + line_shift, d.column, d.code, d.args);
+    }
+    label_num = label_base + entry.label_count;
+    skip_body(body_end, entry.newlines);
+    return true;
+}
 
 
 void Parser::statement_part()
@@ -453,44 +1125,48 @@ void Parser::read_statement()
 {
     std::string nonterm = "read_statement";
     match(READ, nonterm);
-    std::vector<std::string> vars;
+    std::vector<VariableRef> vars;
     variable_access_list(vars);
     emit("READ", {static_cast<int>(vars.size())});
-    for (auto id: vars) {
-        try {
-            BlockData &data = block_table.find(id);
-            if (data.constant) {
-                type_error("Cannot read value for constant " + id);
-            }
-            else if (equals(data.type, PLType::PROCEDURE)) {
-                type_error("Cannot read value for procedure " + id);
-            }
+    for (auto &var: vars) {
+        VarKey key;
+        if (scalar_var(var.data, key)) {
+            ranges.clobber(key);
+        }
+        // Undefined variables have already been reported by variable_access
+        if (!var.data) {
+            continue;
         }
-        catch (scope_error) {
-            // Error messages already issued in variable_access            
+        if (var.data->constant) {
+            error(DiagnosticCode::READ_CONSTANT, {var.id});
+        }
+        else if (equals(var.data->type, PLType::PROCEDURE)) {
+            error(DiagnosticCode::READ_PROCEDURE, {var.id});
         }
     }
 }
 
 
-void Parser::variable_access_list(std::vector<std::string> &vars)
+void Parser::variable_access_list(std::vector<VariableRef> &vars)
 {
 	std::string nonterm = "variable_access_list";
-    auto var_id = variable_access();
-    vars.push_back(var_id);
+    VariableRef var;
+    var.data = variable_access(var.id);
+    vars.push_back(var);
     variable_access_list_end(vars);
 }
 
 
-void Parser::variable_access_list_end(std::vector<std::string> &vars)
+void Parser::variable_access_list_end(std::vector<VariableRef> &vars)
 {
     std::string nonterm = "variable_access_list_end";
     std::set<Symbol> first{SEMICOLON, ASSIGN};
     auto s = next_token->symbol;
     if (s == COMMA) {
         match(COMMA, nonterm);
-        auto id = variable_access();
-        vars.push_back(id);
+        VariableRef var;
+        var.data = variable_access(var.id);
+        vars.push_back(var);
         variable_access_list_end(vars);
     }
     // epsilon production 
@@ -505,32 +1181,34 @@ void Parser::write_statement()
     std::string nonterm = "write_statement";
     match(WRITE, nonterm);
     std::vector<PLType> types;    
-    expression_list(types);
+    std::vector<ExprShape> shapes;
+    expression_list(types, shapes);
     emit("WRITE", {static_cast<int>(types.size())});
     for (auto t: types) {
         if (equals(t, PLType::PROCEDURE)) {
-            type_error("Cannot write procedure");
+            error(DiagnosticCode::WRITE_PROCEDURE);
         }
     }
 }
 
 
-void Parser::expression_list(std::vector<PLType> &types)
+void Parser::expression_list(std::vector<PLType> &types, std::vector<ExprShape> &shapes)
 {
 	std::string nonterm = "expression_list";
     auto expr_type = expression();
     types.push_back(expr_type);
-    expression_list_end(types);
+    shapes.push_back(shape);
+    expression_list_end(types, shapes);
 }
 
 
-void Parser::expression_list_end(std::vector<PLType> &types)
+void Parser::expression_list_end(std::vector<PLType> &types, std::vector<ExprShape> &shapes)
 {
     std::string nonterm = "expression_list_end";
     auto s = next_token->symbol;
     if (s == COMMA) {
         match(s, nonterm);
-        expression_list(types);
+        expression_list(types, shapes);
     }
     // epsilon production 
     else {
@@ -542,34 +1220,42 @@ void Parser::expression_list_end(std::vector<PLType> &types)
 void Parser::assignment_statement()
 {
     std::string nonterm = "assignment_statement";
-    std::vector<std::string> vars;
+    std::vector<VariableRef> vars;
     std::vector<PLType> expr_types;
+    std::vector<ExprShape> expr_shapes;
     variable_access_list(vars);
     match(ASSIGN, nonterm);
-    expression_list(expr_types);
+    expression_list(expr_types, expr_shapes);
     emit("ASSIGN", {static_cast<int>(expr_types.size())});
+
+    std::vector<std::pair<VarKey, ExprShape>> assignments;
+    for (unsigned int i = 0; i < vars.size(); i++) {
+        VarKey key;
+        if (scalar_var(vars[i].data, key)) {
+            auto value = (i < expr_shapes.size() ? expr_shapes[i] : ExprShape::other());
+            assignments.push_back(std::make_pair(key, value));
+        }
+    }
+    ranges.assign(assignments);
     if (vars.size() != expr_types.size()) {
-        error_preamble();
-        std::cout << "Number of variables does not match number of expressions" << std::endl;
+        error(DiagnosticCode::ASSIGNMENT_COUNT);
     }
     else {
         for (unsigned int i = 0; i < vars.size(); i++) {
-            auto id = vars[i];
+            const BlockData *data = vars[i].data;
             auto e_type = expr_types[i];
-            try {
-                BlockData &data = block_table.find(id);
-                if (data.constant) {
-                    type_error("Cannot assign value to constant " + id);
-                }
-                else if ((data.type == PLType::PROCEDURE) || (e_type == PLType::PROCEDURE)) {
-                    type_error("Procedure type cannot be used in assignment statement");
-                }
-                else if (!equals(data.type, e_type)) {
-                    type_error("Mismatch between types of LHS and RHS of assignment statement");
-                }
+            // Undefined variables have already been reported by variable_access
+            if (!data) {
+                continue;
+            }
+            if (data->constant) {
+                error(DiagnosticCode::ASSIGN_CONSTANT, {vars[i].id});
             }
-            catch (scope_error) {
-                // These errors will have already been issued in variable_access
+            else if ((data->type == PLType::PROCEDURE) || (e_type == PLType::PROCEDURE)) {
+                error(DiagnosticCode::ASSIGN_PROCEDURE);
+            }
+            else if (!equals(data->type, e_type)) {
+                error(DiagnosticCode::ASSIGNMENT_TYPE);
             }
         }
     }
@@ -581,18 +1267,18 @@ void Parser::procedure_statement()
     match(CALL, nonterm);
     match(IDENTIFIER, nonterm);
     auto id = matched_id.lexeme;
-    try {
-        BlockData &data = block_table.find(id);        
-        if (!equals(data.type, PLType::PROCEDURE)) {
-            type_error("Cannot call a non procedure type");
-        }
-        // CALL, relative level above current, first instruction of proc
-        emit("CALL", {block_table.curr_level - data.level, data.start_addr});
-    }
-    catch (const scope_error &e) {
-        error_preamble();
-        cerr << e.what() << endl;
-    }
+    BlockData *data = block_table.lookup(id);
+    if (!data) {
+        error(DiagnosticCode::UNDEFINED_IDENTIFIER, {id});
+        return;
+    }
+    note_reference(data);
+    if (!equals(data->type, PLType::PROCEDURE)) {
+        error(DiagnosticCode::CALL_NON_PROCEDURE);
+    }
+    // CALL, relative level above current, first instruction of proc
+    emit("CALL", {block_table.curr_level - data->level, data->start_addr});
+    ranges.call(data->start_addr, data->level);
 }
 
 
@@ -602,7 +1288,9 @@ void Parser::if_statement()
     int start_label = new_label();
     int done_label = new_label();
     match(IF, nonterm);
+    ranges.begin_if();
     guarded_command_list(start_label, done_label);
+    ranges.end_if();
     emit("DEFADDR", {start_label});
     emit("FI", {line});
     emit("DEFADDR", {done_label});
@@ -615,9 +1303,22 @@ void Parser::do_statement()
 	std::string nonterm = "do_statement";
     int start_label = new_label();
     int loop_label = new_label();
+    ranges.begin_do(loop_summary());
+    size_t first_unchecked = unchecked.size();
+    loop_depth++;
     match(DO, nonterm);
     emit("DEFADDR", {loop_label});
     guarded_command_list(start_label, loop_label);
+    // A counter that may wrap around isn't bounded by its start, so the loop keeps its checks
+    if (!ranges.end_do()) {
+        for (size_t i = first_unchecked; i < unchecked.size(); i++) {
+            output[unchecked[i].position] = Instruction{"INDEX", {unchecked[i].size, unchecked[i].line},
+                                                        output[unchecked[i].position].line};
+        }
+    }
+    if (--loop_depth == 0) {
+        unchecked.clear();
+    }
     emit("DEFADDR", {start_label});
     match(OD, nonterm);
 }
@@ -651,15 +1352,18 @@ void Parser::guarded_command(int &start_label, int &goto_label)
 {
     std::string nonterm = "guarded_command";
     emit("DEFADDR", {start_label});
+    ranges.begin_guard();
     auto guard_type = expression();
+    ranges.assume(shape);
     // Create a new label for next guarded command
     start_label = new_label();
     emit("ARROW", {start_label});
     if (!equals(guard_type, PLType::BOOLEAN)) {
-        type_error("Guarded command must evaluate to Boolean type");
+        error(DiagnosticCode::GUARD_TYPE);
     }
     match(RIGHT_ARROW, nonterm);
     statement_part();
+    ranges.end_guard();
     // Jump to the end of the construct
     emit("BAR", {goto_label});
 }
@@ -678,11 +1382,13 @@ PLType Parser::expression_end(PLType lhs_type)
     std::string nonterm = "expression_end";
     auto s = next_token->symbol;
     if (s == AND || s == OR) {
+        auto lhs_shape = shape;
         primary_operator();
         auto rhs_type = expression();
+        shape = (s == AND ? ExprShape::conjoin(lhs_shape, shape) : ExprShape::other());
         emit((s == AND ? "AND" : "OR"));
         if (!equals(lhs_type, PLType::BOOLEAN) || !equals(rhs_type, PLType::BOOLEAN)) {
-            type_error("Both operands for logical operator must be Boolean");
+            error(DiagnosticCode::LOGICAL_OPERAND_TYPE);
             return PLType::UNDEFINED;
         }
         return lhs_type;
@@ -721,15 +1427,17 @@ PLType Parser::primary_expression_end(PLType lhs_type)
     std::string nonterm = "primary_expression_end";
     auto s = next_token->symbol;
     if (s == LESS_THAN || s == GREATER_THAN || s == EQUALS) {
+        auto lhs_shape = shape;
         relational_operator();
         auto rhs_type = primary_expression();
+        shape = ExprShape::compare(lhs_shape, s, shape);
         switch (s) {
             case LESS_THAN: emit("LESS"); break;
             case GREATER_THAN: emit("GREATER"); break;
             case EQUALS: emit("EQUAL"); break;
         }
         if (!(equals(lhs_type, PLType::INTEGER) && equals(PLType::INTEGER, rhs_type))) {
-            type_error("Both operands of a comparison must be integers");
+            error(DiagnosticCode::COMPARISON_OPERAND_TYPE);
             return PLType::UNDEFINED;
         }
         return PLType::BOOLEAN;
@@ -763,9 +1471,10 @@ PLType Parser::simple_expression()
     if (s == SUBTRACT) {
         match(s, nonterm);
         auto lhs_type = term();
+        shape = ExprShape::negative(shape);
         emit("MINUS");
         if (!equals(lhs_type, PLType::INTEGER)) {
-            type_error("Cannot negate a non integer value");
+            error(DiagnosticCode::NEGATE_TYPE);
             lhs_type = PLType::UNDEFINED;
         }
         return simple_expression_end(lhs_type);
@@ -786,10 +1495,12 @@ PLType Parser::simple_expression_end(PLType lhs_type)
     std::string nonterm = "simple_expression_end";
     auto s = next_token->symbol;
     if (s == ADD || s == SUBTRACT) {
+        auto lhs_shape = shape;
         adding_operator();
         auto rhs_type = term();
+        shape = ExprShape::arithmetic(lhs_shape, s, shape);
         if (!equals(lhs_type, PLType::INTEGER) || !equals(rhs_type, PLType::INTEGER)) {
-            type_error("Both operands of addition type operator must be integers");
+            error(DiagnosticCode::ADDING_OPERAND_TYPE);
             lhs_type = PLType::UNDEFINED;
         }
         emit((s == ADD ? "ADD" : "SUBTRACT"));
@@ -829,15 +1540,17 @@ PLType Parser::term_end(PLType lhs_type)
     std::string nonterm = "term_end";
     auto s = next_token->symbol;
     if (s == MULTIPLY || s == DIVIDE || s == MODULO) {
+        auto lhs_shape = shape;
         multiplying_operator();
         auto rhs_type = factor();
+        shape = ExprShape::arithmetic(lhs_shape, s, shape);
         switch (s) {
             case MULTIPLY: emit("MULTIPLY"); break;
             case DIVIDE: emit("DIVIDE"); break;
             case MODULO: emit("MODULO"); break;
         }
         if (!equals(lhs_type, PLType::INTEGER) || !equals(rhs_type, PLType::INTEGER)) {
-            type_error("Both operands of multiplication type operators must be integers");
+            error(DiagnosticCode::MULTIPLYING_OPERAND_TYPE);
             lhs_type = PLType::UNDEFINED;
         }
         return term_end(lhs_type);
@@ -875,76 +1588,81 @@ PLType Parser::factor()
     }
     else if (s == IDENTIFIER) {
         auto id = next_token->lexeme;
-        BlockData data;
-        try {
-            data = block_table.find(id);
-        }
-        catch (const scope_error &e) {
+        shape = ExprShape::other();
+        // The one lookup of this identifier, shared with variable_access
+        BlockData *data = block_table.lookup(id);
+        if (!data) {
             match(IDENTIFIER, nonterm); // Need to get rid of id from input to continue
-            error_preamble();
-            cerr << e.what() << endl;
+            error(DiagnosticCode::UNDEFINED_IDENTIFIER, {id});
             return PLType::UNDEFINED;
         }
-        if (data.constant) {
-            int value;
-            auto type = constant(value);
-            emit("CONSTANT", {value});
-            return type;    
+        if (data->constant) {
+            match(IDENTIFIER, nonterm);
+            note_reference(data);
+            emit("CONSTANT", {data->value});
+            shape = ExprShape::constant(data->value);
+            return data->type;    
         }
         else {
-            id = variable_access();
-            data = block_table.find(id);
+            variable_access(id, data);
             emit("VALUE");
-            return data.type;
+            VarKey key;
+            shape = (scalar_var(data, key) ? ExprShape::linear(key) : ExprShape::other());
+            return data->type;
         }
     }
     else if (s == NUMERAL || s == TRUE_KEYWORD || s == FALSE_KEYWORD) {
         int value;
         auto type = constant(value);
         emit("CONSTANT", {value});
+        shape = ExprShape::constant(value);
         return type;
     }
     else if (s == NOT) {
         match(s, nonterm);
         auto type = factor();
+        shape = ExprShape::logical_not(shape);
         emit("NOT");
         if (!equals(type, PLType::BOOLEAN)) {
-            type_error("Cannot take logical inverse of a non Boolean expression");
+            error(DiagnosticCode::NOT_OPERAND_TYPE);
             return PLType::UNDEFINED;
         }
         return type;
     }
     else {
+        shape = ExprShape::other();
         syntax_error(nonterm);
         return PLType::UNDEFINED;
     }
 }
 
 
-std::string Parser::variable_access()
+BlockData *Parser::variable_access(std::string &id, BlockData *data)
 {
     std::string nonterm = "variable_access";
     match(IDENTIFIER, nonterm);
-    auto id = matched_id.lexeme;
-    try {
-        auto data = block_table.find(id);
-        emit("VARIABLE", {block_table.curr_level - data.level, data.displacement});
+    id = matched_id.lexeme;
+    if (!data) {
+        data = block_table.lookup(id);
     }
-    catch (const scope_error &e) {
-        error_preamble();
-        cerr << e.what() << endl;
+    note_reference(data);
+    if (data) {
+        emit("VARIABLE", {block_table.curr_level - data->level, data->displacement});
     }
-    variable_access_end();
-    return id;
+    else {
+        error(DiagnosticCode::UNDEFINED_IDENTIFIER, {id});
+    }
+    variable_access_end(data);
+    return data;
 }
 
 
-void Parser::variable_access_end()
+void Parser::variable_access_end(const BlockData *data)
 {
     std::string nonterm = "variable_access_end";
     auto s = next_token->symbol;
     if (s == LEFT_BRACKET) {
-        indexed_selector();
+        indexed_selector(data);
     }
     // epsilon production 
     else {
@@ -953,24 +1671,26 @@ void Parser::variable_access_end()
 }
 
 
-void Parser::indexed_selector()
+void Parser::indexed_selector(const BlockData *data)
 {
     std::string nonterm = "indexed_selector";
-    // Last matched id before the [] was the array identifier
-    auto id = matched_id.lexeme;
     match(LEFT_BRACKET, nonterm);
     auto ind_type = expression();
-    try {
-        BlockData data = block_table.find(id);
-        emit("INDEX", {data.size, line});
-    }
-    catch (scope_error) {
-        // This error message will have been issued already by variable_access
+    // An undefined array has already been reported by variable_access
+    if (data) {
+        if (bounds_elim && ranges.in_bounds(shape, data->size)) {
+            if (loop_depth > 0) {
+                unchecked.push_back(UncheckedIndex{output.size(), data->size, line});
+            }
+            emit("INDEX_UNCHECKED");
+        }
+        else {
+            emit("INDEX", {data->size, line});
+        }
     }
     
     if (!equals(ind_type, PLType::INTEGER)) {
-        error_preamble();
-        std::cout << "Array index must be integer type" << std::endl;
+        error(DiagnosticCode::INDEX_TYPE);
     }
     match(RIGHT_BRACKET, nonterm);
 }
@@ -993,21 +1713,18 @@ PLType Parser::constant(int &value)
     else if (s == IDENTIFIER) {
         auto id = next_token->lexeme;
         match(s, nonterm);
-        try {
-            BlockData data = block_table.find(id);
-            if (!data.constant) {
-                error_preamble();
-                cerr << "Found non-constant value where constant expected" << endl;
-                return PLType::UNDEFINED;
-            }
-            value = data.value;
-            return data.type;
+        BlockData *data = block_table.lookup(id);
+        if (!data) {
+            error(DiagnosticCode::UNDEFINED_IDENTIFIER, {id});
+            return PLType::UNDEFINED;
         }
-        catch (const scope_error &e) {
-            error_preamble();
-            cerr << e.what() << endl;
+        note_reference(data);
+        if (!data->constant) {
+            error(DiagnosticCode::NOT_CONSTANT);
             return PLType::UNDEFINED;
         }
+        value = data->value;
+        return data->type;
     }
     else {
         syntax_error(nonterm);
@@ -0,0 +1,20 @@
+#include "plam.h"
+
+std::string plam_text(const std::vector<Instruction> &code, bool line_table)
+{
+    std::string text;
+    int line = 0;
+    for (auto &instr: code) {
+        // Labels take no space in the program, so they don't need a line
+        if (line_table && instr.line != line && instr.op != "DEFADDR" && instr.op != "DEFARG") {
+            line = instr.line;
+            text += "LINE " + std::to_string(line) + '\n';
+        }
+        text += instr.op + ' ';
+        for (auto a: instr.args) {
+            text += std::to_string(a) + ' ';
+        }
+        text += '\n';
+    }
+    return text;
+}
@@ -0,0 +1,101 @@
+#include "procedure_cache.h"
+#include <algorithm>
+#include <utility>
+
+
+ProcedureCache::ProcedureCache(): generation(0), num_hits(0), num_misses(0) {}
+
+
+unsigned long long ProcedureCache::key(std::vector<Token>::const_iterator first,
+                                       std::vector<Token>::const_iterator last)
+{
+    /*  64 bit FNV-1a over each token's symbol, value, column and lexeme. Columns are included so
+        the positions of symbols recorded in the body stay right
+    */
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    auto add = [&hash](unsigned char c) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    };
+    for (auto t = first; ; t++) {
+        add((unsigned char)t->symbol);
+        for (int shift = 0; shift < 32; shift += 8) {
+            add((unsigned char)(t->value >> shift));
+            add((unsigned char)(t->column >> shift));
+        }
+        for (char c: t->lexeme) {
+            add(c);
+        }
+        // Separates the lexeme from the next token
+        add(0);
+        if (t == last) {
+            break;
+        }
+    }
+    return hash;
+}
+
+
+void ProcedureCache::next_generation()
+{
+    for (auto it = entries.begin(); it != entries.end(); ) {
+        auto &list = it->second;
+        for (size_t i = 0; i < list.size(); ) {
+            if (list[i].generation != generation) {
+                list[i] = std::move(list.back());
+                list.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+        it = list.empty() ? entries.erase(it) : std::next(it);
+    }
+    generation++;
+    num_hits = 0;
+    num_misses = 0;
+}
+
+
+std::vector<CachedProcedure *> ProcedureCache::find(unsigned long long key,
+                                                    std::vector<Token>::const_iterator first,
+                                                    std::vector<Token>::const_iterator last)
+{
+    std::vector<CachedProcedure *> found;
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return found;
+    }
+    // The same fields as the key
+    auto same = [](const Token &a, const Token &b) {
+        return a.symbol == b.symbol && a.value == b.value && a.column == b.column &&
+               a.lexeme == b.lexeme;
+    };
+    for (auto &entry: it->second) {
+        if (entry.tokens.size() == size_t(last - first) + 1 &&
+            std::equal(first, last + 1, entry.tokens.begin(), same)) {
+            found.push_back(&entry);
+        }
+    }
+    return found;
+}
+
+
+void ProcedureCache::use(CachedProcedure &entry)
+{
+    entry.generation = generation;
+    num_hits++;
+}
+
+
+void ProcedureCache::store(unsigned long long key, CachedProcedure entry)
+{
+    entry.generation = generation;
+    entries[key].push_back(std::move(entry));
+}
+
+
+void ProcedureCache::clear()
+{
+    entries.clear();
+}
@@ -0,0 +1,464 @@
+#include "range_analysis.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+
+
+ExprShape ExprShape::other()
+{
+    ExprShape s;
+    s.kind = OTHER;
+    s.value = 0;
+    s.exact = false;
+    return s;
+}
+
+
+ExprShape ExprShape::constant(int value)
+{
+    ExprShape s = other();
+    s.kind = CONSTANT;
+    s.value = value;
+    return s;
+}
+
+
+ExprShape ExprShape::linear(VarKey var, int offset)
+{
+    ExprShape s = other();
+    s.kind = LINEAR;
+    s.var = var;
+    s.value = offset;
+    return s;
+}
+
+
+// Results that would overflow are not folded, since the interpreter's behaviour is then unknown
+static bool fits(long long x) { return x >= INT_MIN && x <= INT_MAX; }
+
+
+ExprShape ExprShape::arithmetic(const ExprShape &lhs, Symbol op, const ExprShape &rhs)
+{
+    long long l = lhs.value;
+    long long r = rhs.value;
+    if (lhs.kind == CONSTANT && rhs.kind == CONSTANT) {
+        long long result;
+        switch (op) {
+            case ADD: result = l + r; break;
+            case SUBTRACT: result = l - r; break;
+            case MULTIPLY: result = l * r; break;
+            case DIVIDE:
+                if (r == 0) return other();
+                result = l / r;
+                break;
+            case MODULO:
+                if (r == 0) return other();
+                result = l % r;
+                break;
+            default: return other();
+        }
+        return fits(result) ? constant(result) : other();
+    }
+    // var + k, k + var and var - k stay linear
+    if (lhs.kind == LINEAR && rhs.kind == CONSTANT && (op == ADD || op == SUBTRACT)) {
+        long long offset = (op == ADD ? l + r : l - r);
+        return fits(offset) ? linear(lhs.var, offset) : other();
+    }
+    if (lhs.kind == CONSTANT && rhs.kind == LINEAR && op == ADD) {
+        return fits(l + r) ? linear(rhs.var, l + r) : other();
+    }
+    return other();
+}
+
+
+ExprShape ExprShape::negative(const ExprShape &operand)
+{
+    if (operand.kind == CONSTANT && fits(-(long long)operand.value)) {
+        return constant(-operand.value);
+    }
+    return other();
+}
+
+
+ExprShape ExprShape::compare(const ExprShape &lhs, Symbol op, const ExprShape &rhs)
+{
+    if (lhs.kind == CONSTANT && rhs.kind == CONSTANT) {
+        switch (op) {
+            case LESS_THAN: return constant(lhs.value < rhs.value);
+            case EQUALS: return constant(lhs.value == rhs.value);
+            case GREATER_THAN: return constant(lhs.value > rhs.value);
+            default: return other();
+        }
+    }
+    // Normalize to var + k op c
+    const ExprShape *var_side = &lhs;
+    const ExprShape *const_side = &rhs;
+    if (lhs.kind == CONSTANT && rhs.kind == LINEAR) {
+        std::swap(var_side, const_side);
+        if (op == LESS_THAN) op = GREATER_THAN;
+        else if (op == GREATER_THAN) op = LESS_THAN;
+    }
+    /*  var + k may wrap around for a non-zero k, so that the comparison holds for values of var
+        outside the range it would otherwise give
+    */
+    if (var_side->kind != LINEAR || const_side->kind != CONSTANT || var_side->value != 0) {
+        return other();
+    }
+    long long bound = const_side->value;
+    Range r{-RANGE_INF, RANGE_INF};
+    switch (op) {
+        case LESS_THAN: r.hi = bound - 1; break;
+        case EQUALS: r.lo = r.hi = bound; break;
+        case GREATER_THAN: r.lo = bound + 1; break;
+        default: return other();
+    }
+    ExprShape s = other();
+    s.kind = CONDITION;
+    s.conjuncts.push_back(std::make_pair(var_side->var, r));
+    s.exact = true;
+    return s;
+}
+
+
+ExprShape ExprShape::conjoin(const ExprShape &lhs, const ExprShape &rhs)
+{
+    if (lhs.kind == CONSTANT && rhs.kind == CONSTANT) {
+        return constant(lhs.value == 1 ? rhs.value : lhs.value);
+    }
+    if (lhs.kind == CONDITION && rhs.kind == CONDITION) {
+        ExprShape s = lhs;
+        s.conjuncts.insert(s.conjuncts.end(), rhs.conjuncts.begin(), rhs.conjuncts.end());
+        s.exact = lhs.exact && rhs.exact;
+        return s;
+    }
+    // true & c is c
+    if (lhs.kind == CONSTANT && lhs.value == 1 && rhs.kind == CONDITION) return rhs;
+    if (rhs.kind == CONSTANT && rhs.value == 1 && lhs.kind == CONDITION) return lhs;
+    /*  Anything that holds when one operand is true still holds when both are, but the ranges no
+        longer hold only then
+    */
+    ExprShape s = lhs.kind == CONDITION ? lhs : rhs.kind == CONDITION ? rhs : other();
+    s.exact = false;
+    return s;
+}
+
+
+ExprShape ExprShape::logical_not(const ExprShape &operand)
+{
+    if (operand.kind == CONSTANT) {
+        return constant(1 - operand.value);
+    }
+    /*  Only a one sided bound has a complement that is still a range, and only a single exact
+        comparison is false exactly when its range doesn't hold
+    */
+    if (operand.kind == CONDITION && operand.exact && operand.conjuncts.size() == 1) {
+        auto c = operand.conjuncts[0];
+        Range r = c.second;
+        if (r.lo == -RANGE_INF && r.hi != RANGE_INF) {
+            c.second = Range{r.hi + 1, RANGE_INF};
+        }
+        else if (r.hi == RANGE_INF && r.lo != -RANGE_INF) {
+            c.second = Range{-RANGE_INF, r.lo - 1};
+        }
+        else {
+            return other();
+        }
+        ExprShape s = operand;
+        s.conjuncts[0] = c;
+        return s;
+    }
+    return other();
+}
+
+
+RangeAnalysis::RangeAnalysis() {}
+
+
+void RangeAnalysis::enter_procedure()
+{
+    open_procs.push_back(ModSet{std::set<VarKey>(), false});
+    if (!deferred.empty()) {
+        open_effects.push_back(ProcedureEffects());
+    }
+    facts.clear();
+}
+
+
+void RangeAnalysis::exit_procedure(int proc_label)
+{
+    assert(open_procs.size() > 0);
+    proc_mods[proc_label] = open_procs.back();
+    open_procs.pop_back();
+    if (!deferred.empty()) {
+        proc_effects[proc_label] = std::move(open_effects.back());
+        open_effects.pop_back();
+    }
+    facts.clear();
+}
+
+
+void RangeAnalysis::defer(const std::set<int> &proc_labels)
+{
+    deferred = proc_labels;
+}
+
+
+void RangeAnalysis::add_procedure(int proc_label, const ModSet &mods)
+{
+    proc_mods[proc_label] = mods;
+    facts.clear();
+}
+
+
+void RangeAnalysis::assign(const std::vector<std::pair<VarKey, ExprShape>> &assignments)
+{
+    // Evaluate every right hand side before changing anything, as the interpreter does
+    Facts results;
+    for (auto &a: assignments) {
+        const ExprShape &value = a.second;
+        if (value.kind == ExprShape::CONSTANT) {
+            results[a.first] = Range{value.value, value.value};
+        }
+        else if (value.kind == ExprShape::LINEAR && facts.count(value.var)) {
+            /*  Adding to a value with no upper bound, or subtracting from one with no lower bound,
+                may wrap around, as may moving a bound out of the int range. Nothing is known then
+            */
+            Range r = facts[value.var];
+            bool up = value.value > 0, down = value.value < 0;
+            if (r.lo != -RANGE_INF) r.lo += value.value;
+            else if (down) continue;
+            if (r.hi != RANGE_INF) r.hi += value.value;
+            else if (up) continue;
+            if ((r.lo == -RANGE_INF || fits(r.lo)) && (r.hi == RANGE_INF || fits(r.hi))) {
+                results[a.first] = r;
+            }
+        }
+    }
+    for (auto &a: assignments) {
+        check_monotonic(a.first, a.second, results.count(a.first) > 0);
+    }
+    for (auto &a: assignments) {
+        modified(a.first);
+        facts.erase(a.first);
+    }
+    for (auto &r: results) {
+        facts[r.first] = r.second;
+    }
+}
+
+
+void RangeAnalysis::clobber(VarKey var)
+{
+    check_monotonic(var, ExprShape::other(), false);
+    modified(var);
+    facts.erase(var);
+}
+
+
+void RangeAnalysis::call(int proc_label, int def_level)
+{
+    if (!open_effects.empty()) {
+        open_effects.back().calls.push_back(std::make_pair(proc_label, def_level));
+    }
+    if (deferred.count(proc_label)) {
+        facts.clear();
+        return;
+    }
+    ModSet mods;
+    if (!modifications(proc_label, def_level, mods) || mods.all) {
+        facts.clear();
+        modified_all();
+        return;
+    }
+    // Changes made by the procedure called, not by the caller itself
+    for (auto &v: mods.vars) {
+        facts.erase(v);
+        if (!open_procs.empty()) {
+            open_procs.back().vars.insert(v);
+        }
+    }
+}
+
+
+bool RangeAnalysis::modifications(int proc_label, int def_level, ModSet &mods) const
+{
+    auto it = proc_mods.find(proc_label);
+    if (it == proc_mods.end()) {
+        return false;
+    }
+    mods.all = it->second.all;
+    mods.vars.clear();
+    // Locals of the procedure and of its nested procedures are deeper than def_level
+    for (auto &v: it->second.vars) {
+        if (v.first <= def_level) {
+            mods.vars.insert(v);
+        }
+    }
+    return true;
+}
+
+
+void RangeAnalysis::begin_if()
+{
+    constructs.push_back(Construct{facts, std::vector<Facts>(), std::map<VarKey, LoopEffect>(), false});
+}
+
+
+void RangeAnalysis::begin_do(const LoopSummary &summary)
+{
+    /*  The facts at the loop head must hold on every iteration. Variables only ever incremented
+        keep their lower bound, those only decremented keep their upper bound. That only holds if
+        they never wrap around, which each increment is checked for as it is parsed
+    */
+    Facts head;
+    std::map<VarKey, LoopEffect> monotonic;
+    if (!summary.changes_all) {
+        head = facts;
+        for (auto &e: summary.effects) {
+            auto it = head.find(e.first);
+            if (it == head.end()) {
+                continue;
+            }
+            if (e.second == LoopEffect::INCREASING) {
+                it->second.hi = RANGE_INF;
+                monotonic[e.first] = e.second;
+            }
+            else if (e.second == LoopEffect::DECREASING) {
+                it->second.lo = -RANGE_INF;
+                monotonic[e.first] = e.second;
+            }
+            else {
+                head.erase(it);
+            }
+        }
+    }
+    facts = head;
+    constructs.push_back(Construct{head, std::vector<Facts>(), monotonic, false});
+}
+
+
+void RangeAnalysis::begin_guard()
+{
+    assert(constructs.size() > 0);
+    facts = constructs.back().entry;
+}
+
+
+void RangeAnalysis::assume(const ExprShape &guard)
+{
+    if (guard.kind != ExprShape::CONDITION) {
+        return;
+    }
+    for (auto &c: guard.conjuncts) {
+        auto it = facts.find(c.first);
+        if (it == facts.end()) {
+            facts[c.first] = c.second;
+        }
+        else {
+            it->second.lo = std::max(it->second.lo, c.second.lo);
+            it->second.hi = std::min(it->second.hi, c.second.hi);
+        }
+    }
+}
+
+
+void RangeAnalysis::end_guard()
+{
+    assert(constructs.size() > 0);
+    constructs.back().exits.push_back(facts);
+}
+
+
+void RangeAnalysis::end_if()
+{
+    assert(constructs.size() > 0);
+    // An if statement with no true guard aborts, so afterwards one of the guarded commands ran
+    auto &exits = constructs.back().exits;
+    if (exits.empty()) {
+        facts = constructs.back().entry;
+    }
+    else {
+        facts = exits[0];
+        for (unsigned int i = 1; i < exits.size(); i++) {
+            for (auto it = facts.begin(); it != facts.end(); ) {
+                auto other = exits[i].find(it->first);
+                if (other == exits[i].end()) {
+                    it = facts.erase(it);
+                    continue;
+                }
+                it->second.lo = std::min(it->second.lo, other->second.lo);
+                it->second.hi = std::max(it->second.hi, other->second.hi);
+                it++;
+            }
+        }
+    }
+    constructs.pop_back();
+}
+
+
+bool RangeAnalysis::end_do()
+{
+    assert(constructs.size() > 0);
+    // The loop exits from its head
+    facts = constructs.back().entry;
+    bool wrapped = constructs.back().wrapped;
+    if (wrapped) {
+        for (auto &m: constructs.back().monotonic) {
+            facts.erase(m.first);
+        }
+    }
+    constructs.pop_back();
+    return !wrapped;
+}
+
+
+bool RangeAnalysis::in_bounds(const ExprShape &index, int size) const
+{
+    if (index.kind == ExprShape::CONSTANT) {
+        return index.value >= 1 && index.value <= size;
+    }
+    if (index.kind == ExprShape::LINEAR) {
+        auto it = facts.find(index.var);
+        if (it == facts.end()) {
+            return false;
+        }
+        return it->second.lo + index.value >= 1 && it->second.hi + index.value <= size;
+    }
+    return false;
+}
+
+
+void RangeAnalysis::modified(VarKey var)
+{
+    if (!open_procs.empty()) {
+        open_procs.back().vars.insert(var);
+    }
+    if (!open_effects.empty()) {
+        open_effects.back().own.insert(var);
+    }
+}
+
+
+void RangeAnalysis::check_monotonic(VarKey var, const ExprShape &value, bool bounded)
+{
+    // Only an increment whose result was bounded within the int range can't have wrapped around
+    bool increment = value.kind == ExprShape::LINEAR && value.var == var && bounded;
+    for (auto &c: constructs) {
+        auto it = c.monotonic.find(var);
+        if (it == c.monotonic.end()) {
+            continue;
+        }
+        bool right_way = it->second == LoopEffect::INCREASING ? value.value >= 0 : value.value <= 0;
+        if (!increment || !right_way) {
+            c.wrapped = true;
+        }
+    }
+}
+
+
+void RangeAnalysis::modified_all()
+{
+    if (!open_procs.empty()) {
+        open_procs.back().all = true;
+    }
+}
@@ -2,30 +2,37 @@
 #include "scanner.h"
 #include <cassert>
 
-Scanner::Scanner(std::ifstream &program_file, SymbolTable &symbol_table) : 
-   next_char(program_file), sym_table(symbol_table) 
+// Make sure whitespace is not skipped when iterating over input stream
+static std::istream &unskipped(std::istream &in)
 {
-    // Make sure whitespace is not skipped when iterating over input stream
-    program_file >> std::noskipws;
+    return in >> std::noskipws;
 }
 
+Scanner::Scanner(std::istream &program_file, SymbolTable &symbol_table) : 
+   // The iterator reads the first character as it is constructed, so whitespace is kept first
+   sym_table(symbol_table), next_char(unskipped(program_file)), column(1) {}
+
 Token Scanner::get_token()
 {
     skip_whitespace();
+    if (!eof() && *next_char == '$') {
+        // $ marks comments - skip everything until the newline, which is returned as the token
+        skip_line();
+    }
+    int start_column = column;
+    Token tok = scan_token();
+    tok.column = start_column;
+    return tok;
+}
 
+Token Scanner::scan_token()
+{
     if (eof()) {
         /*  Once the end of the file is reached, any subsequent calls to get_token will continue to 
             return an end of file token
         */
         return Token(END_OF_FILE, "EOF");
     }
-    else if (*next_char == '$') {
-        /*  $ marks comments - skip everything until the next newline, recurse to return the 
-            newline token
-        */
-        skip_line();
-        return get_token();
-    }
     else if (letter(*next_char)) {
         return scan_word();
     }
@@ -38,11 +45,17 @@ Token Scanner::get_token()
     else {
         // unrecognized character
         std::string c(1, *next_char);
-        next_char++;
+        advance();
         return Token(INVALID_CHAR, c);
     }
 }
 
+void Scanner::advance()
+{
+    column = *next_char == '\n' ? 1 : column + 1;
+    next_char++;
+}
+
 bool Scanner::letter(char c)
 {
     // Alphabetic ASCII characters are sequential
@@ -84,7 +97,7 @@ void Scanner::skip_whitespace()
 {
     // Newlines are are not considered whitespace because we want a newline token for debugging
     while ((*next_char == ' ' || *next_char == '\t') && !eof()) {
-        next_char++;
+        advance();
     }
 }
 
@@ -94,7 +107,7 @@ void Scanner::skip_line()
         followed by comments where we still want to retain the line information for debugging
     */
     while (*next_char != '\n' && !eof()) {
-        next_char++;
+        advance();
     }
 }
 
@@ -106,7 +119,7 @@ Token Scanner::scan_word()
         // will remain true if at any point an invalid character is found
         invalid_word |= !(letter(*next_char) || digit(*next_char) || *next_char == '_');
         word += *next_char;
-        next_char++;
+        advance();
     }
     if (invalid_word) {
         return Token(INVALID_WORD, word);
@@ -133,7 +146,7 @@ Token Scanner::scan_numeral()
         // Numerals can only contain digits, but continue to read if invalid char is found
         invalid_numeral |= !(digit(*next_char));
         numeral += *next_char;
-        next_char++;
+        advance();
     }
     if (invalid_numeral) {
         return Token(INVALID_NUMERAL, numeral);
@@ -147,7 +160,7 @@ Token Scanner::scan_numeral()
 Token Scanner::scan_symbol()
 {
     char sym = *next_char;
-    next_char++;
+    advance();
 
     std::string lex(1, sym);
 
@@ -163,7 +176,7 @@ Token Scanner::scan_symbol()
             // The only valid case for a : character is when followed by =
             if (*next_char == '=') {
                 lex += *next_char;
-                next_char++;
+                advance();
                 return Token(ASSIGN, lex);
             }
             else {
@@ -179,7 +192,7 @@ Token Scanner::scan_symbol()
             */
             if (*next_char == ']') {
                 lex += *next_char;
-                next_char++;
+                advance();
                 return Token(DOUBLE_BRACKET, lex);
             }
             else {
@@ -205,7 +218,7 @@ Token Scanner::scan_symbol()
             */
             if (*next_char == '>') {
                 lex += *next_char;
-                next_char++;
+                advance();
                 return Token(RIGHT_ARROW, lex);
             }
             else {
@@ -0,0 +1,228 @@
+#include "server.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+// Longest source a source request can send
+static const long long MAX_SOURCE_LENGTH = 64 << 20;
+
+
+/*  Stream buffer for a connected socket. Writes don't raise SIGPIPE, so a client that goes away
+    only ends its own connection
+*/
+class SocketBuffer: public std::streambuf
+{
+public:
+    SocketBuffer(int socket_fd): fd(socket_fd)
+    {
+        setg(in_buffer, in_buffer, in_buffer);
+        setp(out_buffer, out_buffer + sizeof(out_buffer));
+    }
+
+    ~SocketBuffer() { sync(); }
+
+protected:
+    int underflow() override
+    {
+        ssize_t count;
+        do {
+            count = ::read(fd, in_buffer, sizeof(in_buffer));
+        } while (count < 0 && errno == EINTR);
+        if (count <= 0) {
+            return traits_type::eof();
+        }
+        setg(in_buffer, in_buffer, in_buffer + count);
+        return traits_type::to_int_type(in_buffer[0]);
+    }
+
+    int overflow(int c) override
+    {
+        if (sync() != 0) {
+            return traits_type::eof();
+        }
+        if (c != traits_type::eof()) {
+            *pptr() = c;
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        char *next = pbase();
+        while (next < pptr()) {
+            ssize_t count = send(fd, next, pptr() - next, MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                setp(out_buffer, out_buffer + sizeof(out_buffer));
+                return -1;
+            }
+            next += count;
+        }
+        setp(out_buffer, out_buffer + sizeof(out_buffer));
+        return 0;
+    }
+
+private:
+    int fd;
+    char in_buffer[4096];
+    char out_buffer[4096];
+};
+
+
+CompileServer::CompileServer(CompilerOptions opts): compiler(opts), stopped(false) {}
+
+
+// Remove the socket at path left by a previous server. Returns false if path is anything else
+static bool remove_socket(const std::string &path)
+{
+    struct stat status;
+    if (lstat(path.c_str(), &status) < 0) {
+        return errno == ENOENT;
+    }
+    if (!S_ISSOCK(status.st_mode)) {
+        errno = EEXIST;
+        return false;
+    }
+    return unlink(path.c_str()) == 0;
+}
+
+
+void CompileServer::serve(std::istream &in, std::ostream &out)
+{
+    while (handle(in, out)) {}
+}
+
+
+bool CompileServer::listen(const std::string &path)
+{
+    sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "socket path too long: " << path << std::endl;
+        return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+
+    // A socket left by a previous server is replaced, but no other file
+    if (!remove_socket(path)) {
+        std::cerr << "failed to listen on " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0 || bind(server_fd, (sockaddr *)&address, sizeof(address)) < 0 ||
+        ::listen(server_fd, 16) < 0) {
+        std::cerr << "failed to listen on " << path << ": " << strerror(errno) << std::endl;
+        if (server_fd >= 0) {
+            close(server_fd);
+        }
+        return false;
+    }
+    while (!stopped) {
+        int client = accept(server_fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        {
+            SocketBuffer buffer(client);
+            std::iostream stream(&buffer);
+            serve(stream, stream);
+        }
+        close(client);
+    }
+    close(server_fd);
+    remove_socket(path);
+    return true;
+}
+
+
+bool CompileServer::handle(std::istream &in, std::ostream &out)
+{
+    std::string line;
+    if (stopped || !std::getline(in, line)) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::istringstream fields(line);
+    std::string request, output_file;
+    fields >> request;
+    if (request.empty()) {
+        return true;
+    }
+    if (request == "quit") {
+        stopped = true;
+        return false;
+    }
+
+    std::unique_ptr<std::istream> source;
+    if (request == "compile") {
+        std::string input_file;
+        fields >> input_file >> output_file;
+        source.reset(new std::ifstream(input_file));
+        if (input_file.empty() || !source->good()) {
+            respond(out, true, 0, "failed to open input file " + input_file + "\n");
+            return true;
+        }
+    }
+    else if (request == "source") {
+        long long length = -1;
+        fields >> output_file >> length;
+        if (length < 0) {
+            respond(out, true, 0, "source request must give the length of the source\n");
+            return true;
+        }
+        // The source can't be skipped to read the next request, so the input ends here
+        if (length > MAX_SOURCE_LENGTH) {
+            respond(out, true, 0, "source longer than " + std::to_string(MAX_SOURCE_LENGTH) +
+                    " bytes\n");
+            return false;
+        }
+        std::string text(length, '\0');
+        if (!in.read(&text[0], length)) {
+            return false;
+        }
+        source.reset(new std::istringstream(text));
+    }
+    else {
+        respond(out, true, 0, "unknown request " + request + "\n");
+        return true;
+    }
+    std::ofstream file_out(output_file);
+    if (output_file.empty() || !file_out.good()) {
+        respond(out, true, 0, "failed to open output file " + output_file + "\n");
+        return true;
+    }
+
+    // Messages the compiler prints are returned in the response
+    std::ostringstream messages;
+    compiler.set_message_streams(messages, messages);
+    bool failed = compiler.compile(*source, file_out);
+    file_out.close();
+
+    auto end = std::chrono::steady_clock::now();
+    respond(out, failed, std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+            messages.str());
+    return true;
+}
+
+
+void CompileServer::respond(std::ostream &out, bool failed, long long microseconds,
+                            const std::string &messages)
+{
+    out << (failed ? "error " : "ok ") << microseconds << ' ' << messages.size() << '\n'
+        << messages << std::flush;
+}
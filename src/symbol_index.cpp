@@ -0,0 +1,137 @@
+#include "symbol_index.h"
+#include <sstream>
+
+
+// Order of occurrences in the source
+static bool before(const SourceSpan &a, const SourceSpan &b)
+{
+    return a.line < b.line || (a.line == b.line && a.column < b.column);
+}
+
+
+SymbolIndex::SymbolIndex() {}
+
+
+void SymbolIndex::clear()
+{
+    definitions.clear();
+    by_position.clear();
+    by_definition.clear();
+    by_definition_start.clear();
+}
+
+
+int SymbolIndex::define(const std::string &id, const SourceSpan &span, const BlockData &data)
+{
+    definitions.push_back(SymbolDefinition{id, span, data});
+    int symbol = definitions.size() - 1;
+    by_position.push_back(Occurrence{span, symbol, true});
+    return symbol;
+}
+
+
+void SymbolIndex::reference(const SourceSpan &span, int definition)
+{
+    by_position.push_back(Occurrence{span, definition, false});
+}
+
+
+void SymbolIndex::finish()
+{
+    /*  The parser records occurrences in the order it reads them, except for the variables of an
+        array definition, which are defined after its bound has been read. An insertion sort only
+        has to move those few
+    */
+    for (size_t i = 1; i < by_position.size(); i++) {
+        if (!before(by_position[i].span, by_position[i - 1].span)) {
+            continue;
+        }
+        Occurrence moved = by_position[i];
+        size_t j = i;
+        for (; j > 0 && before(moved.span, by_position[j - 1].span); j--) {
+            by_position[j] = by_position[j - 1];
+        }
+        by_position[j] = moved;
+    }
+
+    // Counting sort by definition, keeping the order by position within each
+    by_definition_start.assign(definitions.size() + 1, 0);
+    for (auto &o: by_position) {
+        by_definition_start[o.definition + 1]++;
+    }
+    for (size_t d = 1; d < by_definition_start.size(); d++) {
+        by_definition_start[d] += by_definition_start[d - 1];
+    }
+    by_definition.resize(by_position.size());
+    std::vector<int> next(by_definition_start.begin(), by_definition_start.end() - 1);
+    for (size_t i = 0; i < by_position.size(); i++) {
+        by_definition[next[by_position[i].definition]++] = i;
+    }
+}
+
+
+int SymbolIndex::find(int line, int column) const
+{
+    // The last occurrence starting at or before the position
+    size_t lo = 0, hi = by_position.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const SourceSpan &span = by_position[mid].span;
+        if (span.line < line || (span.line == line && span.column <= column)) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return -1;
+    }
+    const SourceSpan &span = by_position[lo - 1].span;
+    if (span.line != line || column >= span.column + span.length) {
+        return -1;
+    }
+    return by_position[lo - 1].definition;
+}
+
+
+std::vector<SourceSpan> SymbolIndex::occurrences(int symbol) const
+{
+    std::vector<SourceSpan> spans;
+    for (int i = by_definition_start[symbol]; i < by_definition_start[symbol + 1]; i++) {
+        spans.push_back(by_position[by_definition[i]].span);
+    }
+    return spans;
+}
+
+
+std::string SymbolIndex::describe(int symbol) const
+{
+    const SymbolDefinition &d = definitions[symbol];
+    std::ostringstream text;
+    if (d.data.type == PLType::PROCEDURE) {
+        text << "proc " << d.id << "\nlevel " << d.data.level;
+        return text.str();
+    }
+    bool boolean = d.data.type == PLType::BOOLEAN;
+    if (d.data.constant) {
+        text << "const " << d.id << " = ";
+        if (boolean) {
+            text << (d.data.value ? "true" : "false");
+        }
+        else {
+            text << d.data.value;
+        }
+        text << "\nlevel " << d.data.level;
+        return text.str();
+    }
+    text << (boolean ? "Boolean " : "integer ");
+    if (d.data.array) {
+        text << "array " << d.id << '[' << d.data.size << ']';
+    }
+    else {
+        text << d.id;
+    }
+    text << "\nlevel " << d.data.level << ", displacement " << d.data.displacement;
+    return text.str();
+}
@@ -3,21 +3,25 @@
 #include <iostream>
 #include <stdexcept>
 
+static const int INITIAL_SIZE = 101;
+
+static const Symbol keyword_symbols[] = {  
+    BEGIN, END, CONST, ARRAY, INT, BOOL, PROC, SKIP, READ, WRITE, CALL, IF, FI, DO, OD, 
+    TRUE_KEYWORD, FALSE_KEYWORD 
+};
+static const char *const keyword_lexemes[] = {
+    "begin", "end", "const", "array", "integer", "Boolean", "proc", "skip", "read", "write", 
+    "call", "if", "fi", "do", "od", "true", "false"
+};
+
 SymbolTable::SymbolTable() : used{0}
 {
-    tok_table.resize(101);
+    tok_table.resize(INITIAL_SIZE);
 
-    Symbol symbols[] = {  
-        BEGIN, END, CONST, ARRAY, INT, BOOL, PROC, SKIP, READ, WRITE, CALL, IF, FI, DO, OD, 
-        TRUE_KEYWORD, FALSE_KEYWORD 
-    };
-    std::string lexemes[] = {
-        "begin", "end", "const", "array", "integer", "Boolean", "proc", "skip", "read", "write", 
-        "call", "if", "fi", "do", "od", "true", "false"
-    };
     int i = 0;
-    for (auto s: symbols) {
-        insert(Token(s, lexemes[i++]));
+    for (auto s: keyword_symbols) {
+        insert(Token(s, keyword_lexemes[i]));
+        keyword_slots.push_back(hash_fn(keyword_lexemes[i++]));
     }
 }
 
@@ -65,9 +69,37 @@ void SymbolTable::insert(Token tok)
     }
     double load = (double)used / (double)tok_table.size();
     if (load > 0.7) {
-        tok_table.resize(tok_table.size() * 2);
+        // Entries must be rehashed, as their slots depend on the table size
+        std::vector<token_ptr> old_table(tok_table.size() * 2);
+        old_table.swap(tok_table);
+        for (auto &entry: old_table) {
+            if (entry) {
+                tok_table[hash_fn(entry->lexeme)] = std::move(entry);
+            }
+        }
     }
     int hash = hash_fn(tok.lexeme);
     tok_table[hash] = std::unique_ptr<Token>(new Token(tok));
     used++;
 }
+
+void SymbolTable::reset()
+{
+    // Find the reserved words before any slot is emptied, as growth may have moved them
+    std::vector<int> current_slots;
+    for (auto lexeme: keyword_lexemes) {
+        current_slots.push_back(hash_fn(lexeme));
+    }
+    std::vector<token_ptr> keywords;
+    for (int slot: current_slots) {
+        keywords.push_back(std::move(tok_table[slot]));
+    }
+    for (auto &entry: tok_table) {
+        entry.reset();
+    }
+    tok_table.resize(INITIAL_SIZE);
+    for (size_t i = 0; i < keywords.size(); i++) {
+        tok_table[keyword_slots[i]] = std::move(keywords[i]);
+    }
+    used = keywords.size();
+}
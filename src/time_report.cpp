@@ -0,0 +1,141 @@
+#include "time_report.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sys/resource.h>
+
+
+std::atomic<bool> HeapCounters::on(false);
+std::atomic<long long> HeapCounters::count(0), HeapCounters::total(0), HeapCounters::live(0),
+                       HeapCounters::peak(0);
+
+
+void HeapCounters::allocated(long long bytes)
+{
+    count.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(bytes, std::memory_order_relaxed);
+    long long now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    long long highest = peak.load(std::memory_order_relaxed);
+    while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {
+    }
+}
+
+
+void HeapCounters::freed(long long bytes)
+{
+    live.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+
+void HeapCounters::reset_peak()
+{
+    peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+
+// Milliseconds since an arbitrary point
+static double wall_ms()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double, std::milli>(now).count();
+}
+
+
+// User and system CPU time of every thread of the process, in milliseconds
+static double cpu_ms(const rusage &usage)
+{
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+
+TimeReport::Scope::Scope(TimeReport *r, const std::string &name): report(r)
+{
+    if (!report) {
+        return;
+    }
+    phase = name;
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cpu = cpu_ms(usage);
+    allocations = HeapCounters::allocations();
+    bytes = HeapCounters::allocated_bytes();
+    HeapCounters::reset_peak();
+    wall = wall_ms();
+}
+
+
+TimeReport::Scope::~Scope()
+{
+    if (!report) {
+        return;
+    }
+    double end = wall_ms();
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    Phase &p = report->phase(phase);
+    p.wall_ms += end - wall;
+    p.cpu_ms += cpu_ms(usage) - cpu;
+    // Linux gives the resident set in kilobytes
+    p.peak_rss_kb = std::max(p.peak_rss_kb, (long long)usage.ru_maxrss);
+    p.peak_heap = std::max(p.peak_heap, HeapCounters::peak_bytes());
+    p.allocations += HeapCounters::allocations() - allocations;
+    p.bytes += HeapCounters::allocated_bytes() - bytes;
+}
+
+
+TimeReport::Phase &TimeReport::phase(const std::string &name)
+{
+    for (auto &p: phases) {
+        if (p.name == name) {
+            return p;
+        }
+    }
+    phases.push_back(Phase{name, 0, 0, 0, 0, 0, 0});
+    return phases.back();
+}
+
+
+void TimeReport::count(const std::string &name, long long n)
+{
+    for (auto &c: counts) {
+        if (c.first == name) {
+            c.second += n;
+            return;
+        }
+    }
+    counts.push_back(std::make_pair(name, n));
+}
+
+
+void TimeReport::write(std::ostream &out) const
+{
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::left << std::setw(13) << "phase" << std::right << std::setw(10) << "wall ms"
+        << std::setw(10) << "cpu ms" << std::setw(13) << "peak RSS KB" << std::setw(14)
+        << "peak heap KB" << std::setw(13) << "allocations" << std::setw(14) << "allocated KB"
+        << "\n" << std::fixed << std::setprecision(2);
+    auto row = [&out](const Phase &p) {
+        out << std::left << std::setw(13) << p.name << std::right << std::setw(10) << p.wall_ms
+            << std::setw(10) << p.cpu_ms << std::setw(13) << p.peak_rss_kb << std::setw(14)
+            << std::max(p.peak_heap, 0LL) / 1024 << std::setw(13) << p.allocations
+            << std::setw(14) << p.bytes / 1024 << "\n";
+    };
+    Phase total{"total", 0, 0, 0, 0, 0, 0};
+    for (auto &p: phases) {
+        row(p);
+        total.wall_ms += p.wall_ms;
+        total.cpu_ms += p.cpu_ms;
+        total.peak_rss_kb = std::max(total.peak_rss_kb, p.peak_rss_kb);
+        total.peak_heap = std::max(total.peak_heap, p.peak_heap);
+        total.allocations += p.allocations;
+        total.bytes += p.bytes;
+    }
+    row(total);
+    for (auto &c: counts) {
+        out << c.first << ": " << c.second << "\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
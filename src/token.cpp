@@ -1,15 +1,16 @@
 #include "token.h"
 
 Token::Token(Symbol tok_symbol, std::string tok_lexeme, int tok_value) :
-    symbol{tok_symbol}, lexeme{tok_lexeme}, value{tok_value} {}
+    symbol{tok_symbol}, lexeme{tok_lexeme}, value{tok_value}, column{0} {}
 
-Token::Token(): symbol{EMPTY}, lexeme{""}, value{0} {}
+Token::Token(): symbol{EMPTY}, lexeme{""}, value{0}, column{0} {}
 
-Token::Token(const Token &tok) : symbol{tok.symbol}, lexeme{tok.lexeme}, value{tok.value} {}
+Token::Token(const Token &tok) : symbol{tok.symbol}, lexeme{tok.lexeme}, value{tok.value}, column{tok.column} {}
 
 void Token::operator=(const Token &tok)
 {
     symbol = tok.symbol;
     lexeme = tok.lexeme;
     value = tok.value;
+    column = tok.column;
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "work_pool.h"
+#include <thread>
+
+
+WorkPool::WorkPool(int threads): num_threads(threads > 0 ? threads : 1) {}
+
+
+void WorkPool::run(const std::vector<std::function<void()>> &jobs)
+{
+    std::vector<Queue> queues(num_threads);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        queues[i % num_threads].jobs.push_back(i);
+    }
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.push_back(std::thread(&WorkPool::work, this, std::cref(jobs), std::ref(queues), i));
+    }
+    work(jobs, queues, 0);
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+
+bool WorkPool::next_job(std::vector<Queue> &queues, int self, size_t &job)
+{
+    {
+        std::lock_guard<std::mutex> guard(queues[self].lock);
+        if (!queues[self].jobs.empty()) {
+            job = queues[self].jobs.back();
+            queues[self].jobs.pop_back();
+            return true;
+        }
+    }
+    // No jobs are added once running, so an empty round of stealing means there is nothing left
+    for (int i = 1; i < num_threads; i++) {
+        Queue &victim = queues[(self + i) % num_threads];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void WorkPool::work(const std::vector<std::function<void()>> &jobs, std::vector<Queue> &queues, int self)
+{
+    size_t job;
+    while (next_job(queues, self, job)) {
+        jobs[job]();
+    }
+}
@@ -0,0 +1,268 @@
+#include "x86_backend.h"
+#include <cassert>
+
+
+// Words beyond NATIVE_STORE_SIZE kept for expression temporaries, which are not checked
+static const int STORE_MARGIN = 4096;
+
+// Operand for the store word at index reg + offset words
+static std::string word(const std::string &reg, int offset = 0)
+{
+    std::string disp = offset ? std::to_string(4 * offset) : "";
+    return disp + "(%r13," + reg + ",4)";
+}
+
+static std::string label(int l) { return ".Lpl" + std::to_string(l); }
+
+static std::string imm(int value) { return "$" + std::to_string(value); }
+
+
+X86Backend::X86Backend(const std::vector<Instruction> &program): code(program), num_stubs(0) {}
+
+
+std::string X86Backend::assembly()
+{
+    out.str("");
+    error_stubs.str("");
+    num_stubs = 0;
+    for (auto &instr: code) {
+        if (instr.op == "DEFARG") {
+            args[instr.args[0]] = instr.args[1];
+        }
+    }
+
+    /*  Register use, preserved across calls into the runtime:
+            r13  address of pl_store
+            rbx  base register, index of the current activation record
+            r12  stack register, index of the top of the stack
+        The machine stack only holds return addresses, padded to keep it 16 byte aligned
+    */
+    out << "\t.text\n"
+        << "\t.globl pl_main\n"
+        << "\t.type pl_main, @function\n"
+        << "pl_main:\n";
+    for (auto &instr: code) {
+        translate(instr);
+    }
+    out << error_stubs.str();
+    out << ".Lpl_overflow:\n";
+    asm_line("call pl_stack_overflow");
+    out << "\t.size pl_main, .-pl_main\n\n"
+        << "\t.globl pl_store_words\n"
+        << "\t.section .rodata\n"
+        << "\t.align 4\n"
+        << "pl_store_words:\n"
+        << "\t.long " << NATIVE_STORE_SIZE + STORE_MARGIN << "\n\n"
+        << "\t.globl pl_store\n"
+        << "\t.bss\n"
+        << "\t.align 64\n"
+        << "pl_store:\n"
+        << "\t.zero " << 4 * (NATIVE_STORE_SIZE + STORE_MARGIN) << "\n"
+        << "\t.section .note.GNU-stack,\"\",@progbits\n";
+    return out.str();
+}
+
+
+void X86Backend::asm_line(const std::string &line)
+{
+    out << "\t" << line << "\n";
+}
+
+
+void X86Backend::frame_base(int level)
+{
+    asm_line("mov %rbx, %rax");
+    for (int i = 0; i < level; i++) {
+        asm_line("movslq " + word("%rax") + ", %rax");
+    }
+}
+
+
+void X86Backend::pop_operand()
+{
+    asm_line("movl " + word("%r12") + ", %eax");
+    asm_line("dec %r12");
+}
+
+
+void X86Backend::comparison(const std::string &set_instr)
+{
+    pop_operand();
+    asm_line("cmpl %eax, " + word("%r12"));
+    asm_line(set_instr + " %al");
+    asm_line("movzbl %al, %eax");
+    asm_line("movl %eax, " + word("%r12"));
+}
+
+
+void X86Backend::translate(const Instruction &instr)
+{
+    const std::string &op = instr.op;
+    const std::string top = word("%r12");
+    if (op == "DEFADDR") {
+        out << label(instr.args[0]) << ":\n";
+    }
+    else if (op == "DEFARG") {
+        // Only used through PROC and PROG
+    }
+    else if (op == "VARIABLE") {
+        frame_base(instr.args[0]);
+        asm_line("add " + imm(instr.args[1]) + ", %eax");
+        asm_line("inc %r12");
+        asm_line("movl %eax, " + top);
+    }
+    else if (op == "INDEX") {
+        // One unsigned comparison of index - 1 against bound - 1 covers both ends of the range
+        int stub = num_stubs++;
+        asm_line("movl " + top + ", %eax");
+        asm_line("dec %r12");
+        asm_line("dec %eax");
+        asm_line("cmpl " + imm(instr.args[0] - 1) + ", %eax");
+        asm_line("ja .Lpl_range" + std::to_string(stub));
+        asm_line("addl %eax, " + top);
+        error_stubs << ".Lpl_range" << stub << ":\n"
+                    << "\tmov " << imm(instr.args[1]) << ", %edi\n"
+                    << "\tcall pl_range_error\n";
+    }
+    else if (op == "INDEX_UNCHECKED") {
+        asm_line("movl " + top + ", %eax");
+        asm_line("dec %r12");
+        asm_line("dec %eax");
+        asm_line("addl %eax, " + top);
+    }
+    else if (op == "CONSTANT") {
+        asm_line("inc %r12");
+        asm_line("movl " + imm(instr.args[0]) + ", " + top);
+    }
+    else if (op == "VALUE") {
+        asm_line("movslq " + top + ", %rax");
+        asm_line("movl " + word("%rax") + ", %eax");
+        asm_line("movl %eax, " + top);
+    }
+    else if (op == "NOT") {
+        asm_line("mov $1, %eax");
+        asm_line("subl " + top + ", %eax");
+        asm_line("movl %eax, " + top);
+    }
+    else if (op == "MINUS") {
+        asm_line("negl " + top);
+    }
+    else if (op == "ADD" || op == "SUBTRACT") {
+        pop_operand();
+        asm_line((op == "ADD" ? "addl %eax, " : "subl %eax, ") + top);
+    }
+    else if (op == "MULTIPLY") {
+        pop_operand();
+        asm_line("imull " + top + ", %eax");
+        asm_line("movl %eax, " + top);
+    }
+    else if (op == "DIVIDE" || op == "MODULO") {
+        // Division by zero traps, as it does in the interpreter
+        asm_line("movl " + top + ", %ecx");
+        asm_line("dec %r12");
+        asm_line("movl " + top + ", %eax");
+        asm_line("cltd");
+        asm_line("idivl %ecx");
+        asm_line((op == "DIVIDE" ? "movl %eax, " : "movl %edx, ") + top);
+    }
+    else if (op == "LESS") {
+        comparison("setl");
+    }
+    else if (op == "EQUAL") {
+        comparison("sete");
+    }
+    else if (op == "GREATER") {
+        comparison("setg");
+    }
+    else if (op == "AND" || op == "OR") {
+        // The left operand is kept unless it is true for and, false for or
+        pop_operand();
+        asm_line("cmpl " + std::string(op == "AND" ? "$1, " : "$0, ") + top);
+        asm_line("jne 1f");
+        asm_line("movl %eax, " + top);
+        out << "1:\n";
+    }
+    else if (op == "READ" || op == "WRITE") {
+        int count = instr.args[0];
+        asm_line("sub " + imm(count) + ", %r12");
+        for (int i = 1; i <= count; i++) {
+            if (op == "READ") {
+                asm_line("movslq " + word("%r12", i) + ", %rax");
+                asm_line("lea " + word("%rax") + ", %rdi");
+                asm_line("call pl_read");
+            }
+            else {
+                asm_line("movl " + word("%r12", i) + ", %edi");
+                asm_line("call pl_write");
+            }
+        }
+    }
+    else if (op == "ASSIGN") {
+        int count = instr.args[0];
+        asm_line("sub " + imm(2 * count) + ", %r12");
+        for (int i = 1; i <= count; i++) {
+            asm_line("movslq " + word("%r12", i) + ", %rax");
+            asm_line("movl " + word("%r12", i + count) + ", %ecx");
+            asm_line("movl %ecx, " + word("%rax"));
+        }
+    }
+    else if (op == "CALL") {
+        // Same activation record layout as the interpreter, with no use for the return address
+        frame_base(instr.args[0]);
+        asm_line("add $3, %r12");
+        asm_line("cmp " + imm(NATIVE_STORE_SIZE) + ", %r12");
+        asm_line("jg .Lpl_overflow");
+        asm_line("movl %eax, " + word("%r12", -2));
+        asm_line("movl %ebx, " + word("%r12", -1));
+        asm_line("movl $0, " + top);
+        asm_line("lea -2(%r12), %rbx");
+        asm_line("call " + label(instr.args[1]));
+    }
+    else if (op == "ARROW") {
+        pop_operand();
+        asm_line("cmp $1, %eax");
+        asm_line("jne " + label(instr.args[0]));
+    }
+    else if (op == "BAR") {
+        asm_line("jmp " + label(instr.args[0]));
+    }
+    else if (op == "FI") {
+        asm_line("mov " + imm(instr.args[0]) + ", %edi");
+        asm_line("call pl_fi_error");
+    }
+    else if (op == "PROC") {
+        asm_line("sub $8, %rsp");
+        asm_line("add " + imm(args.at(instr.args[0])) + ", %r12");
+        asm_line("cmp " + imm(NATIVE_STORE_SIZE) + ", %r12");
+        asm_line("jg .Lpl_overflow");
+        asm_line("jmp " + label(instr.args[1]));
+    }
+    else if (op == "ENDPROC") {
+        asm_line("lea -1(%rbx), %r12");
+        asm_line("movl " + word("%rbx", 1) + ", %ebx");
+        asm_line("add $8, %rsp");
+        asm_line("ret");
+    }
+    else if (op == "PROG") {
+        // The main program's record starts at the bottom of the store
+        asm_line("push %rbx");
+        asm_line("push %r12");
+        asm_line("push %r13");
+        asm_line("lea pl_store(%rip), %r13");
+        asm_line("xor %ebx, %ebx");
+        asm_line("mov " + imm(args.at(instr.args[0]) + 2) + ", %r12");
+        asm_line("cmp " + imm(NATIVE_STORE_SIZE) + ", %r12");
+        asm_line("jg .Lpl_overflow");
+        asm_line("jmp " + label(instr.args[1]));
+    }
+    else if (op == "ENDPROG") {
+        asm_line("pop %r13");
+        asm_line("pop %r12");
+        asm_line("pop %rbx");
+        asm_line("xor %eax, %eax");
+        asm_line("ret");
+    }
+    else {
+        assert(false);
+    }
+}
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Check that every demo program writes the same output whichever optimizations are enabled.
+# Input for a demo is read from demo_inputs/<demo>.in if it exists.
+# Usage: compare_demos.sh plc plinterp project_dir
+PLC=$1
+PLINTERP=$2
+ROOT=$3
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# Sets of flags compared against the unoptimized program, the first enables everything
+variants() {
+    printf '%s\n' "" "--no-bounds-elim" "--no-dce" "-finline-limit=0" "-finline-limit=1000"
+}
+
+status=0
+for src in "$ROOT"/demos/*.txt; do
+    name=$(basename "$src" .txt)
+    input="$ROOT/test/demo_inputs/$name.in"
+    [ -f "$input" ] || input=/dev/null
+
+    "$PLC" "$src" -o ref.plam --no-bounds-elim --no-dce -finline-limit=0 > /dev/null || { status=1; continue; }
+    "$PLINTERP" ref.plam < "$input" > ref.txt 2>&1
+    echo "$name$(printf '\t')$(wc -l < ref.plam) instructions unoptimized"
+
+    variants | while read -r flags; do
+        "$PLC" "$src" -o opt.plam $flags > /dev/null || exit 1
+        "$PLINTERP" opt.plam < "$input" > opt.txt 2>&1
+        if ! cmp -s ref.txt opt.txt; then
+            echo "$name: output differs with flags '$flags'"
+            diff ref.txt opt.txt
+            exit 1
+        fi
+    done || status=1
+done
+exit $status
@@ -0,0 +1,77 @@
+#!/bin/sh
+# Check that every demo program writes the same output when run by plinterp --reg, translated by
+# plinterp --jit and compiled to x86-64 ahead of time as when interpreted. The interpreter's loading
+# messages are left out of the comparison. Batch mode must match apart from its missing prompts,
+# and so must every program when all are run from one manifest by plinterp --manifest, either one
+# after another or sharing the threads in slices of a few instructions.
+# Usage: compare_modes.sh plc plinterp libplrt project_dir
+PLC=$1
+PLINTERP=$2
+RUNTIME=$3
+ROOT=$4
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+status=0
+for src in "$ROOT"/demos/*.txt "$ROOT"/test/src_files/codegen/* "$ROOT"/test/src_files/native/*; do
+    name=$(basename "$src" .txt)
+    input="$ROOT/test/demo_inputs/$name.in"
+    [ -f "$input" ] || input=/dev/null
+
+    "$PLC" "$src" -o prog.plam > /dev/null || { status=1; continue; }
+    "$PLINTERP" prog.plam < "$input" 2>&1 | grep -v -e '^ Loading\.\.\.$' -e '^ Running \.\.\.$' \
+        > interp.txt
+    for mode in --reg --jit; do
+        "$PLINTERP" $mode prog.plam < "$input" 2>&1 \
+            | grep -v -e '^ Loading\.\.\.$' -e '^ Running \.\.\.$' > mode.txt
+        if ! cmp -s interp.txt mode.txt; then
+            echo "$name: output differs with $mode"
+            diff interp.txt mode.txt
+            status=1
+        fi
+    done
+    "$PLINTERP" --batch prog.plam < "$input" > batch.txt 2>&1
+    if ! sed 's/Input: //g' interp.txt | cmp -s - batch.txt; then
+        echo "$name: output differs with --batch"
+        sed 's/Input: //g' interp.txt | diff - batch.txt
+        status=1
+    fi
+    # Runtime errors are reported by the manifest run instead of in the output
+    cp prog.plam "$name.plam"
+    "$PLINTERP" --batch prog.plam < "$input" 2> "$name.error" > "$name.expected"
+    echo "$name.plam $input $name.actual" >> manifest.txt
+    "$PLC" "$src" -o prog.s --target=x86-64 > /dev/null || { status=1; continue; }
+    cc prog.s "$RUNTIME" -o prog || { echo "$name: failed to assemble"; status=1; continue; }
+    ./prog < "$input" > native.txt 2>&1
+    if ! cmp -s interp.txt native.txt; then
+        echo "$name: native output differs"
+        diff interp.txt native.txt
+        status=1
+    fi
+done
+
+for options in "" "--slice 7"; do
+    rm -f *.actual
+    "$PLINTERP" --manifest -j 3 $options manifest.txt > manifest.log
+    for expected in *.expected; do
+        name=$(basename "$expected" .expected)
+        if ! cmp -s "$expected" "$name.actual"; then
+            echo "$name: output differs with --manifest $options"
+            diff "$expected" "$name.actual"
+            status=1
+        fi
+        # The report line ends with the runtime error, if there was one
+        report=$(grep "^$name.plam " manifest.log)
+        if [ -s "$name.error" ]; then
+            ending=" us, $(cat "$name.error")"
+        else
+            ending=" us"
+        fi
+        case "$report" in
+            *"$ending") ;;
+            *) echo "$name: wrong --manifest $options report: $report"; status=1 ;;
+        esac
+    done
+done
+exit $status
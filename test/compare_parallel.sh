@@ -0,0 +1,50 @@
+#!/bin/sh
+# Check that compiling many files in one plc run gives the same output files as compiling each on
+# its own, and the same messages in the same order whatever the number of threads. The demos are
+# compiled along with the scope and type tests, which have errors. Parsing each file's procedure
+# bodies on several threads must also give the same output file and messages.
+# Usage: compare_parallel.sh plc project_dir
+PLC=$1
+ROOT=$2
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+files=""
+for src in "$ROOT"/demos/*.txt "$ROOT"/test/src_files/scope/* "$ROOT"/test/src_files/type/*; do
+    name=$(basename "$src")
+    cp "$src" "$name.pl"
+    files="$files $name.pl"
+    "$PLC" "$name.pl" -o "$name.expected" > /dev/null 2> "$name.messages"
+done
+
+status=0
+for file in $files; do
+    name=$(basename "$file" .pl)
+    "$PLC" "$file" -o "$name.bodies" --procedure-threads=4 > /dev/null 2> "$name.bodies_messages"
+    if ! cmp -s "$name.expected" "$name.bodies" || ! cmp -s "$name.messages" "$name.bodies_messages"; then
+        echo "$name: output or messages differ with --procedure-threads=4"
+        diff "$name.messages" "$name.bodies_messages"
+        status=1
+    fi
+done
+
+for threads in 1 4; do
+    "$PLC" $files -j $threads > "stdout.$threads" 2> "stderr.$threads"
+    for file in $files; do
+        name=$(basename "$file" .pl)
+        if ! cmp -s "$name.expected" "$name.plam"; then
+            echo "$name: output differs when compiled with -j $threads"
+            status=1
+        fi
+        rm -f "$name.plam"
+    done
+done
+for stream in stdout stderr; do
+    if ! cmp -s "$stream.1" "$stream.4"; then
+        echo "$stream differs between -j 1 and -j 4"
+        diff "$stream.1" "$stream.4"
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Check that programs written by plgen have exactly the number of errors asked for, over a range
+# of seeds and shapes, and that small ones without errors run to the end in the interpreter, with
+# input of large numbers for their read statements.
+# Usage: generated_programs.sh plgen plc plinterp
+PLGEN=$1
+PLC=$2
+PLINTERP=$3
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+seq 1 1000 | awk '{ print $1 * 7777777 }' > input.txt
+status=0
+seed=1
+while [ $seed -le 40 ]; do
+    errors=$((seed % 7 * 2))
+    shape="--seed=$seed --procedures=$((3 + seed % 6)) --procedure-depth=$((seed % 4))
+           --statements=8 --statement-depth=$((seed % 5)) --expression-length=$((seed % 11))
+           --read-write=$((seed * 7 % 50)) --comments=$((seed % 2))"
+    "$PLGEN" $shape --errors=$errors -o errors.pl || { status=1; break; }
+    found=$("$PLC" errors.pl -o errors.plam 2>&1 | grep -c '^Error')
+    if [ "$found" -ne $errors ]; then
+        echo "seed $seed: $found errors reported instead of $errors"
+        status=1
+    fi
+
+    # Small enough for the interpreter's store
+    "$PLGEN" --seed=$seed --procedures=1 --procedure-depth=$((seed % 2)) \
+        --statements=3 --statement-depth=$((seed % 3)) --expression-length=$((seed % 5)) \
+        --array-size=$((1 + seed % 20)) --trip-count=$((seed % 6)) \
+        --read-write=$((seed * 13 % 50)) -o run.pl
+    if ! "$PLC" run.pl -o run.plam > messages.txt 2>&1; then
+        echo "seed $seed: errors in a program generated without any"
+        cat messages.txt
+        status=1
+    elif "$PLINTERP" --batch run.plam < input.txt 2>&1 | grep -q -i -e error -e overflow; then
+        echo "seed $seed: run-time error"
+        status=1
+    fi
+    seed=$((seed + 1))
+done
+exit $status
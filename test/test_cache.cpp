@@ -0,0 +1,115 @@
+#include <catch.hpp>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "compile_cache.h"
+#include "procedure_cache.h"
+
+const std::string cache_dir = "test_cache_dir";
+
+std::string program(std::string var)
+{
+    return "begin integer " + var + "; " + var + " := 1; write " + var + "; end.\n";
+}
+
+bool exists(std::string path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+TEST_CASE("Cache hits replay the compilation", "[cache]")
+{
+    std::system(("rm -rf " + cache_dir).c_str());
+    CompilerOptions options;
+    CompileCache cache(cache_dir, DEFAULT_CACHE_SIZE, options);
+    Compiler compiler(options);
+
+    for (std::string source: {program("x"), std::string("begin integer x; x := y; end.")}) {
+        std::ostringstream output, out, err, cached_output, cached_out, cached_err;
+        bool failed = cache.compile(compiler, source, output, out, err);
+        REQUIRE(cache.compile(compiler, source, cached_output, cached_out, cached_err) == failed);
+        REQUIRE(cached_output.str() == output.str());
+        REQUIRE(cached_out.str() == out.str());
+        REQUIRE(cached_err.str() == err.str());
+    }
+    REQUIRE(cache.misses() == 2);
+    REQUIRE(cache.hits() == 2);
+
+    // An entry under another source's name, as if the names collided, is a miss
+    std::string one = "begin write 1; end.", two = "begin write 2; end.";
+    std::ostringstream one_output, two_output, messages;
+    cache.compile(compiler, one, one_output, messages, messages);
+    std::system(("cp " + cache.entry_path(one) + " " + cache.entry_path(two)).c_str());
+    cache.compile(compiler, two, two_output, messages, messages);
+    REQUIRE(cache.misses() == 4);
+    REQUIRE(two_output.str() != one_output.str());
+
+    // Different settings never share an entry
+    options.bounds_elim = false;
+    CompileCache other(cache_dir, DEFAULT_CACHE_SIZE, options);
+    Compiler other_compiler(options);
+    std::ostringstream output, out, err;
+    other.compile(other_compiler, program("x"), output, out, err);
+    REQUIRE(other.misses() == 1);
+    std::system(("rm -rf " + cache_dir).c_str());
+}
+
+TEST_CASE("Cache evicts the least recently used entries", "[cache-evict]")
+{
+    std::system(("rm -rf " + cache_dir).c_str());
+    struct stat info;
+    CompilerOptions options;
+    Compiler compiler(options);
+    std::string a, b, c;
+    {
+        CompileCache cache(cache_dir, DEFAULT_CACHE_SIZE, options);
+        a = cache.entry_path(program("a"));
+        b = cache.entry_path(program("b"));
+        c = cache.entry_path(program("c"));
+        std::ostringstream output, out, err;
+        // File times may only change every few milliseconds
+        for (std::string var: {"a", "b", "c", "a"}) {
+            cache.compile(compiler, program(var), output, out, err);
+            usleep(20000);
+        }
+        REQUIRE(cache.hits() == 1);
+    }
+    REQUIRE(stat(a.c_str(), &info) == 0);
+    // Only entries and stale temporary files are removed
+    std::string other = cache_dir + "/notes.txt", temp = a + ".tmp1.0", stale = b + ".tmp1.0";
+    for (std::string path: {other, temp, stale}) {
+        std::system(("cp " + a + " " + path).c_str());
+    }
+    std::system(("touch -d '2 hours ago' " + other + " " + stale).c_str());
+    // Room for two of the three entries, which are all the same size
+    CompileCache cache(cache_dir, info.st_size * 5 / 2, options);
+    cache.evict();
+    REQUIRE(exists(a));
+    REQUIRE(!exists(b));
+    REQUIRE(exists(c));
+    REQUIRE(exists(other));
+    REQUIRE(exists(temp));
+    REQUIRE(!exists(stale));
+    std::system(("rm -rf " + cache_dir).c_str());
+}
+
+TEST_CASE("Procedure cache entries are only found for their own tokens", "[procedure-cache]")
+{
+    std::vector<Token> body = {Token(BEGIN, "begin"), Token(IDENTIFIER, "x"), Token(ASSIGN, ":="),
+                               Token(NUMERAL, "1", 1), Token(SEMICOLON, ";"), Token(END, "end")};
+    std::vector<Token> other = body;
+    other[3] = Token(NUMERAL, "2", 2);
+    ProcedureCache cache;
+    CachedProcedure entry;
+    entry.tokens = body;
+    // Stored as if both bodies hashed to the same key
+    unsigned long long key = ProcedureCache::key(body.begin(), body.end() - 1);
+    cache.store(key, entry);
+    REQUIRE(cache.find(key, body.begin(), body.end() - 1).size() == 1);
+    REQUIRE(cache.find(key, other.begin(), other.end() - 1).empty());
+    REQUIRE(cache.find(key, body.begin(), body.end() - 2).empty());
+    REQUIRE(cache.find(key + 1, body.begin(), body.end() - 1).empty());
+}
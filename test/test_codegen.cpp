@@ -0,0 +1,108 @@
+#include <catch.hpp>
+#include <string>
+#include "parser.h"
+#include "optimizer.h"
+#include "x86_backend.h"
+
+// Defined in test_parser.cpp
+std::vector<Token> read_file(std::string fname);
+
+std::string generate(std::string fname, bool bounds_elim = true)
+{
+    Parser parser(false, bounds_elim);
+    std::vector<Token> tlist = read_file(fname);
+    std::string code;
+    REQUIRE(parser.verify_syntax(&tlist, code) == 0);
+    return code;
+}
+
+int count_instr(const std::string &code, std::string instr)
+{
+    int count = 0;
+    for (auto pos = code.find(instr + ' '); pos != std::string::npos; 
+         pos = code.find(instr + ' ', pos + 1)) {
+        if (pos == 0 || code[pos - 1] == '\n') {
+            count++;
+        }
+    }
+    return count;
+}
+
+TEST_CASE("Bounds check elimination", "[bounds-elim]")
+{
+    auto code = generate("test/src_files/codegen/bounds_elim");
+    REQUIRE(count_instr(code, "INDEX_UNCHECKED") == 6);
+    REQUIRE(count_instr(code, "INDEX") == 4);
+}
+
+TEST_CASE("Bounds check elimination disabled", "[no-bounds-elim]")
+{
+    auto code = generate("test/src_files/codegen/bounds_elim", false);
+    REQUIRE(count_instr(code, "INDEX_UNCHECKED") == 0);
+    REQUIRE(count_instr(code, "INDEX") == 10);
+}
+
+TEST_CASE("Bounds check elimination with wrapping counters", "[bounds-elim-wrap]")
+{
+    // The counter wraps around to a negative value, which the loop guard doesn't exclude
+    auto code = generate("test/src_files/native/wrapping_index");
+    REQUIRE(count_instr(code, "INDEX_UNCHECKED") == 0);
+    REQUIRE(count_instr(code, "INDEX") == 1);
+}
+
+TEST_CASE("Dead code elimination", "[dce]")
+{
+    Parser parser;
+    std::vector<Token> tlist = read_file("test/src_files/codegen/dead_code");
+    std::vector<Instruction> code;
+    REQUIRE(parser.verify_syntax(&tlist, code) == 0);
+    int size = code.size();
+    int removed = Optimizer(code).eliminate_dead_code();
+    REQUIRE(removed == size - (int)code.size());
+    auto text = plam_text(code);
+    REQUIRE(count_instr(text, "PROC") == 2);
+    REQUIRE(count_instr(text, "CALL") == 2);
+    REQUIRE(count_instr(text, "ARROW") == 1);
+}
+
+TEST_CASE("Procedure inlining", "[inline]")
+{
+    Parser parser;
+    std::vector<Token> tlist = read_file("test/src_files/codegen/inline");
+    std::vector<Instruction> code;
+    REQUIRE(parser.verify_syntax(&tlist, code) == 0);
+    Optimizer optimizer(code);
+    // inc into twice, then twice into rec and the main program
+    REQUIRE(optimizer.inline_procedures(30) == 4);
+    optimizer.eliminate_dead_code();
+    auto text = plam_text(code);
+    REQUIRE(count_instr(text, "CALL") == 2);
+    REQUIRE(count_instr(text, "PROC") == 1);
+}
+
+TEST_CASE("Procedure inlining limit", "[inline-limit]")
+{
+    Parser parser;
+    std::vector<Token> tlist = read_file("test/src_files/codegen/inline");
+    std::vector<Instruction> code;
+    REQUIRE(parser.verify_syntax(&tlist, code) == 0);
+    // Only twice, which is two calls, is small enough
+    REQUIRE(Optimizer(code).inline_procedures(6) == 2);
+}
+
+TEST_CASE("x86-64 backend", "[x86]")
+{
+    Parser parser;
+    std::vector<Token> tlist = read_file("test/src_files/codegen/bounds_elim");
+    std::vector<Instruction> code;
+    REQUIRE(parser.verify_syntax(&tlist, code) == 0);
+    std::string text = X86Backend(code).assembly();
+    REQUIRE(text.find("pl_main:") != std::string::npos);
+    // One out of line range error for each checked access
+    int stubs = 0;
+    for (size_t pos = text.find("call pl_range_error"); pos != std::string::npos; 
+         pos = text.find("call pl_range_error", pos + 1)) {
+        stubs++;
+    }
+    REQUIRE(stubs == 4);
+}
@@ -0,0 +1,175 @@
+#include <catch.hpp>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "compiler.h"
+#include "interp.h"
+#include "profile.h"
+
+// Defined in test_codegen.cpp
+std::string generate(std::string fname, bool bounds_elim);
+
+// Defined in test_server.cpp
+std::string file_contents(std::string fname);
+
+// Output of a run, with the given input
+std::vector<int> run_with(Interpreter &interp, std::vector<int> input,
+                          ExecutionMode mode = INTERPRET, long long limit = -1)
+{
+    std::vector<int> output;
+    size_t next = 0;
+    interp.set_io([&](int &value) {
+                      if (next == input.size()) {
+                          return false;
+                      }
+                      value = input[next++];
+                      return true;
+                  },
+                  [&](int value) { output.push_back(value); });
+    interp.run(mode, limit);
+    return output;
+}
+
+TEST_CASE("Interpreter input and output functions", "[interp-io]")
+{
+    Interpreter interp;
+    REQUIRE(interp.load_plam(generate("demos/add_procedure.txt", true)));
+    REQUIRE(run_with(interp, {3, 4}) == std::vector<int>{7});
+    REQUIRE(interp.status() == RUN_FINISHED);
+    // Reads with no input left give 0
+    REQUIRE(run_with(interp, {3}) == std::vector<int>{3});
+}
+
+TEST_CASE("Interpreter instruction limit", "[interp-limit]")
+{
+    Interpreter interp;
+    REQUIRE(interp.load_plam(generate("demos/recursion.txt", true)));
+    auto output = run_with(interp, {}, JIT, 100);
+    REQUIRE(interp.status() == RUN_YIELDED);
+    REQUIRE(interp.dispatch_count() == 100);
+    REQUIRE(!interp.failed());
+    REQUIRE(output.size() < 30);
+
+    // Running again carries on from where the program yielded
+    int slices = 1;
+    while (interp.status() == RUN_YIELDED) {
+        auto more = run_with(interp, {}, INTERPRET, 100);
+        output.insert(output.end(), more.begin(), more.end());
+        slices++;
+    }
+    REQUIRE(interp.status() == RUN_FINISHED);
+    REQUIRE(output.size() == 30);
+    REQUIRE(output.back() == 30);
+    long long executed = interp.dispatch_count();
+    REQUIRE(slices == (executed + 99) / 100);
+
+    // A finished program starts again
+    REQUIRE(run_with(interp, {}).size() == 30);
+    REQUIRE(interp.dispatch_count() == executed);
+}
+
+TEST_CASE("Interpreter errors", "[interp-errors]")
+{
+    Interpreter interp;
+    REQUIRE(interp.load_plam(generate("test/src_files/native/range_error", true)));
+    REQUIRE(run_with(interp, {}) == std::vector<int>({1, 2, 3, 4, 5, 6}));
+    REQUIRE(interp.status() == RUN_FAILED);
+    REQUIRE(interp.error() == "line 9 :  range error");
+
+    REQUIRE(!interp.load_plam("PROG 1 2\nDEFADDR 2\n"));
+    REQUIRE(interp.error() == "program has no ENDPROG");
+    REQUIRE(!interp.load_plam("PROG 1 2\nJUMP 2\nENDPROG\n"));
+    REQUIRE(interp.run() == RUN_FAILED);
+}
+
+TEST_CASE("Interpreters on several threads", "[interp-threads]")
+{
+    std::string plam = generate("demos/recursion.txt", true);
+    const ExecutionMode modes[] = {INTERPRET, JIT, REGISTER};
+    std::vector<std::vector<int>> outputs(6);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        threads.push_back(std::thread([&, i]() {
+            Interpreter interp;
+            for (int run = 0; run < 10; run++) {
+                interp.load_plam(plam);
+                outputs[i] = run_with(interp, {}, modes[i % 3]);
+            }
+        }));
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    for (auto &output: outputs) {
+        REQUIRE(output.size() == 30);
+        REQUIRE(output.back() == 30);
+    }
+}
+
+TEST_CASE("Interpreter profile", "[interp-profile]")
+{
+    // Without inlining, so that every procedure is called
+    CompilerOptions options;
+    options.inline_limit = 0;
+    options.line_table = true;
+    std::istringstream source(file_contents("demos/recursion.txt"));
+    std::ostringstream plam, messages;
+    Compiler compiler(options);
+    compiler.set_message_streams(messages, messages);
+    REQUIRE(!compiler.compile(source, plam));
+    std::istringstream text(plam.str());
+    std::vector<int> words, lines;
+    std::string error;
+    REQUIRE(Interpreter::assemble(text, words, error, &lines));
+
+    Interpreter interp;
+    Profile profile;
+    profile.set_lines(lines);
+    interp.set_profile(&profile);
+    interp.load(words);
+    REQUIRE(run_with(interp, {}).size() == 30);
+    long long executed = interp.dispatch_count();
+    REQUIRE(profile.instructions() == executed);
+    REQUIRE(profile.executed(OP_WRITE) == 30);
+
+    // Every instruction has a line. write i, three instructions, is on lines 12, 20 and 28
+    auto &line_counts = profile.lines();
+    REQUIRE(line_counts[0] == 0);
+    REQUIRE(std::accumulate(line_counts.begin(), line_counts.end(), 0LL) == executed);
+    REQUIRE(line_counts[12] + line_counts[20] + line_counts[28] == 3 * 30);
+
+    // f, g and h call each other in turn until 30 numbers have been written
+    auto procs = profile.procedures();
+    REQUIRE(procs.size() == 4);
+    REQUIRE(procs[0].name == "program");
+    REQUIRE(procs[0].inclusive == executed);
+    REQUIRE(procs[1].name == "proc at line 6");
+    REQUIRE(procs[1].calls == 11);
+    long long exclusive = 0;
+    for (auto &p: procs) {
+        exclusive += p.exclusive;
+        REQUIRE(p.inclusive <= executed);
+    }
+    REQUIRE(exclusive == executed);
+
+    std::ostringstream stacks;
+    profile.write_stacks(stacks);
+    std::istringstream stack_lines(stacks.str());
+    std::string line;
+    long long stacked = 0;
+    while (std::getline(stack_lines, line)) {
+        REQUIRE(line.compare(0, 7, "program") == 0);
+        stacked += std::stoll(line.substr(line.rfind(' ') + 1));
+    }
+    REQUIRE(stacked == executed);
+
+    // Counting starts again with the program
+    interp.set_profile(nullptr);
+    run_with(interp, {});
+    REQUIRE(profile.instructions() == executed);
+    interp.set_profile(&profile);
+    run_with(interp, {});
+    REQUIRE(profile.instructions() == executed);
+}
@@ -1,6 +1,7 @@
 #include <catch.hpp>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include "parser.h"
 #include "scanner.h"
 
@@ -27,6 +28,7 @@ void run_test(std::string fname, int nerrors)
     std::cout << fname << std::endl;
     std::vector<Token> tlist = read_file(fname);
     REQUIRE(P.verify_syntax(&tlist, out) == nerrors);
+    P.messages().render_text(std::cout);
     std::cout << std::endl;
 }
 
@@ -109,3 +111,145 @@ TEST_CASE("Undefined variables", "[vars]")
 {
     run_test("test/src_files/scope/vars_undefined", 11);
 }
+
+TEST_CASE("Errors are collected as diagnostics", "[diagnostics]")
+{
+    SymbolTable sym;
+    std::istringstream source("begin\n  integer x;\n  y := x;\n  x := true;\nend.\n");
+    Scanner sc(source, sym);
+    std::vector<Token> tlist;
+    do {
+        tlist.push_back(sc.get_token());
+    } while (tlist.back().symbol != END_OF_FILE);
+    Parser parser;
+    std::string program;
+    REQUIRE(parser.verify_syntax(&tlist, program) == 2);
+
+    auto &records = parser.messages().records();
+    REQUIRE(records.size() == 2);
+    REQUIRE(records[0].code == DiagnosticCode::UNDEFINED_IDENTIFIER);
+    REQUIRE(records[0].line == 3);
+    REQUIRE(records[0].column == 5);
+    REQUIRE(records[0].args == std::vector<std::string>({"y"}));
+    REQUIRE(records[1].code == DiagnosticCode::ASSIGNMENT_TYPE);
+    REQUIRE(records[1].line == 4);
+
+    std::ostringstream text, json;
+    parser.messages().render_text(text);
+    REQUIRE(text.str() == "Error 1 on line 3: Identifier y is undefined\n"
+                          "Error 2 on line 4: Mismatch between types of LHS and RHS of assignment statement\n");
+    parser.messages().render_json(json);
+    REQUIRE(json.str().find("{\"severity\": \"error\", \"line\": 3, \"column\": 5, "
+                            "\"code\": \"undefined-identifier\", \"message\": \"Identifier y is undefined\", "
+                            "\"args\": [\"y\"]}") != std::string::npos);
+}
+
+TEST_CASE("Block table shadowing", "[block-table]")
+{
+    BlockTable table;
+    BlockData data = BlockData();
+    table.push_new();
+    data.displacement = 3;
+    REQUIRE(table.insert("x", data));
+    REQUIRE(!table.insert("x", data));
+    table.push_new();
+    REQUIRE(table.lookup("x")->displacement == 3);
+    data.displacement = 4;
+    REQUIRE(table.insert("x", data));
+    REQUIRE(table.insert("y", data));
+    REQUIRE(table.lookup("x")->displacement == 4);
+    REQUIRE(table.lookup("x")->level == 2);
+    table.pop();
+    // The outer definition is visible again and the inner block's identifiers are gone
+    REQUIRE(table.lookup("x")->displacement == 3);
+    REQUIRE(table.lookup("x")->level == 1);
+    REQUIRE(table.lookup("y") == nullptr);
+    REQUIRE(table.lookup("z") == nullptr);
+}
+
+TEST_CASE("Symbol index", "[symbols]")
+{
+    SymbolTable sym;
+    std::istringstream program(
+        "begin\n"
+        "    const n = 3;\n"
+        "    integer array a[n];\n"
+        "    integer x;\n"
+        "    proc p begin integer x; x := n; end;\n"
+        "    x := a[n]; call p;\n"
+        "end.");
+    Scanner sc(program, sym);
+    std::vector<Token> tlist;
+    do {
+        tlist.push_back(sc.get_token());
+    } while (tlist.back().symbol != END_OF_FILE);
+    Parser parser;
+    SymbolIndex symbols;
+    parser.set_symbol_index(&symbols);
+    std::string code;
+    REQUIRE(parser.verify_syntax(&tlist, code) == 0);
+
+    // The n used as the bound of a
+    int n = symbols.find(3, 21);
+    REQUIRE(n >= 0);
+    REQUIRE(symbols.definition(n).id == "n");
+    REQUIRE(symbols.definition(n).span.line == 2);
+    REQUIRE(symbols.definition(n).span.column == 11);
+    REQUIRE(symbols.occurrences(n).size() == 4);
+    REQUIRE(symbols.describe(n) == "const n = 3\nlevel 1");
+    REQUIRE(symbols.describe(symbols.find(3, 19)) == "integer array a[3]\nlevel 1, displacement 3");
+
+    // The x in p is its own, the x in the program is the outer one
+    int inner = symbols.find(5, 29);
+    int outer = symbols.find(6, 5);
+    REQUIRE(inner != outer);
+    REQUIRE(symbols.definition(inner).span.line == 5);
+    REQUIRE(symbols.definition(outer).span.line == 4);
+    REQUIRE(symbols.describe(symbols.find(6, 21)) == "proc p\nlevel 1");
+    // Positions between identifiers have no symbol
+    REQUIRE(symbols.find(6, 7) == -1);
+    REQUIRE(symbols.find(1, 1) == -1);
+}
+
+TEST_CASE("Procedure bodies parsed on several threads", "[parallel-bodies]")
+{
+    // p and r stand alone, q calls p, and the error in s takes recovery past its end
+    std::string program =
+        "begin\n"
+        "    integer g;\n"
+        "    integer array a[5];\n"
+        "    proc p begin integer i; i := 1; do i < 6 -> a[i] := g; i := i + 1; od; end;\n"
+        "    proc q begin call p; g := a[2]; end;\n"
+        "    proc r begin integer x; x := true; y := 1; end;\n"
+        "    proc s begin g := ( end;\n"
+        "    call q;\n"
+        "end.\n";
+    std::vector<std::string> files = {
+        "demos/recursion.txt", "demos/bubble_sort.txt", "test/src_files/scope/nested_funcs",
+        "test/src_files/scope/proc_redefined", "test/src_files/type/assigning_procs"
+    };
+    for (size_t i = 0; i <= files.size(); i++) {
+        std::vector<Token> tlist;
+        if (i < files.size()) {
+            tlist = read_file(files[i]);
+        }
+        else {
+            SymbolTable sym;
+            std::istringstream source(program);
+            Scanner sc(source, sym);
+            do {
+                tlist.push_back(sc.get_token());
+            } while (tlist.back().symbol != END_OF_FILE);
+        }
+        Parser serial, parallel;
+        parallel.set_threads(3);
+        std::string serial_code, parallel_code;
+        int errors = serial.verify_syntax(&tlist, serial_code);
+        REQUIRE(parallel.verify_syntax(&tlist, parallel_code) == errors);
+        REQUIRE(parallel_code == serial_code);
+        std::ostringstream serial_messages, parallel_messages;
+        serial.messages().render_text(serial_messages);
+        parallel.messages().render_text(parallel_messages);
+        REQUIRE(parallel_messages.str() == serial_messages.str());
+    }
+}
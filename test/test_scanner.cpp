@@ -87,3 +87,20 @@ TEST_CASE("Procedure names", "[proc]")
     };
     check_expected(expected, sc);
 }
+
+TEST_CASE("Symbol table growth and reset", "[sym_table]")
+{
+    SymbolTable sym;
+    for (int i = 0; i < 300; i++) {
+        sym.insert(Token(IDENTIFIER, "id" + std::to_string(i)));
+    }
+    // Reserved words are still found once the table has grown
+    REQUIRE(sym.get("begin").symbol == BEGIN);
+    REQUIRE(sym.get("false").symbol == FALSE_KEYWORD);
+    REQUIRE(sym.contains("id299"));
+    sym.reset();
+    REQUIRE(!sym.contains("id0"));
+    REQUIRE(!sym.contains("id299"));
+    REQUIRE(sym.get("integer").symbol == INT);
+    REQUIRE(sym.get("od").symbol == OD);
+}
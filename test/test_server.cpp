@@ -0,0 +1,347 @@
+#include <catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server.h"
+#include "language_server.h"
+
+std::string file_contents(std::string fname)
+{
+    std::ifstream fin(fname);
+    std::stringstream contents;
+    contents << fin.rdbuf();
+    return contents.str();
+}
+
+// The first word of each response line, skipping the messages that follow it
+std::vector<std::string> response_status(std::string responses)
+{
+    std::istringstream in(responses);
+    std::vector<std::string> status;
+    std::string word;
+    long long microseconds, length;
+    while (in >> word >> microseconds >> length) {
+        status.push_back(word);
+        in.ignore(length + 1);
+    }
+    return status;
+}
+
+TEST_CASE("Server output matches separate compilations", "[server]")
+{
+    std::ifstream fin("demos/recursion.txt");
+    std::ofstream fout("test_server_expected.plam");
+    REQUIRE(!Compiler(fin, fout).run());
+    fout.close();
+
+    std::string source = "begin integer x; x := 2; write x; end.";
+    std::istringstream requests(
+        "compile demos/recursion.txt test_server_1.plam\n"
+        "compile test/src_files/scope/var_redefined test_server_error.plam\n"
+        "source test_server_source.plam " + std::to_string(source.size()) + "\n" + source +
+        "compile demos/recursion.txt test_server_2.plam\n"
+        "compile missing_file test_server_3.plam\n"
+        "quit\n"
+        "compile demos/recursion.txt test_server_4.plam\n");
+    std::ostringstream responses;
+    CompileServer server;
+    server.serve(requests, responses);
+
+    REQUIRE(response_status(responses.str()) == 
+            std::vector<std::string>({"ok", "error", "ok", "ok", "error"}));
+    std::string expected = file_contents("test_server_expected.plam");
+    REQUIRE(file_contents("test_server_1.plam") == expected);
+    // Scope errors in one program leave nothing behind for the next
+    REQUIRE(file_contents("test_server_2.plam") == expected);
+    REQUIRE(file_contents("test_server_source.plam").find("WRITE 1") != std::string::npos);
+    for (auto name: {"expected", "1", "2", "source", "error"}) {
+        std::remove(("test_server_" + std::string(name) + ".plam").c_str());
+    }
+
+    // A source too long to hold is refused, and ends the input
+    std::istringstream oversized("source test_server_big.plam 99999999999999\n"
+                                 "compile demos/recursion.txt test_server_4.plam\n");
+    std::ostringstream refused;
+    CompileServer().serve(oversized, refused);
+    REQUIRE(response_status(refused.str()) == std::vector<std::string>({"error"}));
+}
+
+TEST_CASE("Server on a Unix socket", "[server-socket]")
+{
+    std::string path = "test_server.sock";
+    CompileServer server;
+    std::thread serving([&]() { server.listen(path); });
+
+    int fd = -1;
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, path.size());
+    // Wait for the server to start listening
+    for (int attempt = 0; attempt < 100; attempt++) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (sockaddr *)&address, sizeof(address)) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+        usleep(10000);
+    }
+    REQUIRE(fd >= 0);
+    std::string request = "compile demos/recursion.txt test_server_socket.plam\nquit\n";
+    REQUIRE(write(fd, request.data(), request.size()) == (ssize_t)request.size());
+    std::string response;
+    char buffer[256];
+    ssize_t count;
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+        response.append(buffer, count);
+    }
+    close(fd);
+    serving.join();
+
+    REQUIRE(response_status(response) == std::vector<std::string>({"ok"}));
+    REQUIRE(file_contents("test_server_socket.plam").find("ENDPROG") != std::string::npos);
+    std::remove("test_server_socket.plam");
+
+    // A file that isn't a socket is left alone
+    std::ofstream("test_server_file.sock") << "keep";
+    REQUIRE(!CompileServer().listen("test_server_file.sock"));
+    REQUIRE(file_contents("test_server_file.sock") == "keep");
+    std::remove("test_server_file.sock");
+}
+
+// Compile text, returning the output followed by the messages
+std::string compile_text(Compiler &compiler, const std::string &text)
+{
+    std::istringstream in(text);
+    std::ostringstream output, messages;
+    compiler.set_message_streams(messages, messages);
+    compiler.compile(in, output);
+    return output.str() + messages.str();
+}
+
+// Every occurrence in symbols, with its definition
+std::string symbol_text(const SymbolIndex &symbols)
+{
+    std::ostringstream text;
+    for (auto &o: symbols.all_occurrences()) {
+        auto &d = symbols.definition(o.definition);
+        text << o.span.line << ':' << o.span.column << ' ' << d.id << ' ' << d.span.line << ':'
+             << d.span.column << ' ' << d.data.start_addr << '\n';
+    }
+    return text.str();
+}
+
+TEST_CASE("Incremental compilation matches full compilation", "[incremental]")
+{
+    std::string program = file_contents("demos/recursion.txt");
+    std::string procs = 
+        "begin\n"
+        "    integer x, y;\n"
+        "    proc a\n"
+        "    begin\n"
+        "        integer i;\n"
+        "        proc inner begin x := x + 1; end;\n"
+        "        i := 0;\n"
+        "        do i < 3 -> call inner; i := i + 1; od;\n"
+        "    end;\n"
+        "    proc b\n"
+        "    begin\n"
+        "        y := x * 2;\n"
+        "        call a;\n"
+        "    end;\n"
+        "    x := 1;\n"
+        "    call b;\n"
+        "    write x, y;\n"
+        "end.";
+    auto replace = [](std::string text, const std::string &from, const std::string &to) {
+        return text.replace(text.find(from), from.size(), to);
+    };
+    std::vector<std::string> edits = {
+        procs,
+        // Changes inside one procedure, and lines added before and removed from the others
+        replace(procs, "y := x * 2;", "y := x * 3;"),
+        replace(procs, "begin\n", "begin\n\n    $ comment\n"),
+        replace(procs, "        i := 0;\n", ""),
+        // A procedure that now changes different variables, so its callers change too
+        replace(procs, "x := x + 1;", "y := y + 1;"),
+        // A definition the procedures use changes
+        replace(procs, "integer x, y;", "integer w, x, y;"),
+        // Scan and parse errors, then the original program again
+        replace(procs, "y := x * 2;", "y := x # 2;"),
+        replace(procs, "call a;", "call c;"),
+        procs,
+        program,
+        "",
+        program
+    };
+    CompilerOptions options;
+    options.incremental = true;
+    Compiler incremental(options);
+    SymbolIndex incremental_symbols;
+    incremental.set_symbol_index(&incremental_symbols);
+    for (auto &text: edits) {
+        Compiler full;
+        SymbolIndex full_symbols;
+        full.set_symbol_index(&full_symbols);
+        REQUIRE(compile_text(incremental, text) == compile_text(full, text));
+        // Symbols of reused procedures are the same as if they had been parsed again
+        REQUIRE(symbol_text(incremental_symbols) == symbol_text(full_symbols));
+    }
+
+    compile_text(incremental, procs);
+    compile_text(incremental, edits[1]);
+    // Only b changed, so a is reused along with inner, which is nested in it
+    REQUIRE(incremental.procedures().hits() == 1);
+    REQUIRE(incremental.procedures().misses() == 1);
+}
+
+TEST_CASE("Time report measures each phase", "[time-report]")
+{
+    std::string program = file_contents("demos/bubble_sort.txt");
+    Compiler plain, timed;
+    TimeReport report;
+    timed.set_time_report(&report);
+    REQUIRE(compile_text(timed, program) == compile_text(plain, program));
+
+    std::ostringstream text;
+    report.write(text);
+    std::string table = text.str();
+    size_t last = 0;
+    for (std::string phase: {"scan ", "parse/check ", "optimize ", "emit ", "write ", "total "}) {
+        size_t row = table.find("\n" + phase);
+        REQUIRE(row != std::string::npos);
+        REQUIRE(row > last);
+        last = row;
+    }
+    REQUIRE(table.find("\nlabels: ") != std::string::npos);
+    REQUIRE(table.find("\ninstructions written: ") != std::string::npos);
+
+    // Counts add up over each program compiled
+    std::istringstream in(program);
+    std::vector<Token> tokens;
+    SymbolTable symbols;
+    Scanner scanner(in, symbols);
+    do {
+        tokens.push_back(scanner.get_token());
+    } while (tokens.back().symbol != END_OF_FILE);
+    compile_text(timed, program);
+    std::ostringstream again;
+    report.write(again);
+    REQUIRE(again.str().find("\ntokens: " + std::to_string(2 * tokens.size()) + "\n") !=
+            std::string::npos);
+}
+
+// A message framed as the language server reads and writes them
+std::string lsp_message(const std::string &content)
+{
+    return "Content-Length: " + std::to_string(content.size()) + "\r\n\r\n" + content;
+}
+
+// The contents of the messages the language server wrote
+std::vector<Json> lsp_messages(const std::string &responses)
+{
+    std::vector<Json> messages;
+    std::istringstream in(responses);
+    std::string header, blank;
+    while (std::getline(in, header) && std::getline(in, blank)) {
+        std::string content(std::stoi(header.substr(header.find(':') + 1)), '\0');
+        in.read(&content[0], content.size());
+        Json message;
+        REQUIRE(Json::parse(content, message));
+        messages.push_back(message);
+    }
+    return messages;
+}
+
+TEST_CASE("Language server queries", "[lsp]")
+{
+    std::string program = file_contents("demos/add_procedure.txt");
+    Json open = Json::object().set("textDocument", Json::object().set("uri", "file:///add.pl")
+                                                                 .set("text", program));
+    auto query = [](int id, const std::string &method, int line, int character) {
+        Json params = Json::object()
+            .set("textDocument", Json::object().set("uri", "file:///add.pl"))
+            .set("position", Json::object().set("line", line).set("character", character))
+            .set("context", Json::object().set("includeDeclaration", false));
+        return lsp_message(Json::object().set("jsonrpc", "2.0").set("id", id).set("method", method)
+                                         .set("params", params).dump());
+    };
+    std::istringstream requests(
+        lsp_message("{\"jsonrpc\": \"2.0\", \"id\": 0, \"method\": \"initialize\", \"params\": {}}") +
+        lsp_message(Json::object().set("jsonrpc", "2.0").set("method", "textDocument/didOpen")
+                                  .set("params", open).dump()) +
+        // The call of Add, the use of z in Add, and a position with nothing at it
+        query(1, "textDocument/definition", 9, 10) +
+        query(2, "textDocument/references", 5, 8) +
+        query(3, "textDocument/hover", 5, 8) +
+        query(4, "textDocument/hover", 0, 0) +
+        lsp_message("{\"jsonrpc\": \"2.0\", \"id\": 5, \"method\": \"unknown\"}") +
+        lsp_message("not json") +
+        lsp_message("{\"jsonrpc\": \"2.0\", \"id\": 6, \"method\": \"shutdown\"}") +
+        lsp_message("{\"jsonrpc\": \"2.0\", \"method\": \"exit\"}"));
+    std::ostringstream responses;
+    LanguageServer server;
+    REQUIRE(server.serve(requests, responses) == 0);
+
+    std::vector<Json> messages = lsp_messages(responses.str());
+    REQUIRE(messages.size() == 9);
+    REQUIRE(messages[0]["result"]["capabilities"]["definitionProvider"].as_bool());
+    REQUIRE(messages[1]["method"].as_string() == "textDocument/publishDiagnostics");
+    REQUIRE(messages[1]["params"]["diagnostics"].elements().empty());
+    REQUIRE(messages[2]["result"].dump() == 
+            "{\"uri\":\"file:///add.pl\",\"range\":{\"start\":{\"line\":3,\"character\":9},"
+            "\"end\":{\"line\":3,\"character\":12}}}");
+    // z is assigned in Add and read by the program
+    REQUIRE(messages[3]["result"].elements().size() == 2);
+    REQUIRE(messages[4]["result"]["contents"]["value"].as_string() == "integer z\nlevel 1, displacement 5");
+    REQUIRE(messages[5]["result"].is_null());
+    REQUIRE(messages[6]["error"]["code"].as_int() == -32601);
+    REQUIRE(messages[7]["error"]["code"].as_int() == -32700);
+    REQUIRE(messages[8]["id"].as_int() == 6);
+}
+
+TEST_CASE("Language server rejects bad content lengths", "[lsp-length]")
+{
+    std::istringstream requests(
+        "Content-Length: -1\r\n\r\n" +
+        lsp_message("{\"jsonrpc\": \"2.0\", \"id\": 1, \"method\": \"shutdown\"}") +
+        "Content-Length: 99999999999999999999\r\n\r\n{}");
+    std::ostringstream responses;
+    LanguageServer server;
+    // The input ends without exit
+    REQUIRE(server.serve(requests, responses) == 1);
+
+    std::vector<Json> messages = lsp_messages(responses.str());
+    REQUIRE(messages.size() == 3);
+    REQUIRE(messages[0]["error"]["code"].as_int() == -32600);
+    REQUIRE(messages[1]["id"].as_int() == 1);
+    REQUIRE(messages[2]["error"]["code"].as_int() == -32600);
+}
+
+TEST_CASE("Language server rejects deeply nested messages", "[lsp-depth]")
+{
+    // Nesting to the limit is read, past it is a parse error rather than a stack overflow
+    std::string allowed = std::string(512, '[') + std::string(512, ']');
+    std::string nested = std::string(200000, '[') + std::string(200000, ']');
+    Json value;
+    REQUIRE(Json::parse(allowed, value));
+    REQUIRE_FALSE(Json::parse(std::string(513, '[') + std::string(513, ']'), value));
+
+    std::istringstream requests(
+        lsp_message(nested) +
+        lsp_message("{\"jsonrpc\": \"2.0\", \"id\": 1, \"method\": \"shutdown\"}") +
+        lsp_message("{\"jsonrpc\": \"2.0\", \"method\": \"exit\"}"));
+    std::ostringstream responses;
+    LanguageServer server;
+    REQUIRE(server.serve(requests, responses) == 0);
+
+    std::vector<Json> messages = lsp_messages(responses.str());
+    REQUIRE(messages.size() == 2);
+    REQUIRE(messages[0]["error"]["code"].as_int() == -32700);
+    REQUIRE(messages[1]["id"].as_int() == 1);
+}